@@ -25,6 +25,7 @@
 
 #include <gcm/socket/socket.h>
 #include <gcm/config/config.h>
+#include <gcm/thread/executor.h>
 
 namespace gcm {
 namespace appsrv {
@@ -44,11 +45,14 @@ public:
 
 class ServerApi {
 public:
-    ServerApi(config::Config &config, config::Value &interface_config, Stats &handler_stats, const std::string &handler_name):
+    ServerApi(config::Config &config, config::Value &interface_config, Stats &handler_stats, const std::string &handler_name,
+        thread::Executor &executor, thread::Executor &connections):
         config(config),
         interface_config(interface_config),
         handler_stats(handler_stats),
-        handler_name(handler_name)
+        handler_name(handler_name),
+        executor(executor),
+        connections(connections)
     {}
     ServerApi(ServerApi &&) = default;
     ServerApi(const ServerApi &) = default;
@@ -57,6 +61,15 @@ public:
     config::Value &interface_config;
     Stats &handler_stats;
     const std::string &handler_name;
+
+    // Threads shared by all interfaces, for calls and other work of handlers, instead
+    // of starting their own. Task must not block waiting for other task of it.
+    thread::Executor &executor;
+
+    // Threads of this interface (MinThreads, MaxThreads), that serve its connections.
+    // Reading requests and waiting for calls blocks them, so that the executor is left
+    // for the calls.
+    thread::Executor &connections;
 };
 
 /**
@@ -17,32 +17,31 @@ public:
         logger(logger)
     {}
 
-    void register_method(const std::string &name, std::function<Method> callback) {
-        rpc.register_method(name, callback);
+    /**
+     * Register method, see Rpc::register_method for available overloads.
+     */
+    template<typename... Args>
+    void register_method(const std::string &name, Args&&... args) {
+        rpc.register_method(name, std::forward<Args>(args)...);
     }
 
-    void register_method(const std::string &name, std::function<Method> callback, const std::string &desc) {
-        rpc.register_method(name, callback, desc);
+    /**
+     * Drop cached responses of method, see Rpc::invalidate_cache.
+     */
+    void invalidate_cache(const std::string &method) {
+        rpc.invalidate_cache(method);
     }
 
-    template<typename T>
-    void register_method(const std::string &name, std::function<Method> callback, T params) {
-        rpc.register_method(name, callback, params);
+    void invalidate_cache(const std::string &method, Array &params) {
+        rpc.invalidate_cache(method, params);
     }
 
-    template<typename T>
-    void register_method(const std::string &name, std::function<Method> callback, const std::string &desc, T params) {
-        rpc.register_method(name, callback, desc, params);
-    }
-
-    template<typename T, typename R>
-    void register_method(const std::string &name, std::function<Method> callback, T params, R result) {
-        rpc.register_method(name, callback, params, result);
-    }
-
-    template<typename T, typename R>
-    void register_method(const std::string &name, std::function<Method> callback, const std::string &desc, T params, R result) {
-        rpc.register_method(name, callback, desc, params, result);
+    /**
+     * Register asynchronous method, see Rpc::register_async_method.
+     */
+    template<typename... Args>
+    void register_async_method(const std::string &name, Args&&... args) {
+        rpc.register_async_method(name, std::forward<Args>(args)...);
     }
 
     gcm::appsrv::Stats &get_stats() {
@@ -0,0 +1,335 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "json.h"
+#include "parser.h"
+#include "detail/binary.h"
+
+/**
+ * CBOR (RFC 7049) encoding of JSON values. On input, byte strings are read
+ * as strings, half and single precision floats as double, undefined as null
+ * and tags are ignored. Indefinite length items are accepted.
+ */
+
+namespace gcm {
+namespace json {
+namespace cbor {
+
+namespace detail {
+
+using namespace gcm::json::detail;
+
+enum Major: uint8_t {
+    UnsignedInt = 0,
+    NegativeInt = 1,
+    ByteString = 2,
+    TextString = 3,
+    ArrayType = 4,
+    MapType = 5,
+    Tag = 6,
+    Simple = 7
+};
+
+constexpr const uint8_t Indefinite = 31;
+constexpr const uint8_t Break = 0xFF;
+
+inline void write_head(std::string &out, uint8_t major, uint64_t value) {
+    uint8_t type = static_cast<uint8_t>(major << 5);
+    if (value < 24) {
+        out += static_cast<char>(type | value);
+    } else if (value <= 0xFF) {
+        out += static_cast<char>(type | 24);
+        out += static_cast<char>(value);
+    } else if (value <= 0xFFFF) {
+        out += static_cast<char>(type | 25);
+        put_be(out, static_cast<uint16_t>(value));
+    } else if (value <= 0xFFFFFFFFULL) {
+        out += static_cast<char>(type | 26);
+        put_be(out, static_cast<uint32_t>(value));
+    } else {
+        out += static_cast<char>(type | 27);
+        put_be(out, value);
+    }
+}
+
+inline void write_string(std::string &out, const std::string &value) {
+    write_head(out, TextString, value.size());
+    out += value;
+}
+
+template<typename T>
+T read_be(const char *&begin, const char *end) {
+    T value;
+    if (!get_be(begin, end, value)) {
+        throw ParseException("Unexpected end of CBOR data.");
+    }
+    return value;
+}
+
+/**
+ * Read argument of item head. Returns false for indefinite length.
+ */
+inline bool read_argument(const char *&begin, const char *end, uint8_t info, uint64_t &value) {
+    if (info < 24) {
+        value = info;
+    } else if (info == 24) {
+        value = read_be<uint8_t>(begin, end);
+    } else if (info == 25) {
+        value = read_be<uint16_t>(begin, end);
+    } else if (info == 26) {
+        value = read_be<uint32_t>(begin, end);
+    } else if (info == 27) {
+        value = read_be<uint64_t>(begin, end);
+    } else if (info == Indefinite) {
+        return false;
+    } else {
+        throw ParseException("Invalid CBOR item head.");
+    }
+    return true;
+}
+
+inline double half_to_double(uint16_t half) {
+    int exp = (half >> 10) & 0x1F;
+    int mant = half & 0x3FF;
+    double value;
+    if (exp == 0) {
+        value = std::ldexp(mant, -24);
+    } else if (exp != 31) {
+        value = std::ldexp(mant + 1024, exp - 25);
+    } else {
+        value = mant == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+    }
+    return (half & 0x8000) ? -value : value;
+}
+
+inline bool is_break(const char *begin, const char *end) {
+    if (begin == end) {
+        throw ParseException("Unexpected end of CBOR data.");
+    }
+    return static_cast<uint8_t>(*begin) == Break;
+}
+
+inline JsonValue read_value(const char *&begin, const char *end, int depth);
+
+inline void read_string_chunks(const char *&begin, const char *end, uint8_t major, uint8_t info, std::string &out) {
+    uint64_t size;
+    if (read_argument(begin, end, info, size)) {
+        if (static_cast<uint64_t>(end - begin) < size) {
+            throw ParseException("Unexpected end of CBOR data.");
+        }
+        out.append(begin, size);
+        begin += size;
+        return;
+    }
+
+    // Indefinite length string, sequence of definite length chunks of the same type.
+    while (!is_break(begin, end)) {
+        uint8_t head = static_cast<uint8_t>(*begin++);
+        if ((head >> 5) != major || (head & 0x1F) == Indefinite) {
+            throw ParseException("Invalid CBOR string chunk.");
+        }
+        read_string_chunks(begin, end, major, head & 0x1F, out);
+    }
+    ++begin;
+}
+
+inline JsonValue read_value(const char *&begin, const char *end, int depth) {
+    if (depth > MaxDecodeDepth) {
+        throw ParseException("CBOR data nested too deep.");
+    }
+
+    if (begin == end) {
+        throw ParseException("Unexpected end of CBOR data.");
+    }
+
+    uint8_t head = static_cast<uint8_t>(*begin++);
+    uint8_t major = head >> 5;
+    uint8_t info = head & 0x1F;
+    uint64_t arg = 0;
+
+    switch (major) {
+        case UnsignedInt:
+        case NegativeInt:
+            if (!read_argument(begin, end, info, arg)) {
+                throw ParseException("Invalid CBOR integer.");
+            }
+            if (arg > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                // Same as JSON parser, keep at least the magnitude.
+                double value = static_cast<double>(arg);
+                return make_double(major == UnsignedInt ? value : -1.0 - value);
+            }
+            return make_int(major == UnsignedInt ? static_cast<int64_t>(arg) : -1 - static_cast<int64_t>(arg));
+
+        case ByteString:
+        case TextString: {
+            std::string out;
+            read_string_chunks(begin, end, major, info, out);
+            return make_string(std::move(out));
+        }
+
+        case ArrayType: {
+            Array arr;
+            if (read_argument(begin, end, info, arg)) {
+                // Every item takes at least one byte, do not trust size blindly.
+                if (static_cast<uint64_t>(end - begin) < arg) {
+                    throw ParseException("Unexpected end of CBOR data.");
+                }
+                arr.reserve(arg);
+                for (uint64_t i = 0; i < arg; ++i) {
+                    arr.push_back(read_value(begin, end, depth + 1));
+                }
+            } else {
+                while (!is_break(begin, end)) {
+                    arr.push_back(read_value(begin, end, depth + 1));
+                }
+                ++begin;
+            }
+            return std::make_shared<Array>(std::move(arr));
+        }
+
+        case MapType: {
+            Object obj;
+            bool definite = read_argument(begin, end, info, arg);
+            if (definite && static_cast<uint64_t>(end - begin) / 2 < arg) {
+                throw ParseException("Unexpected end of CBOR data.");
+            }
+
+            for (uint64_t i = 0; definite ? i < arg : !is_break(begin, end); ++i) {
+                auto key = read_value(begin, end, depth + 1);
+                if (key->get_type() != ValueType::String) {
+                    throw ParseException("CBOR map key must be string.");
+                }
+                obj[to<String>(key).get_value()] = read_value(begin, end, depth + 1);
+            }
+
+            if (!definite) {
+                ++begin;
+            }
+            return std::make_shared<Object>(std::move(obj));
+        }
+
+        case Tag:
+            if (!read_argument(begin, end, info, arg)) {
+                throw ParseException("Invalid CBOR tag.");
+            }
+            return read_value(begin, end, depth + 1);
+
+        default:
+            switch (info) {
+                case 20: return make_bool(false);
+                case 21: return make_bool(true);
+                case 22:
+                case 23: return make_null();
+                case 25: return make_double(half_to_double(read_be<uint16_t>(begin, end)));
+                case 26: return make_double(bits_float(read_be<uint32_t>(begin, end)));
+                case 27: return make_double(bits_double(read_be<uint64_t>(begin, end)));
+                default:
+                    throw ParseException("Unsupported CBOR simple value " + std::to_string(info) + ".");
+            }
+    }
+}
+
+} // namespace detail
+
+/**
+ * Append CBOR representation of value to out.
+ */
+inline void write(std::string &out, const JsonValue &value) {
+    if (!value) {
+        out += '\xF6';
+        return;
+    }
+
+    switch (value->get_type()) {
+        case ValueType::Null:
+            out += '\xF6';
+            break;
+
+        case ValueType::Bool:
+            out += to<Bool>(value).get_value() ? '\xF5' : '\xF4';
+            break;
+
+        case ValueType::Int: {
+            int64_t v = to<Int>(value).get_value();
+            if (v >= 0) {
+                detail::write_head(out, detail::UnsignedInt, static_cast<uint64_t>(v));
+            } else {
+                detail::write_head(out, detail::NegativeInt, static_cast<uint64_t>(-1 - v));
+            }
+            break;
+        }
+
+        case ValueType::Double:
+            out += '\xFB';
+            detail::put_be(out, detail::double_bits(to<Double>(value).get_value()));
+            break;
+
+        case ValueType::String:
+            detail::write_string(out, to<String>(value).get_value());
+            break;
+
+        case ValueType::Array: {
+            auto &arr = to<Array>(value);
+            detail::write_head(out, detail::ArrayType, arr.size());
+            for (auto &item: arr) {
+                write(out, item);
+            }
+            break;
+        }
+
+        case ValueType::Object: {
+            auto &obj = to<Object>(value);
+            detail::write_head(out, detail::MapType, obj.size());
+            for (auto &item: obj) {
+                detail::write_string(out, item.first);
+                write(out, item.second);
+            }
+            break;
+        }
+    }
+}
+
+inline std::string encode(const JsonValue &value) {
+    std::string out;
+    write(out, value);
+    return out;
+}
+
+/**
+ * Decode one value starting at begin. On success, begin is moved after the value.
+ * Throws ParseException on malformed input.
+ */
+inline JsonValue decode(const char *&begin, const char *end) {
+    return detail::read_value(begin, end, 0);
+}
+
+} // namespace cbor
+} // namespace json
+} // namespace gcm
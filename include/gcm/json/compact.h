@@ -0,0 +1,683 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+#include "json.h"
+#include "detail/number.h"
+#include "detail/flat_map.h"
+
+/**
+ * Compact JSON value representation.
+ *
+ * compact::Value is 16 bytes large tagged union. Null, bools, numbers and
+ * strings up to 14 bytes are stored inline, longer strings, arrays and objects
+ * are stored in reference counted heap block. Type checks and conversions
+ * switch on the tag, so there are no virtual calls and no RTTI involved.
+ *
+ * Like JsonValue, copies of array, object or long string share the same
+ * storage, so modifying contents through one copy is visible in the others.
+ *
+ * Adapters for the shared_ptr based DOM are provided by from_json() and to_json().
+ * to<T>() accepts the DOM types (json::Int, json::String, ...) as tags, and
+ * Value has operator->(), so type checks written against JsonValue compile with
+ * compact values as well. Values are not the DOM classes though: to<Int>() and
+ * the other scalars return plain references and to<String>() returns std::string,
+ * so code calling get_value() or set_value() on them has to be changed.
+ */
+
+namespace gcm {
+namespace json {
+namespace compact {
+
+class Value;
+class Object;
+
+using Array = std::vector<Value>;
+
+namespace detail {
+
+/**
+ * Reference counted heap storage for values that do not fit inline.
+ */
+template<typename T>
+class Box {
+public:
+    template<typename... Args>
+    explicit Box(Args &&... args): refs(1), value(std::forward<Args>(args)...)
+    {}
+
+    std::atomic<uint32_t> refs;
+    T value;
+};
+
+template<typename T>
+struct Access;
+
+} // namespace detail
+
+class Value {
+public:
+    /**
+     * Longest string that is stored inline.
+     */
+    static constexpr const std::size_t SmallStringSize = 14;
+
+    enum class Tag: uint8_t {
+        Null, Bool, Int, Double, SmallString, String, Array, Object
+    };
+
+    Value() {
+        rep.header.tag = Tag::Null;
+    }
+
+    Value(std::nullptr_t): Value()
+    {}
+
+    explicit Value(bool value) {
+        rep.boolean.tag = Tag::Bool;
+        rep.boolean.value = value;
+    }
+
+    template<typename T, typename = std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>>
+    explicit Value(T value) {
+        rep.integer.tag = Tag::Int;
+        rep.integer.value = static_cast<int64_t>(value);
+    }
+
+    explicit Value(double value) {
+        rep.real.tag = Tag::Double;
+        rep.real.value = value;
+    }
+
+    explicit Value(const char *value): Value(value, std::strlen(value))
+    {}
+
+    Value(const char *data, std::size_t size) {
+        if (size <= SmallStringSize) {
+            rep.small.tag = Tag::SmallString;
+            rep.small.size = static_cast<uint8_t>(size);
+            std::memcpy(rep.small.chars, data, size);
+        } else {
+            rep.string.tag = Tag::String;
+            rep.string.value = new detail::Box<std::string>(data, size);
+        }
+    }
+
+    explicit Value(const std::string &value): Value(value.data(), value.size())
+    {}
+
+    explicit Value(std::string &&value) {
+        if (value.size() <= SmallStringSize) {
+            rep.small.tag = Tag::SmallString;
+            rep.small.size = static_cast<uint8_t>(value.size());
+            std::memcpy(rep.small.chars, value.data(), value.size());
+        } else {
+            rep.string.tag = Tag::String;
+            rep.string.value = new detail::Box<std::string>(std::move(value));
+        }
+    }
+
+    explicit Value(Array &&value) {
+        rep.array.tag = Tag::Array;
+        rep.array.value = new detail::Box<Array>(std::move(value));
+    }
+
+    explicit Value(Object &&value);
+
+    Value(const Value &other): rep(other.rep) {
+        acquire();
+    }
+
+    Value(Value &&other) noexcept: rep(other.rep) {
+        other.rep.header.tag = Tag::Null;
+    }
+
+    ~Value() {
+        release();
+    }
+
+    Value &operator=(const Value &other) {
+        Value tmp(other);
+        swap(tmp);
+        return *this;
+    }
+
+    Value &operator=(Value &&other) noexcept {
+        Value tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+    void swap(Value &other) noexcept {
+        std::swap(rep, other.rep);
+    }
+
+    Tag get_tag() const {
+        return rep.header.tag;
+    }
+
+    ValueType get_type() const {
+        switch (rep.header.tag) {
+            case Tag::Null: return ValueType::Null;
+            case Tag::Bool: return ValueType::Bool;
+            case Tag::Int: return ValueType::Int;
+            case Tag::Double: return ValueType::Double;
+            case Tag::SmallString: return ValueType::String;
+            case Tag::String: return ValueType::String;
+            case Tag::Array: return ValueType::Array;
+            case Tag::Object: return ValueType::Object;
+        }
+        return ValueType::Null;
+    }
+
+    bool is_null() const {
+        return rep.header.tag == Tag::Null;
+    }
+
+    /**
+     * True for anything else than null.
+     */
+    explicit operator bool() const {
+        return !is_null();
+    }
+
+    /**
+     * Pointer-like access, so code written for JsonValue (value->get_type(),
+     * value->to_string(), ...) compiles with compact values too.
+     */
+    Value *operator->() {
+        return this;
+    }
+
+    const Value *operator->() const {
+        return this;
+    }
+
+    bool &get_bool() {
+        check(Tag::Bool, ValueType::Bool);
+        return rep.boolean.value;
+    }
+
+    int64_t &get_int() {
+        check(Tag::Int, ValueType::Int);
+        return rep.integer.value;
+    }
+
+    double &get_double() {
+        check(Tag::Double, ValueType::Double);
+        return rep.real.value;
+    }
+
+    /**
+     * Pointer to string data, without copying. Valid as long as the value exists.
+     */
+    const char *string_data() const {
+        if (rep.header.tag == Tag::SmallString) {
+            return rep.small.chars;
+        }
+        check(Tag::String, ValueType::String);
+        return rep.string.value->value.data();
+    }
+
+    std::size_t string_size() const {
+        if (rep.header.tag == Tag::SmallString) {
+            return rep.small.size;
+        }
+        check(Tag::String, ValueType::String);
+        return rep.string.value->value.size();
+    }
+
+    std::string get_string() const {
+        return std::string(string_data(), string_size());
+    }
+
+    Array &get_array() {
+        check(Tag::Array, ValueType::Array);
+        return rep.array.value->value;
+    }
+
+    Object &get_object();
+
+    /**
+     * Append JSON representation of the value to out.
+     */
+    void write(std::string &out) const;
+
+    std::string to_string() const {
+        std::string out;
+        write(out);
+        return out;
+    }
+
+protected:
+    /**
+     * All members of the union start with the tag, so it can be always read
+     * through header (common initial sequence).
+     */
+    struct Header {
+        Tag tag;
+    };
+
+    struct Small {
+        Tag tag;
+        uint8_t size;
+        char chars[SmallStringSize];
+    };
+
+    template<typename T>
+    struct Scalar {
+        Tag tag;
+        T value;
+    };
+
+    union Rep {
+        Header header;
+        Small small;
+        Scalar<bool> boolean;
+        Scalar<int64_t> integer;
+        Scalar<double> real;
+        Scalar<detail::Box<std::string> *> string;
+        Scalar<detail::Box<Array> *> array;
+        Scalar<detail::Box<Object> *> object;
+    };
+
+    void check(Tag tag, ValueType type) const {
+        if (rep.header.tag != tag) {
+            throw TypeException("Conversion from " + str_type(get_type()) + " to " + str_type(type) + " requested.");
+        }
+    }
+
+    void acquire();
+
+    template<typename T>
+    static void release_box(detail::Box<T> *box) {
+        if (box->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete box;
+        }
+    }
+
+    void release();
+
+    Rep rep;
+};
+
+static_assert(sizeof(Value) == 16, "compact::Value is expected to be 16 bytes large.");
+
+/**
+ * JSON object of compact values. Keys are kept in insertion order.
+ */
+class Object: public json::detail::FlatMap<Value> {
+public:
+    bool has_key(const std::string &index) const {
+        return find(index) != end();
+    }
+};
+
+inline Value::Value(Object &&value) {
+    rep.object.tag = Tag::Object;
+    rep.object.value = new detail::Box<Object>(std::move(value));
+}
+
+inline Object &Value::get_object() {
+    check(Tag::Object, ValueType::Object);
+    return rep.object.value->value;
+}
+
+inline void Value::acquire() {
+    switch (rep.header.tag) {
+        case Tag::String: rep.string.value->refs.fetch_add(1, std::memory_order_relaxed); break;
+        case Tag::Array: rep.array.value->refs.fetch_add(1, std::memory_order_relaxed); break;
+        case Tag::Object: rep.object.value->refs.fetch_add(1, std::memory_order_relaxed); break;
+        default: break;
+    }
+}
+
+inline void Value::release() {
+    switch (rep.header.tag) {
+        case Tag::String: release_box(rep.string.value); break;
+        case Tag::Array: release_box(rep.array.value); break;
+        case Tag::Object: release_box(rep.object.value); break;
+        default: break;
+    }
+    rep.header.tag = Tag::Null;
+}
+
+inline void Value::write(std::string &out) const {
+    switch (rep.header.tag) {
+        case Tag::Null:
+            out += "null";
+            break;
+
+        case Tag::Bool:
+            out += rep.boolean.value ? "true" : "false";
+            break;
+
+        case Tag::Int: {
+            char buffer[json::detail::IntBufferSize];
+            out.append(buffer, json::detail::format_int(buffer, rep.integer.value));
+            break;
+        }
+
+        case Tag::Double: {
+            char buffer[json::detail::DoubleBufferSize];
+            out.append(buffer, json::detail::format_double(buffer, rep.real.value));
+            break;
+        }
+
+        case Tag::SmallString:
+            json::detail::write_string(out, rep.small.chars, rep.small.size);
+            break;
+
+        case Tag::String:
+            json::detail::write_string(out, rep.string.value->value.data(), rep.string.value->value.size());
+            break;
+
+        case Tag::Array: {
+            out += '[';
+            bool first = true;
+            for (auto &item: rep.array.value->value) {
+                if (!first) {
+                    out += ',';
+                }
+                first = false;
+                item.write(out);
+            }
+            out += ']';
+            break;
+        }
+
+        case Tag::Object: {
+            out += '{';
+            bool first = true;
+            for (auto &item: rep.object.value->value) {
+                if (!first) {
+                    out += ',';
+                }
+                first = false;
+                json::detail::write_string(out, item.first.data(), item.first.size());
+                out += ':';
+                item.second.write(out);
+            }
+            out += '}';
+            break;
+        }
+    }
+}
+
+namespace detail {
+
+template<>
+struct Access<json::Bool> {
+    static bool &get(Value &value) {
+        return value.get_bool();
+    }
+};
+
+template<>
+struct Access<json::Int> {
+    static int64_t &get(Value &value) {
+        return value.get_int();
+    }
+};
+
+template<>
+struct Access<json::Double> {
+    static double &get(Value &value) {
+        return value.get_double();
+    }
+};
+
+template<>
+struct Access<json::String> {
+    static std::string get(Value &value) {
+        return value.get_string();
+    }
+};
+
+template<>
+struct Access<json::Array> {
+    static Array &get(Value &value) {
+        return value.get_array();
+    }
+};
+
+template<>
+struct Access<Array> {
+    static Array &get(Value &value) {
+        return value.get_array();
+    }
+};
+
+template<>
+struct Access<json::Object> {
+    static Object &get(Value &value) {
+        return value.get_object();
+    }
+};
+
+template<>
+struct Access<Object> {
+    static Object &get(Value &value) {
+        return value.get_object();
+    }
+};
+
+} // namespace detail
+
+/**
+ * Typed access to compact value, with the same tags as for the DOM. Scalars
+ * are returned by reference to the inline storage, strings by value.
+ * Throws TypeException on type mismatch.
+ */
+template<typename T>
+auto to(Value &value) -> decltype(detail::Access<T>::get(value)) {
+    return detail::Access<T>::get(value);
+}
+
+template<typename T>
+auto to(const Value &value) -> decltype(detail::Access<T>::get(const_cast<Value &>(value))) {
+    return detail::Access<T>::get(const_cast<Value &>(value));
+}
+
+inline Value make_null() {
+    return Value();
+}
+
+inline Value make_bool(bool value) {
+    return Value(value);
+}
+
+template<typename T>
+std::enable_if_t<std::is_convertible<T, int64_t>::value, Value>
+make_int(T value) {
+    return Value(static_cast<int64_t>(value));
+}
+
+template<typename T>
+std::enable_if_t<std::is_enum<T>::value, Value>
+make_int(T value) {
+    return Value(static_cast<int64_t>(value));
+}
+
+template<typename T>
+std::enable_if_t<std::is_convertible<T, double>::value, Value>
+make_double(T value) {
+    return Value(static_cast<double>(value));
+}
+
+inline Value make_string(const std::string &value) {
+    return Value(value);
+}
+
+inline Value make_string(std::string &&value) {
+    return Value(std::move(value));
+}
+
+inline Value make_array() {
+    return Value(Array());
+}
+
+inline Value make_array(std::initializer_list<Value> values) {
+    return Value(Array(values));
+}
+
+inline Value make_array(Array &&values) {
+    return Value(std::move(values));
+}
+
+inline Value make_object() {
+    return Value(Object());
+}
+
+namespace detail {
+
+inline void fill_object(Object &) {
+}
+
+template<typename Head, typename... Tail>
+inline void fill_object(Object &obj, Head head, Tail... tail) {
+    obj.emplace(head.first, head.second);
+    fill_object(obj, tail...);
+}
+
+} // namespace detail
+
+/**
+ * Create object from list of key-value pairs. Keys are kept in given order; of
+ * duplicate keys, the first one wins.
+ */
+template<typename Head, typename... Tail>
+inline Value make_object(Head head, Tail... tail) {
+    Object obj;
+    obj.reserve(1 + sizeof...(Tail));
+    detail::fill_object(obj, head, tail...);
+    return Value(std::move(obj));
+}
+
+/**
+ * Convert DOM value to compact value (deep copy).
+ */
+inline Value from_json(const JsonValue &value) {
+    if (!value) {
+        return Value();
+    }
+
+    switch (value->get_type()) {
+        case ValueType::Null:
+            return Value();
+
+        case ValueType::Bool:
+            return Value(json::to<json::Bool>(value).get_value());
+
+        case ValueType::Int:
+            return Value(json::to<json::Int>(value).get_value());
+
+        case ValueType::Double:
+            return Value(json::to<json::Double>(value).get_value());
+
+        case ValueType::String:
+            return Value(json::to<json::String>(value).get_value());
+
+        case ValueType::Array: {
+            auto &arr = json::to<json::Array>(value);
+
+            Array out;
+            out.reserve(arr.size());
+            for (auto &item: arr) {
+                out.push_back(from_json(item));
+            }
+            return Value(std::move(out));
+        }
+
+        case ValueType::Object: {
+            auto &obj = json::to<json::Object>(value);
+
+            Object out;
+            out.reserve(obj.size());
+            for (auto &item: obj) {
+                out[item.first] = from_json(item.second);
+            }
+            return Value(std::move(out));
+        }
+    }
+
+    return Value();
+}
+
+/**
+ * Convert compact value to DOM value (deep copy).
+ */
+inline JsonValue to_json(const Value &value) {
+    Value &v = const_cast<Value &>(value);
+
+    switch (value.get_tag()) {
+        case Value::Tag::Null:
+            return json::make_null();
+
+        case Value::Tag::Bool:
+            return json::make_bool(v.get_bool());
+
+        case Value::Tag::Int:
+            return json::make_int(v.get_int());
+
+        case Value::Tag::Double:
+            return json::make_double(v.get_double());
+
+        case Value::Tag::SmallString:
+        case Value::Tag::String:
+            return json::make_string(v.get_string());
+
+        case Value::Tag::Array: {
+            json::Array out;
+            out.reserve(v.get_array().size());
+            for (auto &item: v.get_array()) {
+                out.push_back(to_json(item));
+            }
+            return std::make_shared<json::Array>(std::move(out));
+        }
+
+        case Value::Tag::Object: {
+            json::Object out;
+            out.reserve(v.get_object().size());
+            for (auto &item: v.get_object()) {
+                out[item.first] = to_json(item.second);
+            }
+            return std::make_shared<json::Object>(std::move(out));
+        }
+    }
+
+    return json::make_null();
+}
+
+} // namespace compact
+} // namespace json
+} // namespace gcm
@@ -0,0 +1,92 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace gcm {
+namespace json {
+namespace detail {
+
+/**
+ * Helpers for binary encodings (MessagePack, CBOR). Both use big-endian
+ * numbers.
+ */
+
+template<typename T>
+void put_be(std::string &out, T value) {
+    static_assert(std::is_unsigned<T>::value, "put_be works with unsigned types.");
+
+    char buffer[sizeof(T)];
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        buffer[i] = static_cast<char>(value >> (8 * (sizeof(T) - 1 - i)));
+    }
+    out.append(buffer, sizeof(T));
+}
+
+template<typename T>
+bool get_be(const char *&begin, const char *end, T &value) {
+    static_assert(std::is_unsigned<T>::value, "get_be works with unsigned types.");
+
+    if (static_cast<std::size_t>(end - begin) < sizeof(T)) {
+        return false;
+    }
+
+    value = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        value = static_cast<T>((value << 8) | static_cast<uint8_t>(begin[i]));
+    }
+    begin += sizeof(T);
+    return true;
+}
+
+inline uint64_t double_bits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline double bits_double(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline float bits_float(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * Maximum nesting of arrays and maps accepted by binary decoders.
+ */
+constexpr const int MaxDecodeDepth = 512;
+
+} // namespace detail
+} // namespace json
+} // namespace gcm
@@ -0,0 +1,281 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace gcm {
+namespace json {
+namespace detail {
+
+/**
+ * Whether byte can be copied to JSON string without escaping or UTF-8 validation.
+ */
+inline bool is_plain(unsigned char ch) {
+    return ch >= 0x20 && ch < 0x80 && ch != '"' && ch != '\\';
+}
+
+/**
+ * Return offset of first byte that can not be copied to JSON string as is: quote,
+ * backslash, control character or non-ASCII byte (which must be validated as
+ * UTF-8). Returns size if there is no such byte.
+ */
+inline std::size_t find_special(const char *data, std::size_t size) {
+    std::size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(0x20);
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+
+        // Signed compare catches both control characters (< 0x20) and bytes >= 0x80.
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmplt_epi8(chunk, space)
+        );
+
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#else
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t high = 0x8080808080808080ULL;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t chunk;
+        std::memcpy(&chunk, data + i, sizeof(chunk));
+
+        uint64_t quote = chunk ^ (ones * '"');
+        uint64_t backslash = chunk ^ (ones * '\\');
+        uint64_t special = ((quote - ones) & ~quote)
+            | ((backslash - ones) & ~backslash)
+            | (chunk - ones * 0x20)
+            | chunk;
+
+        if ((special & high) != 0) {
+            break;
+        }
+    }
+#endif
+
+    for (; i < size; ++i) {
+        if (!is_plain(static_cast<unsigned char>(data[i]))) {
+            return i;
+        }
+    }
+
+    return size;
+}
+
+/**
+ * Table driven UTF-8 validator (RFC 3629, no overlong forms and no surrogates).
+ * First 256 entries map bytes to character classes, rest is transition table
+ * indexed by state + class. State 0 is sequence boundary, Utf8Reject is error.
+ */
+constexpr const unsigned Utf8Reject = 12;
+
+inline unsigned utf8_next(unsigned state, unsigned char byte) {
+    static const uint8_t table[] = {
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,
+        7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7, 7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+        8,8,2,2,2,2,2,2,2,2,2,2,2,2,2,2, 2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
+        10,3,3,3,3,3,3,3,3,3,3,3,3,4,3,3, 11,6,6,6,5,8,8,8,8,8,8,8,8,8,8,8,
+
+        0,12,24,36,60,96,84,12,12,12,48,72, 12,12,12,12,12,12,12,12,12,12,12,12,
+        12,0,12,12,12,12,12,0,12,0,12,12, 12,24,12,12,12,12,12,24,12,24,12,12,
+        12,12,12,12,12,12,12,24,12,12,12,12, 12,24,12,12,12,12,12,12,12,24,12,12,
+        12,12,12,12,12,12,12,36,12,36,12,12, 12,36,12,12,12,12,12,36,12,36,12,12,
+        12,36,12,12,12,12,12,12,12,12,12,12,
+    };
+
+    return table[256 + state + table[byte]];
+}
+
+/**
+ * Length of valid UTF-8 text starting at data, stopping before first byte that
+ * needs escaping. If invalid or truncated sequence is found, returns false and
+ * length is the offset of that sequence's lead byte.
+ */
+inline bool utf8_run(const char *data, std::size_t size, std::size_t &length) {
+    unsigned state = 0;
+    std::size_t sequence = 0;
+    std::size_t i = 0;
+
+    for (; i < size; ++i) {
+        unsigned char ch = static_cast<unsigned char>(data[i]);
+        if (ch < 0x20 || ch == '"' || ch == '\\') {
+            break;
+        }
+
+        sequence = state == 0 ? i : sequence;
+        state = utf8_next(state, ch);
+        if (state == Utf8Reject) {
+            break;
+        }
+    }
+
+    length = state == 0 ? i : sequence;
+    return state == 0;
+}
+
+/**
+ * Length of prefix of data not longer than max that does not end inside of UTF-8
+ * sequence. Text is cut before lead byte of the sequence the cut would fall into.
+ */
+inline std::size_t utf8_prefix(const char *data, std::size_t size, std::size_t max) {
+    if (max >= size) {
+        return size;
+    }
+
+    // Lead byte is followed by at most three continuation bytes.
+    for (int i = 0; i < 3 && max > 0 && (static_cast<unsigned char>(data[max]) & 0xc0) == 0x80; ++i) {
+        --max;
+    }
+
+    return max;
+}
+
+/**
+ * Whether text can be written between quotes as it is, that is it has nothing
+ * write_string() would escape or replace.
+ */
+inline bool is_verbatim(const char *data, std::size_t size) {
+    std::size_t pos = 0;
+    while (pos < size) {
+        pos += find_special(data + pos, size - pos);
+        if (pos == size) {
+            break;
+        }
+
+        std::size_t run;
+        if (static_cast<unsigned char>(data[pos]) < 0x80 || !utf8_run(data + pos, size - pos, run) || run == 0) {
+            return false;
+        }
+        pos += run;
+    }
+
+    return true;
+}
+
+/**
+ * Append quoted and escaped JSON representation of string to out. Only quote,
+ * backslash and control characters are escaped, valid UTF-8 is copied unchanged
+ * and invalid bytes are replaced by U+FFFD.
+ */
+inline void write_string(std::string &out, const char *data, std::size_t size) {
+    static const char hex[] = "0123456789abcdef";
+
+    // Escapes and short runs are collected in local buffer, long runs are appended directly.
+    constexpr const std::size_t BufferSize = 256;
+    constexpr const std::size_t MaxEscape = 6;
+
+    char buffer[BufferSize];
+    std::size_t used = 0;
+
+    auto copy = [&](const char *run, std::size_t length) {
+        if (length > BufferSize - MaxEscape - used) {
+            out.append(buffer, used);
+            used = 0;
+            out.append(run, length);
+        } else {
+            std::memcpy(buffer + used, run, length);
+            used += length;
+        }
+    };
+
+    out.reserve(out.size() + size + 2);
+    out += '"';
+
+    std::size_t pos = 0;
+    while (pos < size) {
+        std::size_t run = find_special(data + pos, size - pos);
+        copy(data + pos, run);
+        pos += run;
+
+        if (pos == size) {
+            break;
+        }
+
+        unsigned char ch = static_cast<unsigned char>(data[pos]);
+        char *dst = buffer + used;
+
+        if (ch >= 0x80) {
+            bool valid = utf8_run(data + pos, size - pos, run);
+            copy(data + pos, run);
+            pos += run;
+
+            if (!valid) {
+                std::memcpy(buffer + used, "\\ufffd", 6);
+                used += 6;
+                ++pos;
+            }
+        } else {
+            ++pos;
+
+            switch (ch) {
+                case '"': dst[0] = '\\'; dst[1] = '"'; used += 2; break;
+                case '\\': dst[0] = '\\'; dst[1] = '\\'; used += 2; break;
+                case '\b': dst[0] = '\\'; dst[1] = 'b'; used += 2; break;
+                case '\f': dst[0] = '\\'; dst[1] = 'f'; used += 2; break;
+                case '\n': dst[0] = '\\'; dst[1] = 'n'; used += 2; break;
+                case '\r': dst[0] = '\\'; dst[1] = 'r'; used += 2; break;
+                case '\t': dst[0] = '\\'; dst[1] = 't'; used += 2; break;
+
+                default:
+                    std::memcpy(dst, "\\u00", 4);
+                    dst[4] = hex[ch >> 4];
+                    dst[5] = hex[ch & 0xF];
+                    used += 6;
+                    break;
+            }
+        }
+
+        if (used > BufferSize - MaxEscape) {
+            out.append(buffer, used);
+            used = 0;
+        }
+    }
+
+    out.append(buffer, used);
+    out += '"';
+}
+
+} // namespace detail
+} // namespace json
+} // namespace gcm
@@ -0,0 +1,237 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+namespace gcm {
+namespace json {
+namespace detail {
+
+/**
+ * Hash used to speed up key lookups in FlatMap (32bit FNV-1a).
+ */
+inline uint32_t hash_key(const char *key, std::size_t len) {
+    uint32_t hash = 2166136261u;
+    for (std::size_t i = 0; i < len; ++i) {
+        hash ^= static_cast<unsigned char>(key[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+inline uint32_t hash_key(const std::string &key) {
+    return hash_key(key.data(), key.size());
+}
+
+/**
+ * One key-value pair of FlatMap. Behaves like std::pair (first is key,
+ * second is value), but caches hash of the key. Key must not be modified
+ * in place.
+ */
+template<typename Mapped>
+class FlatMapItem: public std::pair<std::string, Mapped> {
+public:
+    FlatMapItem(std::string &&key, uint32_t hash, Mapped &&value):
+        std::pair<std::string, Mapped>(std::move(key), std::move(value)),
+        hash(hash)
+    {}
+
+    uint32_t get_hash() const {
+        return hash;
+    }
+
+protected:
+    uint32_t hash;
+};
+
+/**
+ * String keyed map, that stores items in one flat vector in insertion order.
+ * Items are looked up by linear scan comparing cached key hashes first. JSON
+ * objects usually have just a few keys, where this is both faster and far
+ * less allocation heavy than tree based map.
+ *
+ * Interface mimics the subset of std::map that is used by the code.
+ */
+template<typename Mapped>
+class FlatMap {
+public:
+    using key_type = std::string;
+    using mapped_type = Mapped;
+    using value_type = FlatMapItem<Mapped>;
+    using container_type = std::vector<value_type>;
+    using iterator = typename container_type::iterator;
+    using const_iterator = typename container_type::const_iterator;
+    using size_type = typename container_type::size_type;
+
+    /**
+     * Capacity reserved on first insert, covering most of the JSON-RPC objects.
+     */
+    static constexpr const size_type InitialCapacity = 4;
+
+    mapped_type &operator[](const std::string &key) {
+        uint32_t hash = hash_key(key);
+        auto it = find(key, hash);
+        if (it != end()) {
+            return it->second;
+        }
+        return append(std::string(key), hash, mapped_type());
+    }
+
+    mapped_type &operator[](std::string &&key) {
+        uint32_t hash = hash_key(key);
+        auto it = find(key, hash);
+        if (it != end()) {
+            return it->second;
+        }
+        return append(std::move(key), hash, mapped_type());
+    }
+
+    mapped_type &at(const std::string &key) {
+        auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("Object does not have key " + key + ".");
+        }
+        return it->second;
+    }
+
+    const mapped_type &at(const std::string &key) const {
+        auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("Object does not have key " + key + ".");
+        }
+        return it->second;
+    }
+
+    iterator find(const std::string &key) {
+        return find(key, hash_key(key));
+    }
+
+    const_iterator find(const std::string &key) const {
+        return const_cast<FlatMap *>(this)->find(key, hash_key(key));
+    }
+
+    /**
+     * Find key whose hash is already known, e.g. precomputed for a fixed set of keys.
+     */
+    iterator find(const std::string &key, uint32_t hash) {
+        for (auto it = items.begin(); it != items.end(); ++it) {
+            if (it->get_hash() == hash && it->first == key) {
+                return it;
+            }
+        }
+        return items.end();
+    }
+
+    size_type count(const std::string &key) const {
+        return find(key) != end() ? 1 : 0;
+    }
+
+    /**
+     * Insert value under key, if the key does not exist yet.
+     */
+    std::pair<iterator, bool> emplace(std::string key, mapped_type value) {
+        uint32_t hash = hash_key(key);
+        auto it = find(key, hash);
+        if (it != end()) {
+            return std::make_pair(it, false);
+        }
+
+        append(std::move(key), hash, std::move(value));
+        return std::make_pair(items.end() - 1, true);
+    }
+
+    iterator erase(const_iterator pos) {
+        return items.erase(pos);
+    }
+
+    size_type erase(const std::string &key) {
+        auto it = find(key);
+        if (it != end()) {
+            items.erase(it);
+            return 1;
+        }
+        return 0;
+    }
+
+    void clear() {
+        items.clear();
+    }
+
+    void reserve(size_type capacity) {
+        items.reserve(capacity);
+    }
+
+    size_type size() const {
+        return items.size();
+    }
+
+    bool empty() const {
+        return items.empty();
+    }
+
+    iterator begin() {
+        return items.begin();
+    }
+
+    iterator end() {
+        return items.end();
+    }
+
+    const_iterator begin() const {
+        return items.begin();
+    }
+
+    const_iterator end() const {
+        return items.end();
+    }
+
+    const_iterator cbegin() const {
+        return items.cbegin();
+    }
+
+    const_iterator cend() const {
+        return items.cend();
+    }
+
+protected:
+    mapped_type &append(std::string &&key, uint32_t hash, mapped_type &&value) {
+        if (items.capacity() == 0) {
+            items.reserve(InitialCapacity);
+        }
+
+        items.emplace_back(std::move(key), hash, std::move(value));
+        return items.back().second;
+    }
+
+    container_type items;
+};
+
+} // namespace detail
+} // namespace json
+} // namespace gcm
@@ -0,0 +1,706 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <cfloat>
+#include <cmath>
+#include <string>
+#include <limits>
+#include <iterator>
+#include <algorithm>
+
+#include <locale.h>
+
+/**
+ * Locale independent conversion of JSON numbers from and to their textual
+ * representation. Integers are parsed and formatted by hand, doubles are
+ * parsed using exact fast path (with fallback to strtod in "C" locale) and
+ * formatted using the Grisu2 algorithm, which produces the shortest (in
+ * vast majority of cases) representation that round-trips back to the same
+ * double value.
+ */
+
+namespace gcm {
+namespace json {
+namespace detail {
+
+/**
+ * Size of buffer that is large enough to hold any int64_t formatted by format_int().
+ */
+constexpr std::size_t IntBufferSize = 21;
+
+/**
+ * Size of buffer that is large enough to hold any double formatted by format_double().
+ */
+constexpr std::size_t DoubleBufferSize = 32;
+
+static const char DigitPairs[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/**
+ * Write decimal representation of unsigned value to buffer. Returns pointer past last written character.
+ */
+inline char *format_uint(char *buf, uint64_t value) {
+    char tmp[IntBufferSize];
+    char *p = tmp + sizeof(tmp);
+
+    while (value >= 100) {
+        std::size_t i = (value % 100) * 2;
+        value /= 100;
+        *--p = DigitPairs[i + 1];
+        *--p = DigitPairs[i];
+    }
+
+    if (value >= 10) {
+        std::size_t i = value * 2;
+        *--p = DigitPairs[i + 1];
+        *--p = DigitPairs[i];
+    } else {
+        *--p = static_cast<char>('0' + value);
+    }
+
+    std::size_t len = tmp + sizeof(tmp) - p;
+    std::memcpy(buf, p, len);
+    return buf + len;
+}
+
+/**
+ * Write decimal representation of signed value to buffer. Returns pointer past last written character.
+ */
+inline char *format_int(char *buf, int64_t value) {
+    uint64_t abs = static_cast<uint64_t>(value);
+    if (value < 0) {
+        *buf++ = '-';
+        abs = 0 - abs;
+    }
+    return format_uint(buf, abs);
+}
+
+/**
+ * Parse integer from [begin, end). Returns false if input is not an integer
+ * or when it does not fit into int64_t.
+ */
+template<typename I>
+bool parse_int(I begin, I end, int64_t &out) {
+    bool negative = false;
+    if (begin != end && (*begin == '-' || *begin == '+')) {
+        negative = (*begin == '-');
+        ++begin;
+    }
+
+    if (begin == end) {
+        return false;
+    }
+
+    const uint64_t limit = negative
+        ? static_cast<uint64_t>(INT64_MAX) + 1
+        : static_cast<uint64_t>(INT64_MAX);
+
+    uint64_t result = 0;
+    for (; begin != end; ++begin) {
+        unsigned digit = static_cast<unsigned char>(*begin) - '0';
+        if (digit > 9) {
+            return false;
+        }
+
+        if (result > (limit - digit) / 10) {
+            return false;
+        }
+
+        result = result * 10 + digit;
+    }
+
+    out = negative ? static_cast<int64_t>(0 - result) : static_cast<int64_t>(result);
+    return true;
+}
+
+/**
+ * Return "C" locale used for locale independent conversions done by libc.
+ */
+inline locale_t c_locale() {
+    static locale_t locale = newlocale(LC_ALL_MASK, "C", static_cast<locale_t>(0));
+    return locale;
+}
+
+/**
+ * Parse double using strtod in "C" locale. Used for inputs that cannot be
+ * converted exactly by the fast path.
+ */
+template<typename I>
+bool parse_double_slow(I begin, I end, double &out) {
+    char buffer[128];
+    std::string long_buffer;
+    const char *input;
+
+    std::size_t len = static_cast<std::size_t>(std::distance(begin, end));
+    if (len < sizeof(buffer)) {
+        std::copy(begin, end, buffer);
+        buffer[len] = '\0';
+        input = buffer;
+    } else {
+        long_buffer.assign(begin, end);
+        input = long_buffer.c_str();
+    }
+
+    char *parsed_end;
+    out = strtod_l(input, &parsed_end, c_locale());
+    return parsed_end == input + len && !std::isinf(out);
+}
+
+/**
+ * Parse JSON number from [begin, end). Returns false when input is not
+ * a number or when it is out of range of double.
+ */
+template<typename I>
+bool parse_double(I begin, I end, double &out) {
+    static const double Pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    I it = begin;
+
+    bool negative = false;
+    if (it != end && (*it == '-' || *it == '+')) {
+        negative = (*it == '-');
+        ++it;
+    }
+
+    uint64_t mantissa = 0;
+    int num_digits = 0;
+    int exponent = 0;
+    bool truncated = false;
+    bool has_digits = false;
+
+    // Integer part.
+    for (; it != end; ++it) {
+        unsigned digit = static_cast<unsigned char>(*it) - '0';
+        if (digit > 9) {
+            break;
+        }
+
+        has_digits = true;
+        if (num_digits < 19) {
+            mantissa = mantissa * 10 + digit;
+            if (mantissa > 0) {
+                ++num_digits;
+            }
+        } else {
+            ++exponent;
+            truncated |= (digit != 0);
+        }
+    }
+
+    if (!has_digits) {
+        return false;
+    }
+
+    // Fraction part.
+    if (it != end && *it == '.') {
+        ++it;
+
+        bool has_fraction = false;
+        for (; it != end; ++it) {
+            unsigned digit = static_cast<unsigned char>(*it) - '0';
+            if (digit > 9) {
+                break;
+            }
+
+            has_fraction = true;
+            if (num_digits < 19) {
+                mantissa = mantissa * 10 + digit;
+                if (mantissa > 0) {
+                    ++num_digits;
+                }
+                --exponent;
+            } else {
+                truncated |= (digit != 0);
+            }
+        }
+
+        if (!has_fraction) {
+            return false;
+        }
+    }
+
+    // Exponent part.
+    if (it != end && (*it == 'e' || *it == 'E')) {
+        ++it;
+
+        bool exp_negative = false;
+        if (it != end && (*it == '-' || *it == '+')) {
+            exp_negative = (*it == '-');
+            ++it;
+        }
+
+        int exp_value = 0;
+        bool has_exponent = false;
+        for (; it != end; ++it) {
+            unsigned digit = static_cast<unsigned char>(*it) - '0';
+            if (digit > 9) {
+                break;
+            }
+
+            has_exponent = true;
+            if (exp_value < 100000) {
+                exp_value = exp_value * 10 + static_cast<int>(digit);
+            }
+        }
+
+        if (!has_exponent) {
+            return false;
+        }
+
+        exponent += exp_negative ? -exp_value : exp_value;
+    }
+
+    if (it != end) {
+        return false;
+    }
+
+    if (mantissa == 0 && !truncated) {
+        out = negative ? -0.0 : 0.0;
+        return true;
+    }
+
+#if FLT_EVAL_METHOD == 0
+    // Both mantissa and power of ten are exactly representable, so the single
+    // multiplication or division is correctly rounded.
+    if (!truncated && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        double value = static_cast<double>(mantissa);
+        if (exponent < 0) {
+            value /= Pow10[-exponent];
+        } else {
+            value *= Pow10[exponent];
+        }
+
+        out = negative ? -value : value;
+        return true;
+    }
+#endif
+
+    return parse_double_slow(begin, end, out);
+}
+
+namespace grisu {
+
+/**
+ * Floating point number with 64bit significand and binary exponent, without
+ * normalization and sign.
+ */
+struct DiyFp {
+    uint64_t f;
+    int e;
+
+    constexpr DiyFp(uint64_t f, int e): f(f), e(e)
+    {}
+
+    static DiyFp sub(const DiyFp &x, const DiyFp &y) {
+        return DiyFp(x.f - y.f, x.e);
+    }
+
+    /**
+     * Returns x * y, rounded to 64 bits of significand.
+     */
+    static DiyFp mul(const DiyFp &x, const DiyFp &y) {
+        const uint64_t u_lo = x.f & 0xFFFFFFFFu;
+        const uint64_t u_hi = x.f >> 32;
+        const uint64_t v_lo = y.f & 0xFFFFFFFFu;
+        const uint64_t v_hi = y.f >> 32;
+
+        const uint64_t p0 = u_lo * v_lo;
+        const uint64_t p1 = u_lo * v_hi;
+        const uint64_t p2 = u_hi * v_lo;
+        const uint64_t p3 = u_hi * v_hi;
+
+        uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+        q += uint64_t(1) << 31;
+
+        const uint64_t h = p3 + (p1 >> 32) + (p2 >> 32) + (q >> 32);
+        return DiyFp(h, x.e + y.e + 64);
+    }
+
+    static DiyFp normalize(DiyFp x) {
+        while ((x.f >> 63) == 0) {
+            x.f <<= 1;
+            x.e--;
+        }
+        return x;
+    }
+
+    static DiyFp normalize_to(const DiyFp &x, int target_exponent) {
+        return DiyFp(x.f << (x.e - target_exponent), target_exponent);
+    }
+};
+
+struct Boundaries {
+    DiyFp w;
+    DiyFp minus;
+    DiyFp plus;
+};
+
+/**
+ * Compute normalized value of v and its lower and upper boundaries (halfway
+ * to the neighbouring doubles). v must be finite and positive.
+ */
+inline Boundaries compute_boundaries(double v) {
+    constexpr int Precision = std::numeric_limits<double>::digits;
+    constexpr int Bias = std::numeric_limits<double>::max_exponent - 1 + (Precision - 1);
+    constexpr int MinExp = 1 - Bias;
+    constexpr uint64_t HiddenBit = uint64_t(1) << (Precision - 1);
+
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+
+    const uint64_t e_bits = bits >> (Precision - 1);
+    const uint64_t f_bits = bits & (HiddenBit - 1);
+
+    const bool is_denormal = (e_bits == 0);
+    const DiyFp value = is_denormal
+        ? DiyFp(f_bits, MinExp)
+        : DiyFp(f_bits + HiddenBit, static_cast<int>(e_bits) - Bias);
+
+    // Lower boundary is closer if v is power of two (except for the smallest normal).
+    const bool lower_is_closer = (f_bits == 0 && e_bits > 1);
+
+    const DiyFp m_plus(2 * value.f + 1, value.e - 1);
+    const DiyFp m_minus = lower_is_closer
+        ? DiyFp(4 * value.f - 1, value.e - 2)
+        : DiyFp(2 * value.f - 1, value.e - 1);
+
+    const DiyFp w_plus = DiyFp::normalize(m_plus);
+    const DiyFp w_minus = DiyFp::normalize_to(m_minus, w_plus.e);
+
+    return {DiyFp::normalize(value), w_minus, w_plus};
+}
+
+constexpr int Alpha = -60;
+constexpr int Gamma = -32;
+
+struct CachedPower {
+    uint64_t f;
+    int e;
+    int k;
+};
+
+/**
+ * Return normalized cached power of ten c = f * 2^e = 10^k, such that
+ * binary exponent of value with exponent e multiplied by c lies in
+ * [Alpha, Gamma].
+ */
+inline CachedPower get_cached_power(int e) {
+    constexpr int MinDecExp = -300;
+    constexpr int DecStep = 8;
+
+    static const CachedPower Powers[] = {
+            {0xAB70FE17C79AC6CA, -1060, -300},
+            {0xFF77B1FCBEBCDC4F, -1034, -292},
+            {0xBE5691EF416BD60C, -1007, -284},
+            {0x8DD01FAD907FFC3C,  -980, -276},
+            {0xD3515C2831559A83,  -954, -268},
+            {0x9D71AC8FADA6C9B5,  -927, -260},
+            {0xEA9C227723EE8BCB,  -901, -252},
+            {0xAECC49914078536D,  -874, -244},
+            {0x823C12795DB6CE57,  -847, -236},
+            {0xC21094364DFB5637,  -821, -228},
+            {0x9096EA6F3848984F,  -794, -220},
+            {0xD77485CB25823AC7,  -768, -212},
+            {0xA086CFCD97BF97F4,  -741, -204},
+            {0xEF340A98172AACE5,  -715, -196},
+            {0xB23867FB2A35B28E,  -688, -188},
+            {0x84C8D4DFD2C63F3B,  -661, -180},
+            {0xC5DD44271AD3CDBA,  -635, -172},
+            {0x936B9FCEBB25C996,  -608, -164},
+            {0xDBAC6C247D62A584,  -582, -156},
+            {0xA3AB66580D5FDAF6,  -555, -148},
+            {0xF3E2F893DEC3F126,  -529, -140},
+            {0xB5B5ADA8AAFF80B8,  -502, -132},
+            {0x87625F056C7C4A8B,  -475, -124},
+            {0xC9BCFF6034C13053,  -449, -116},
+            {0x964E858C91BA2655,  -422, -108},
+            {0xDFF9772470297EBD,  -396, -100},
+            {0xA6DFBD9FB8E5B88F,  -369,  -92},
+            {0xF8A95FCF88747D94,  -343,  -84},
+            {0xB94470938FA89BCF,  -316,  -76},
+            {0x8A08F0F8BF0F156B,  -289,  -68},
+            {0xCDB02555653131B6,  -263,  -60},
+            {0x993FE2C6D07B7FAC,  -236,  -52},
+            {0xE45C10C42A2B3B06,  -210,  -44},
+            {0xAA242499697392D3,  -183,  -36},
+            {0xFD87B5F28300CA0E,  -157,  -28},
+            {0xBCE5086492111AEB,  -130,  -20},
+            {0x8CBCCC096F5088CC,  -103,  -12},
+            {0xD1B71758E219652C,   -77,   -4},
+            {0x9C40000000000000,   -50,    4},
+            {0xE8D4A51000000000,   -24,   12},
+            {0xAD78EBC5AC620000,     3,   20},
+            {0x813F3978F8940984,    30,   28},
+            {0xC097CE7BC90715B3,    56,   36},
+            {0x8F7E32CE7BEA5C70,    83,   44},
+            {0xD5D238A4ABE98068,   109,   52},
+            {0x9F4F2726179A2245,   136,   60},
+            {0xED63A231D4C4FB27,   162,   68},
+            {0xB0DE65388CC8ADA8,   189,   76},
+            {0x83C7088E1AAB65DB,   216,   84},
+            {0xC45D1DF942711D9A,   242,   92},
+            {0x924D692CA61BE758,   269,  100},
+            {0xDA01EE641A708DEA,   295,  108},
+            {0xA26DA3999AEF774A,   322,  116},
+            {0xF209787BB47D6B85,   348,  124},
+            {0xB454E4A179DD1877,   375,  132},
+            {0x865B86925B9BC5C2,   402,  140},
+            {0xC83553C5C8965D3D,   428,  148},
+            {0x952AB45CFA97A0B3,   455,  156},
+            {0xDE469FBD99A05FE3,   481,  164},
+            {0xA59BC234DB398C25,   508,  172},
+            {0xF6C69A72A3989F5C,   534,  180},
+            {0xB7DCBF5354E9BECE,   561,  188},
+            {0x88FCF317F22241E2,   588,  196},
+            {0xCC20CE9BD35C78A5,   614,  204},
+            {0x98165AF37B2153DF,   641,  212},
+            {0xE2A0B5DC971F303A,   667,  220},
+            {0xA8D9D1535CE3B396,   694,  228},
+            {0xFB9B7CD9A4A7443C,   720,  236},
+            {0xBB764C4CA7A44410,   747,  244},
+            {0x8BAB8EEFB6409C1A,   774,  252},
+            {0xD01FEF10A657842C,   800,  260},
+            {0x9B10A4E5E9913129,   827,  268},
+            {0xE7109BFBA19C0C9D,   853,  276},
+            {0xAC2820D9623BF429,   880,  284},
+            {0x80444B5E7AA7CF85,   907,  292},
+            {0xBF21E44003ACDD2D,   933,  300},
+            {0x8E679C2F5E44FF8F,   960,  308},
+            {0xD433179D9C8CB841,   986,  316},
+            {0x9E19DB92B4E31BA9,  1013,  324}
+    };
+
+    const int f = Alpha - e - 1;
+    const int k = (f * 78913) / (1 << 18) + static_cast<int>(f > 0);
+    const int index = (-MinDecExp + k + (DecStep - 1)) / DecStep;
+
+    return Powers[index];
+}
+
+/**
+ * Return number of decimal digits of n and largest power of ten that is <= n.
+ */
+inline int find_largest_pow10(uint32_t n, uint32_t &pow10) {
+    static const uint32_t Powers[] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+    };
+
+    int digits = 10;
+    while (digits > 1 && n < Powers[digits - 1]) {
+        --digits;
+    }
+
+    pow10 = Powers[digits - 1];
+    return digits;
+}
+
+inline void round(char *buf, int len, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k) {
+    while (rest < dist
+        && delta - rest >= ten_k
+        && (rest + ten_k < dist || dist - rest > rest + ten_k - dist))
+    {
+        buf[len - 1]--;
+        rest += ten_k;
+    }
+}
+
+/**
+ * Generate shortest digits of value in range (M_minus, M_plus), closest to w.
+ */
+inline void digit_gen(char *buffer, int &length, int &decimal_exponent, DiyFp M_minus, DiyFp w, DiyFp M_plus) {
+    uint64_t delta = DiyFp::sub(M_plus, M_minus).f;
+    uint64_t dist = DiyFp::sub(M_plus, w).f;
+
+    const DiyFp one(uint64_t(1) << -M_plus.e, M_plus.e);
+
+    uint32_t p1 = static_cast<uint32_t>(M_plus.f >> -one.e);
+    uint64_t p2 = M_plus.f & (one.f - 1);
+
+    // Integral digits.
+    uint32_t pow10;
+    int n = find_largest_pow10(p1, pow10);
+
+    while (n > 0) {
+        const uint32_t d = p1 / pow10;
+        p1 %= pow10;
+
+        buffer[length++] = static_cast<char>('0' + d);
+        --n;
+
+        const uint64_t rest = (uint64_t(p1) << -one.e) + p2;
+        if (rest <= delta) {
+            decimal_exponent += n;
+            round(buffer, length, dist, delta, rest, uint64_t(pow10) << -one.e);
+            return;
+        }
+
+        pow10 /= 10;
+    }
+
+    // Fractional digits.
+    int m = 0;
+    while (true) {
+        p2 *= 10;
+        const uint64_t d = p2 >> -one.e;
+        p2 &= one.f - 1;
+
+        buffer[length++] = static_cast<char>('0' + d);
+        ++m;
+
+        delta *= 10;
+        dist *= 10;
+
+        if (p2 <= delta) {
+            break;
+        }
+    }
+
+    decimal_exponent -= m;
+    round(buffer, length, dist, delta, p2, one.f);
+}
+
+/**
+ * Generate digits of positive finite value v to buffer. Value is then buffer * 10^decimal_exponent.
+ */
+inline void grisu2(char *buffer, int &length, int &decimal_exponent, double v) {
+    const Boundaries b = compute_boundaries(v);
+    const CachedPower cached = get_cached_power(b.plus.e);
+    const DiyFp c_minus_k(cached.f, cached.e);
+
+    const DiyFp w = DiyFp::mul(b.w, c_minus_k);
+    const DiyFp w_minus = DiyFp::mul(b.minus, c_minus_k);
+    const DiyFp w_plus = DiyFp::mul(b.plus, c_minus_k);
+
+    // Shrink the interval by one ulp on each side to be safe from the rounding errors of mul.
+    const DiyFp M_minus(w_minus.f + 1, w_minus.e);
+    const DiyFp M_plus(w_plus.f - 1, w_plus.e);
+
+    length = 0;
+    decimal_exponent = -cached.k;
+    digit_gen(buffer, length, decimal_exponent, M_minus, w, M_plus);
+}
+
+/**
+ * Append exponent in format e+N or e-N.
+ */
+inline char *append_exponent(char *buf, int e) {
+    if (e < 0) {
+        e = -e;
+        *buf++ = '-';
+    } else {
+        *buf++ = '+';
+    }
+    return format_uint(buf, static_cast<uint64_t>(e));
+}
+
+/**
+ * Format digits produced by grisu2 into decimal or scientific notation.
+ * The result always contains decimal point or exponent, so it is parsed back as double.
+ */
+inline char *format_buffer(char *buf, int k, int decimal_exponent, int min_exp, int max_exp) {
+    const int n = k + decimal_exponent;
+
+    if (k <= n && n <= max_exp) {
+        // digits[000].0
+        std::memset(buf + k, '0', static_cast<std::size_t>(n - k));
+        buf[n] = '.';
+        buf[n + 1] = '0';
+        return buf + n + 2;
+    }
+
+    if (0 < n && n <= max_exp) {
+        // dig.its
+        std::memmove(buf + n + 1, buf + n, static_cast<std::size_t>(k - n));
+        buf[n] = '.';
+        return buf + k + 1;
+    }
+
+    if (min_exp < n && n <= 0) {
+        // 0.[000]digits
+        std::memmove(buf + 2 + (-n), buf, static_cast<std::size_t>(k));
+        buf[0] = '0';
+        buf[1] = '.';
+        std::memset(buf + 2, '0', static_cast<std::size_t>(-n));
+        return buf + 2 + (-n) + k;
+    }
+
+    if (k == 1) {
+        // dE+123
+        buf += 1;
+    } else {
+        // d.igitsE+123
+        std::memmove(buf + 2, buf + 1, static_cast<std::size_t>(k - 1));
+        buf[1] = '.';
+        buf += 1 + k;
+    }
+
+    *buf++ = 'e';
+    return append_exponent(buf, n - 1);
+}
+
+} // namespace grisu
+
+/**
+ * Write shortest representation of value that round-trips back to the same double.
+ * Non-finite values are not representable in JSON, so they are written as null.
+ * Returns pointer past last written character.
+ */
+inline char *format_double(char *buf, double value) {
+    if (!std::isfinite(value)) {
+        std::memcpy(buf, "null", 4);
+        return buf + 4;
+    }
+
+    if (std::signbit(value)) {
+        *buf++ = '-';
+        value = -value;
+    }
+
+    if (value == 0) {
+        std::memcpy(buf, "0.0", 3);
+        return buf + 3;
+    }
+
+    int length;
+    int decimal_exponent;
+    grisu::grisu2(buf, length, decimal_exponent, value);
+
+    return grisu::format_buffer(buf, length, decimal_exponent, -4, 15);
+}
+
+} // namespace detail
+} // namespace json
+} // namespace gcm
@@ -0,0 +1,343 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include "escape.h"
+
+namespace gcm {
+namespace json {
+namespace detail {
+
+/**
+ * Scanning of JSON text. skip_value() only finds where values start and end
+ * (matching brackets, strings with escapes), the contents are checked when the
+ * value is actually parsed. skip_valid_value() checks the whole value, for text
+ * that is written to output without being parsed.
+ */
+
+inline bool is_ws(char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+inline const char *skip_ws(const char *begin, const char *end) {
+    while (begin != end && is_ws(*begin)) {
+        ++begin;
+    }
+    return begin;
+}
+
+/**
+ * Skip string starting at begin (which must point to opening quote). On success,
+ * begin points after the closing quote.
+ */
+inline bool skip_string(const char *&begin, const char *end) {
+    const char *p = begin + 1;
+    while (p != end) {
+        if (*p == '\\') {
+            if (++p == end) {
+                return false;
+            }
+        } else if (*p == '"') {
+            begin = p + 1;
+            return true;
+        }
+        ++p;
+    }
+    return false;
+}
+
+/**
+ * Skip one JSON value starting at begin. On success, begin points right after
+ * the value. On failure, begin is left untouched.
+ */
+inline bool skip_value(const char *&begin, const char *end) {
+    const char *p = begin;
+    if (p == end) {
+        return false;
+    }
+
+    // Scalar value. Runs to next delimiter.
+    if (*p != '{' && *p != '[') {
+        if (*p == '"') {
+            if (!skip_string(p, end)) {
+                return false;
+            }
+        } else {
+            while (p != end && !is_ws(*p) && *p != ',' && *p != ':' && *p != ']' && *p != '}') {
+                ++p;
+            }
+            if (p == begin) {
+                return false;
+            }
+        }
+        begin = p;
+        return true;
+    }
+
+    // Composite value. Keep stack of expected closing brackets.
+    std::string expected;
+    while (p != end) {
+        char ch = *p;
+        if (ch == '"') {
+            if (!skip_string(p, end)) {
+                return false;
+            }
+            continue;
+        } else if (ch == '{') {
+            expected += '}';
+        } else if (ch == '[') {
+            expected += ']';
+        } else if (ch == '}' || ch == ']') {
+            if (expected.empty() || expected.back() != ch) {
+                return false;
+            }
+            expected.pop_back();
+            if (expected.empty()) {
+                begin = p + 1;
+                return true;
+            }
+        }
+        ++p;
+    }
+
+    return false;
+}
+
+inline bool is_digit(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+/**
+ * Skip string starting at begin (which must point to opening quote), checking that
+ * escapes are valid, there are no control characters and text is valid UTF-8. On
+ * success, begin points after the closing quote, otherwise to the place of error.
+ */
+inline bool skip_valid_string(const char *&begin, const char *end) {
+    const char *p = begin + 1;
+
+    while (p != end) {
+        p += find_special(p, end - p);
+        if (p == end) {
+            break;
+        }
+
+        unsigned char ch = static_cast<unsigned char>(*p);
+        if (ch == '"') {
+            begin = p + 1;
+            return true;
+        } else if (ch == '\\') {
+            if (++p == end) {
+                break;
+            }
+
+            if (*p == 'u') {
+                for (int i = 0; i < 4; ++i) {
+                    if (++p == end || !std::isxdigit(static_cast<unsigned char>(*p))) {
+                        begin = p;
+                        return false;
+                    }
+                }
+            } else if (std::strchr("\"\\/bfnrt", *p) == nullptr || *p == '\0') {
+                begin = p;
+                return false;
+            }
+            ++p;
+        } else if (ch >= 0x80) {
+            std::size_t length;
+            if (!utf8_run(p, end - p, length)) {
+                begin = p + length;
+                return false;
+            }
+            p += length;
+        } else {
+            // Control character.
+            begin = p;
+            return false;
+        }
+    }
+
+    begin = p;
+    return false;
+}
+
+/**
+ * Skip number in JSON grammar: optional minus, integer part without leading zeros,
+ * optional fraction and exponent.
+ */
+inline bool skip_valid_number(const char *&p, const char *end) {
+    if (p != end && *p == '-') {
+        ++p;
+    }
+
+    if (p == end || !is_digit(*p)) {
+        return false;
+    }
+
+    if (*p == '0') {
+        ++p;
+    } else {
+        while (p != end && is_digit(*p)) {
+            ++p;
+        }
+    }
+
+    if (p != end && *p == '.') {
+        if (++p == end || !is_digit(*p)) {
+            return false;
+        }
+        while (p != end && is_digit(*p)) {
+            ++p;
+        }
+    }
+
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        if (++p != end && (*p == '+' || *p == '-')) {
+            ++p;
+        }
+        if (p == end || !is_digit(*p)) {
+            return false;
+        }
+        while (p != end && is_digit(*p)) {
+            ++p;
+        }
+    }
+
+    return true;
+}
+
+inline bool skip_literal(const char *&p, const char *end, const char *literal, std::size_t size) {
+    if (static_cast<std::size_t>(end - p) < size || std::memcmp(p, literal, size) != 0) {
+        return false;
+    }
+
+    p += size;
+    return true;
+}
+
+inline bool skip_valid_scalar(const char *&p, const char *end) {
+    switch (*p) {
+        case '"': return skip_valid_string(p, end);
+        case 't': return skip_literal(p, end, "true", 4);
+        case 'f': return skip_literal(p, end, "false", 5);
+        case 'n': return skip_literal(p, end, "null", 4);
+        default: return skip_valid_number(p, end);
+    }
+}
+
+/**
+ * Skip object key and the colon following it.
+ */
+inline bool skip_valid_key(const char *&p, const char *end) {
+    if (p == end || *p != '"' || !skip_valid_string(p, end)) {
+        return false;
+    }
+
+    p = skip_ws(p, end);
+    if (p == end || *p != ':') {
+        return false;
+    }
+
+    ++p;
+    return true;
+}
+
+/**
+ * Skip one JSON value starting at begin, checking it against the full JSON grammar,
+ * see skip_valid_string() for strings. Text that passes can be written to output
+ * as is. On success, begin points right after the value, otherwise to the place of
+ * error.
+ */
+inline bool skip_valid_value(const char *&begin, const char *end) {
+    // Closing brackets of composites the value is in.
+    std::string expected;
+    const char *p = begin;
+
+    while (true) {
+        p = skip_ws(p, end);
+        if (p == end) {
+            break;
+        }
+
+        if (*p == '{' || *p == '[') {
+            expected += *p == '{' ? '}' : ']';
+            p = skip_ws(p + 1, end);
+
+            if (p == end || *p != expected.back()) {
+                if (expected.back() == '}' && !skip_valid_key(p, end)) {
+                    break;
+                }
+                continue;
+            }
+
+            // Empty composite.
+            ++p;
+            expected.pop_back();
+        } else if (!skip_valid_scalar(p, end)) {
+            break;
+        }
+
+        // After value, close finished composites until next item starts.
+        bool next = false;
+        while (!next) {
+            if (expected.empty()) {
+                begin = p;
+                return true;
+            }
+
+            p = skip_ws(p, end);
+            if (p == end) {
+                break;
+            }
+
+            if (*p == ',') {
+                p = skip_ws(p + 1, end);
+                if (expected.back() == '}' && !skip_valid_key(p, end)) {
+                    break;
+                }
+                next = true;
+            } else if (*p == expected.back()) {
+                ++p;
+                expected.pop_back();
+            } else {
+                break;
+            }
+        }
+
+        if (!next) {
+            break;
+        }
+    }
+
+    begin = p;
+    return false;
+}
+
+} // namespace detail
+} // namespace json
+} // namespace gcm
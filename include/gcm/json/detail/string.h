@@ -0,0 +1,156 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace gcm {
+namespace json {
+namespace detail {
+
+/**
+ * True if JSON string contents (without quotes) contain escape sequences.
+ */
+inline bool has_escapes(const char *begin, const char *end) {
+    return std::memchr(begin, '\\', end - begin) != nullptr;
+}
+
+template<typename I>
+bool has_escapes(I begin, I end) {
+    for (; begin != end; ++begin) {
+        if (*begin == '\\') {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename I>
+bool parse_hex4(I &begin, I end, uint32_t &out) {
+    out = 0;
+    for (int i = 0; i < 4; ++i, ++begin) {
+        if (begin == end) {
+            return false;
+        }
+
+        char ch = *begin;
+        out <<= 4;
+        if (ch >= '0' && ch <= '9') {
+            out |= ch - '0';
+        } else if (ch >= 'a' && ch <= 'f') {
+            out |= ch - 'a' + 10;
+        } else if (ch >= 'A' && ch <= 'F') {
+            out |= ch - 'A' + 10;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void append_utf8(std::string &out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+/**
+ * Append unescaped JSON string contents (without quotes) to out. \uXXXX escapes
+ * are converted to UTF-8, including surrogate pairs; lone surrogates become
+ * U+FFFD. Returns false on invalid escape sequence.
+ */
+template<typename I>
+bool unescape(I begin, I end, std::string &out) {
+    while (begin != end) {
+        char ch = *begin++;
+        if (ch != '\\') {
+            out += ch;
+            continue;
+        }
+
+        if (begin == end) {
+            return false;
+        }
+
+        switch (*begin++) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+
+            case 'u': {
+                uint32_t cp;
+                if (!parse_hex4(begin, end, cp)) {
+                    return false;
+                }
+
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    // High surrogate, must be followed by low one.
+                    I next = begin;
+                    uint32_t low;
+                    if (next != end && *next == '\\' && ++next != end && *next == 'u'
+                        && parse_hex4(++next, end, low) && low >= 0xDC00 && low <= 0xDFFF)
+                    {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        begin = next;
+                    } else {
+                        cp = 0xFFFD;
+                    }
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    cp = 0xFFFD;
+                }
+
+                append_utf8(out, cp);
+                break;
+            }
+
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace detail
+} // namespace json
+} // namespace gcm
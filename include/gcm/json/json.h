@@ -23,15 +23,19 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
-#include <sstream>
 #include <stdexcept>
 #include <type_traits>
 #include <vector>
-#include <map>
+#include <utility>
 #include <memory>
 #include <iomanip>
 
+#include "detail/number.h"
+#include "detail/flat_map.h"
+#include "detail/escape.h"
+
 namespace gcm {
 namespace json {
 
@@ -64,106 +68,141 @@ inline std::string str_type(ValueType val) {
     }
 }
 
+/**
+ * Base of all JSON values. Type of the value is stored directly in the base
+ * class, so type checks (including to<T>()) need neither virtual call nor RTTI.
+ */
 class Value {
 public:
+    Value(): kind(ValueType::Null), lazy(false)
+    {}
+
     virtual ~Value() = default;
 
     static constexpr const ValueType type = ValueType::Null;
 
-    virtual ValueType get_type() const {
-        return Value::type;
+    ValueType get_type() const {
+        return kind;
     }
 
     bool is_null() const {
-        return get_type() == ValueType::Null;
+        return kind == ValueType::Null;
     }
 
-    virtual std::string to_string() const {
-        return "null";
+    /**
+     * Lazy values keep only their JSON text and are parsed on first access
+     * through to<T>(), see Raw.
+     */
+    bool is_lazy() const {
+        return lazy;
     }
+
+    /**
+     * Return the value to be used for typed access. Lazy values return their
+     * parsed form, all others return themselves.
+     */
+    virtual Value &materialize() {
+        return *this;
+    }
+
+    /**
+     * Append JSON representation of the value to out.
+     */
+    virtual void write(std::string &out) const {
+        out += "null";
+    }
+
+    std::string to_string() const {
+        std::string out;
+        write(out);
+        return out;
+    }
+
+protected:
+    explicit Value(ValueType kind, bool lazy = false): kind(kind), lazy(lazy)
+    {}
+
+    ValueType kind;
+    bool lazy;
 };
 
-class Object: public Value, public std::map<std::string, std::shared_ptr<Value>> {
+/**
+ * JSON object. Keys are kept in insertion order, see detail::FlatMap.
+ */
+class Object: public Value, public detail::FlatMap<std::shared_ptr<Value>> {
 public:
-    Object(): Value(), std::map<std::string, std::shared_ptr<Value>>()
+    Object(): Value(ValueType::Object), detail::FlatMap<std::shared_ptr<Value>>()
     {}
 
     Object(const Object &) = default;
     Object(Object &&) = default;
 
-    static constexpr const ValueType type = ValueType::Object;
+    Object &operator=(const Object &) = default;
+    Object &operator=(Object &&) = default;
 
-    ValueType get_type() const {
-        return Object::type;
-    }
+    static constexpr const ValueType type = ValueType::Object;
 
     bool has_key(const std::string &index) const {
         return find(index) != end();
     }
 
-    std::string to_string() const {
-        std::stringstream ss;
-
-        ss << "{";
+    void write(std::string &out) const {
+        out += '{';
 
         for (auto it = begin(); it != end(); ++it) {
             if (it != begin()) {
-                ss << ",";
+                out += ',';
             }
 
+            detail::write_string(out, it->first.data(), it->first.size());
+            out += ':';
+
             if (it->second) {
-                ss << "\"" << it->first << "\":" << it->second->to_string();
+                it->second->write(out);
             } else {
-                ss << "\"" << it->first << "\":null";
+                out += "null";
             }
         }
 
-        ss << "}";
-
-        return ss.str();
+        out += '}';
     }
 };
 
 class Array: public Value, public std::vector<std::shared_ptr<Value>> {
 public:
-    Array(): Value(), std::vector<std::shared_ptr<Value>>()
+    Array(): Value(ValueType::Array), std::vector<std::shared_ptr<Value>>()
     {}
 
     Array(std::initializer_list<std::shared_ptr<Value>> values):
-        Value(),
+        Value(ValueType::Array),
         std::vector<std::shared_ptr<Value>>(values)
     {}
 
     Array(std::vector<std::shared_ptr<Value>> &&values):
-        Value(),
+        Value(ValueType::Array),
         std::vector<std::shared_ptr<Value>>(std::forward<std::vector<std::shared_ptr<Value>>>(values))
     {}
 
     Array(const Array &) = default;
     Array(Array &&) = default;
 
-    static constexpr const ValueType type = ValueType::Array;
-
-    ValueType get_type() const {
-        return Array::type;
-    }
+    Array &operator=(const Array &) = default;
+    Array &operator=(Array &&) = default;
 
-    std::string to_string() const {
-        std::stringstream ss;
+    static constexpr const ValueType type = ValueType::Array;
 
-        ss << "[";
+    void write(std::string &out) const {
+        out += '[';
 
         for (auto it = begin(); it != end(); ++it) {
             if (it != begin()) {
-                ss << ",";
+                out += ',';
             }
 
-            ss << (*it)->to_string();
+            (*it)->write(out);
         }
 
-        ss << "]";
-
-        return ss.str();
+        out += ']';
     }
 };
 
@@ -171,19 +210,15 @@ template<typename T, ValueType VT>
 class PlainValue: public Value {
 public:
     template<typename I>
-    PlainValue(I &&value): Value(), value(std::forward<std::decay_t<I>>(value))
+    PlainValue(I &&value): Value(VT), value(std::forward<std::decay_t<I>>(value))
     {}
 
     template<typename I>
-    PlainValue(const I &value): Value(), value(value)
+    PlainValue(const I &value): Value(VT), value(value)
     {}
 
     static constexpr const ValueType type = VT;
 
-    ValueType get_type() const {
-        return VT;
-    }
-
     PlainValue(const PlainValue &) = default;
     PlainValue(PlainValue &&) = default;
 
@@ -212,63 +247,35 @@ public:
     PlainValue &operator=(const PlainValue &other) = default;
     PlainValue &operator=(PlainValue &&other) = default;
 
-    std::string to_string() const {
-        return get_string<T>();
+    void write(std::string &out) const {
+        write_value<T>(out);
     }
 
 protected:
     template<typename I>
-    std::enable_if_t<std::is_arithmetic<I>::value && !std::is_same<I, bool>::value, std::string>
-    get_string() const {
-        return std::to_string(value);
+    std::enable_if_t<std::is_integral<I>::value && !std::is_same<I, bool>::value>
+    write_value(std::string &out) const {
+        char buffer[detail::IntBufferSize];
+        out.append(buffer, detail::format_int(buffer, value));
     }
 
     template<typename I>
-    std::enable_if_t<std::is_same<I, bool>::value, std::string>
-    get_string() const {
-        if (value) {
-            return "true";
-        } else {
-            return "false";
-        }
+    std::enable_if_t<std::is_floating_point<I>::value>
+    write_value(std::string &out) const {
+        char buffer[detail::DoubleBufferSize];
+        out.append(buffer, detail::format_double(buffer, value));
     }
 
     template<typename I>
-    std::enable_if_t<std::is_same<I, std::string>::value, std::string>
-    get_string() const {
-        std::stringstream ss;
-        ss << '"';
-
-        bool is_unicode = false;
-        for (char ch: value) {
-            if (is_unicode) {
-                ss << "\\u" << std::setw(2) << std::setfill('0') << std::hex << (int)ch;
-                continue;
-            }
-
-            if (std::isprint(ch)) {
-                ss << ch;
-            } else if (ch == '\"' || ch == '\\' || ch == '/') {
-                ss << '\\' << ch;
-            } else if (ch == '\b') {
-                ss << "\\b";
-            } else if (ch == '\f') {
-                ss << "\\f";
-            } else if (ch == '\n') {
-                ss << "\\n";
-            } else if (ch == '\r') {
-                ss << "\\r";
-            } else if (ch == '\t') {
-                ss << "\\t";
-            } else {
-                ss << "\\u" << std::setw(2) << std::setfill('0') << std::hex << (int)ch;
-                is_unicode = true;
-            }
-        }
-
-        ss << '"';
+    std::enable_if_t<std::is_same<I, bool>::value>
+    write_value(std::string &out) const {
+        out += value ? "true" : "false";
+    }
 
-        return ss.str();
+    template<typename I>
+    std::enable_if_t<std::is_same<I, std::string>::value>
+    write_value(std::string &out) const {
+        detail::write_string(out, value.data(), value.size());
     }
 
     T value;
@@ -281,15 +288,15 @@ using Bool = PlainValue<bool, ValueType::Bool>;
 
 template<typename T>
 T &to(Value &value) {
-    T *val = dynamic_cast<T *>(&value);
-    if (!val) {
-        throw TypeException("Conversion from " + str_type(value.get_type()) + " to " + str_type(T::type) + " requested.");
+    Value &target = value.is_lazy() ? value.materialize() : value;
+    if (target.get_type() != T::type) {
+        throw TypeException("Conversion from " + str_type(target.get_type()) + " to " + str_type(T::type) + " requested.");
     }
-    return *val;
+    return static_cast<T &>(target);
 }
 
 template<typename T>
-T &to(std::shared_ptr<Value> &value) {
+T &to(const std::shared_ptr<Value> &value) {
     return to<T>(*value);
 }
 
@@ -297,17 +304,28 @@ inline std::shared_ptr<Value> make_null() {
     return std::make_shared<Value>();
 }
 
+namespace detail {
+
+inline void fill_object(Object &) {
+}
+
 template<typename Head, typename... Tail>
-inline std::shared_ptr<Value> make_object(Head head, Tail... tail) {
-    std::shared_ptr<Value> obj = make_object(tail...);
-    to<Object>(obj)[head.first] = head.second;
-    return obj;
+inline void fill_object(Object &obj, Head head, Tail... tail) {
+    obj.emplace(head.first, head.second);
+    fill_object(obj, tail...);
 }
 
-template<typename Head>
-inline std::shared_ptr<Value> make_object(Head head) {
-    std::shared_ptr<Value> obj = std::make_shared<Object>();
-    to<Object>(obj)[head.first] = head.second;
+} // namespace detail
+
+/**
+ * Create object from list of key-value pairs. Keys are kept in given order; of
+ * duplicate keys, the first one wins.
+ */
+template<typename Head, typename... Tail>
+inline std::shared_ptr<Value> make_object(Head head, Tail... tail) {
+    auto obj = std::make_shared<Object>();
+    obj->reserve(1 + sizeof...(Tail));
+    detail::fill_object(*obj, head, tail...);
     return obj;
 }
 
@@ -330,15 +348,15 @@ inline JsonValue make_array(std::vector<JsonValue> &&values) {
 }
 
 template<typename T>
-std::enable_if_t<std::is_convertible<T, int>::value, JsonValue>
+std::enable_if_t<std::is_convertible<T, int64_t>::value, JsonValue>
 make_int(T value) {
-    return std::make_shared<Int>(static_cast<int>(value));
+    return std::make_shared<Int>(static_cast<int64_t>(value));
 }
 
 template<typename T>
 std::enable_if_t<std::is_enum<T>::value, JsonValue>
 make_int(T value) {
-    return std::make_shared<Int>(static_cast<int>(value));
+    return std::make_shared<Int>(static_cast<int64_t>(value));
 }
 
 template<typename T>
@@ -0,0 +1,291 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "json.h"
+#include "parser.h"
+#include "detail/binary.h"
+
+/**
+ * MessagePack encoding of JSON values. Only the types of the JSON data model
+ * are produced; on input, bin is read as string and float32 as double.
+ * Extension types are rejected.
+ */
+
+namespace gcm {
+namespace json {
+namespace msgpack {
+
+namespace detail {
+
+using namespace gcm::json::detail;
+
+inline void write_length(std::string &out, std::size_t size, uint8_t fix, std::size_t fix_max, uint8_t tag8, uint8_t tag16, uint8_t tag32) {
+    if (size <= fix_max) {
+        out += static_cast<char>(fix | size);
+    } else if (tag8 != 0 && size <= 0xFF) {
+        out += static_cast<char>(tag8);
+        out += static_cast<char>(size);
+    } else if (size <= 0xFFFF) {
+        out += static_cast<char>(tag16);
+        put_be(out, static_cast<uint16_t>(size));
+    } else {
+        out += static_cast<char>(tag32);
+        put_be(out, static_cast<uint32_t>(size));
+    }
+}
+
+inline void write_int(std::string &out, int64_t value) {
+    if (value >= 0) {
+        if (value <= 0x7F) {
+            out += static_cast<char>(value);
+        } else if (value <= 0xFF) {
+            out += '\xCC';
+            out += static_cast<char>(value);
+        } else if (value <= 0xFFFF) {
+            out += '\xCD';
+            put_be(out, static_cast<uint16_t>(value));
+        } else if (value <= 0xFFFFFFFFLL) {
+            out += '\xCE';
+            put_be(out, static_cast<uint32_t>(value));
+        } else {
+            out += '\xCF';
+            put_be(out, static_cast<uint64_t>(value));
+        }
+    } else {
+        if (value >= -32) {
+            out += static_cast<char>(value);
+        } else if (value >= std::numeric_limits<int8_t>::min()) {
+            out += '\xD0';
+            out += static_cast<char>(value);
+        } else if (value >= std::numeric_limits<int16_t>::min()) {
+            out += '\xD1';
+            put_be(out, static_cast<uint16_t>(value));
+        } else if (value >= std::numeric_limits<int32_t>::min()) {
+            out += '\xD2';
+            put_be(out, static_cast<uint32_t>(value));
+        } else {
+            out += '\xD3';
+            put_be(out, static_cast<uint64_t>(value));
+        }
+    }
+}
+
+inline void write_string(std::string &out, const std::string &value) {
+    write_length(out, value.size(), 0xA0, 31, 0xD9, 0xDA, 0xDB);
+    out += value;
+}
+
+inline JsonValue read_value(const char *&begin, const char *end, int depth);
+
+inline JsonValue read_string(const char *&begin, const char *end, std::size_t size) {
+    if (static_cast<std::size_t>(end - begin) < size) {
+        throw ParseException("Unexpected end of MessagePack data.");
+    }
+
+    auto value = make_string(std::string(begin, size));
+    begin += size;
+    return value;
+}
+
+inline JsonValue read_array(const char *&begin, const char *end, std::size_t size, int depth) {
+    // Every item takes at least one byte, do not trust size blindly.
+    if (static_cast<std::size_t>(end - begin) < size) {
+        throw ParseException("Unexpected end of MessagePack data.");
+    }
+
+    Array arr;
+    arr.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        arr.push_back(read_value(begin, end, depth + 1));
+    }
+    return std::make_shared<Array>(std::move(arr));
+}
+
+inline JsonValue read_map(const char *&begin, const char *end, std::size_t size, int depth) {
+    if (static_cast<std::size_t>(end - begin) < size * 2) {
+        throw ParseException("Unexpected end of MessagePack data.");
+    }
+
+    Object obj;
+    obj.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        auto key = read_value(begin, end, depth + 1);
+        if (key->get_type() != ValueType::String) {
+            throw ParseException("MessagePack map key must be string.");
+        }
+        obj[to<String>(key).get_value()] = read_value(begin, end, depth + 1);
+    }
+    return std::make_shared<Object>(std::move(obj));
+}
+
+template<typename T>
+T read_be(const char *&begin, const char *end) {
+    T value;
+    if (!get_be(begin, end, value)) {
+        throw ParseException("Unexpected end of MessagePack data.");
+    }
+    return value;
+}
+
+inline JsonValue read_value(const char *&begin, const char *end, int depth) {
+    if (depth > MaxDecodeDepth) {
+        throw ParseException("MessagePack data nested too deep.");
+    }
+
+    if (begin == end) {
+        throw ParseException("Unexpected end of MessagePack data.");
+    }
+
+    uint8_t tag = static_cast<uint8_t>(*begin++);
+
+    if (tag <= 0x7F) {
+        return make_int(tag);
+    } else if (tag >= 0xE0) {
+        return make_int(static_cast<int8_t>(tag));
+    } else if ((tag & 0xE0) == 0xA0) {
+        return read_string(begin, end, tag & 0x1F);
+    } else if ((tag & 0xF0) == 0x90) {
+        return read_array(begin, end, tag & 0x0F, depth);
+    } else if ((tag & 0xF0) == 0x80) {
+        return read_map(begin, end, tag & 0x0F, depth);
+    }
+
+    switch (tag) {
+        case 0xC0: return make_null();
+        case 0xC2: return make_bool(false);
+        case 0xC3: return make_bool(true);
+
+        case 0xC4:
+        case 0xD9: return read_string(begin, end, read_be<uint8_t>(begin, end));
+        case 0xC5:
+        case 0xDA: return read_string(begin, end, read_be<uint16_t>(begin, end));
+        case 0xC6:
+        case 0xDB: return read_string(begin, end, read_be<uint32_t>(begin, end));
+
+        case 0xCA: return make_double(bits_float(read_be<uint32_t>(begin, end)));
+        case 0xCB: return make_double(bits_double(read_be<uint64_t>(begin, end)));
+
+        case 0xCC: return make_int(read_be<uint8_t>(begin, end));
+        case 0xCD: return make_int(read_be<uint16_t>(begin, end));
+        case 0xCE: return make_int(read_be<uint32_t>(begin, end));
+        case 0xCF: {
+            uint64_t value = read_be<uint64_t>(begin, end);
+            if (value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                // Same as JSON parser, keep at least the magnitude.
+                return make_double(static_cast<double>(value));
+            }
+            return make_int(static_cast<int64_t>(value));
+        }
+
+        case 0xD0: return make_int(static_cast<int8_t>(read_be<uint8_t>(begin, end)));
+        case 0xD1: return make_int(static_cast<int16_t>(read_be<uint16_t>(begin, end)));
+        case 0xD2: return make_int(static_cast<int32_t>(read_be<uint32_t>(begin, end)));
+        case 0xD3: return make_int(static_cast<int64_t>(read_be<uint64_t>(begin, end)));
+
+        case 0xDC: return read_array(begin, end, read_be<uint16_t>(begin, end), depth);
+        case 0xDD: return read_array(begin, end, read_be<uint32_t>(begin, end), depth);
+        case 0xDE: return read_map(begin, end, read_be<uint16_t>(begin, end), depth);
+        case 0xDF: return read_map(begin, end, read_be<uint32_t>(begin, end), depth);
+
+        default:
+            throw ParseException("Unsupported MessagePack type " + std::to_string(tag) + ".");
+    }
+}
+
+} // namespace detail
+
+/**
+ * Append MessagePack representation of value to out.
+ */
+inline void write(std::string &out, const JsonValue &value) {
+    if (!value) {
+        out += '\xC0';
+        return;
+    }
+
+    switch (value->get_type()) {
+        case ValueType::Null:
+            out += '\xC0';
+            break;
+
+        case ValueType::Bool:
+            out += to<Bool>(value).get_value() ? '\xC3' : '\xC2';
+            break;
+
+        case ValueType::Int:
+            detail::write_int(out, to<Int>(value).get_value());
+            break;
+
+        case ValueType::Double:
+            out += '\xCB';
+            detail::put_be(out, detail::double_bits(to<Double>(value).get_value()));
+            break;
+
+        case ValueType::String:
+            detail::write_string(out, to<String>(value).get_value());
+            break;
+
+        case ValueType::Array: {
+            auto &arr = to<Array>(value);
+            detail::write_length(out, arr.size(), 0x90, 15, 0, 0xDC, 0xDD);
+            for (auto &item: arr) {
+                write(out, item);
+            }
+            break;
+        }
+
+        case ValueType::Object: {
+            auto &obj = to<Object>(value);
+            detail::write_length(out, obj.size(), 0x80, 15, 0, 0xDE, 0xDF);
+            for (auto &item: obj) {
+                detail::write_string(out, item.first);
+                write(out, item.second);
+            }
+            break;
+        }
+    }
+}
+
+inline std::string encode(const JsonValue &value) {
+    std::string out;
+    write(out, value);
+    return out;
+}
+
+/**
+ * Decode one value starting at begin. On success, begin is moved after the value.
+ * Throws ParseException on malformed input.
+ */
+inline JsonValue decode(const char *&begin, const char *end) {
+    return detail::read_value(begin, end, 0);
+}
+
+} // namespace msgpack
+} // namespace json
+} // namespace gcm
@@ -24,11 +24,15 @@
 #pragma once
 
 #include <functional>
+#include <string>
+#include <vector>
 
 #include <gcm/parser/parser.h>
 #include <gcm/logging/logging.h>
 
 #include "json.h"
+#include "detail/number.h"
+#include "detail/string.h"
 
 // Define JSON_PARSER_DEBUG to see debug output from the parser.
 //#define JSON_PARSER_DEBUG
@@ -42,179 +46,254 @@ public:
     {}
 };
 
-struct parser {
-    struct Item {
-        JsonValue *value;
-        std::shared_ptr<Item> parent;
-    };
+/**
+ * Base for SAX handlers passed to parse(begin, end, handler). All events are
+ * ignored here; derived handler hides the ones it is interested in. Calls are
+ * resolved statically, so there is no virtual dispatch.
+ *
+ * String values and keys are passed as ranges of the input, without quotes and
+ * in escaped form (see detail::unescape()). Numbers are already converted. Handler that wants to skip
+ * a subtree just counts begin/end events and ignores everything in between.
+ * Throwing from handler aborts the parsing.
+ */
+class Handler {
+public:
+    void null_value() {}
+    void bool_value(bool) {}
+    void int_value(int64_t) {}
+    void double_value(double) {}
 
-    parser():
-        current(std::make_shared<Item>()),
-        stop(false),
-        log(gcm::logging::getLogger("GCM.json.parser"))
-    {
-        current->value = &value;
+    template<typename I>
+    void string_value(I, I) {}
+
+    void begin_array() {}
+    void end_array() {}
+
+    void begin_object() {}
+
+    template<typename I>
+    void key(I, I) {}
+
+    void end_object() {}
+};
+
+/**
+ * Handler that builds JsonValue DOM from the events.
+ */
+class DomBuilder: public Handler {
+public:
+    void null_value() {
+        add(make_null());
     }
 
-    void level_up() {
-        if (current->parent) {
-            current = current->parent;
+    void bool_value(bool value) {
+        add(make_bool(value));
+    }
+
+    void int_value(int64_t value) {
+        add(make_int(value));
+    }
+
+    void double_value(double value) {
+        add(make_double(value));
+    }
+
+    template<typename I>
+    void string_value(I begin, I end) {
+        add(make_string(unescape(begin, end)));
+    }
+
+    void begin_array() {
+        auto arr = make_array();
+        add(arr);
+        stack.push_back(arr);
+    }
+
+    void end_array() {
+        stack.pop_back();
+    }
+
+    void begin_object() {
+        auto obj = make_object();
+        add(obj);
+        stack.push_back(obj);
+    }
+
+    template<typename I>
+    void key(I begin, I end) {
+        if (detail::has_escapes(begin, end)) {
+            pending_key = unescape(begin, end);
         } else {
-            stop = true;
+            pending_key.assign(begin, end);
         }
     }
 
-    void test_stop() {
-        if (stop) {
-            throw ParseException("Unexpected input after JSON value.");
+    void end_object() {
+        stack.pop_back();
+    }
+
+    JsonValue value;
+
+protected:
+    void add(const JsonValue &item) {
+        if (stack.empty()) {
+            if (value) {
+                throw ParseException("Unexpected input after JSON value.");
+            }
+            value = item;
+        } else if (stack.back()->get_type() == ValueType::Array) {
+            to<Array>(stack.back()).push_back(item);
+        } else {
+            to<Object>(stack.back())[pending_key] = item;
         }
     }
 
+    template<typename I>
+    static std::string unescape(I begin, I end) {
+        std::string out;
+        if (!detail::has_escapes(begin, end)) {
+            out.assign(begin, end);
+        } else if (!detail::unescape(begin, end, out)) {
+            throw ParseException("Invalid escape sequence in string " + std::string(begin, end) + ".");
+        }
+        return out;
+    }
+
+    std::vector<JsonValue> stack;
+    std::string pending_key;
+};
+
+namespace detail {
+
+/**
+ * Adapts extractor callbacks of the grammar to handler events.
+ */
+template<typename H>
+struct sax_driver {
+    sax_driver(H &handler):
+        handler(handler),
+        log(gcm::logging::getLogger("GCM.json.parser"))
+    {}
+
     template<typename I>
     void null_value(I, I) {
-        test_stop();
 #ifdef JSON_PARSER_DEBUG
         DEBUG(log) << "null value";
 #endif
-        *(current->value) = make_null();
-        level_up();
+        handler.null_value();
     }
 
     template<typename I>
     void true_value(I, I) {
-        test_stop();
 #ifdef JSON_PARSER_DEBUG
         DEBUG(log) << "true value";
 #endif
-        *(current->value) = make_bool(true);
-        level_up();
+        handler.bool_value(true);
     }
 
     template<typename I>
     void false_value(I, I) {
-        test_stop();
 #ifdef JSON_PARSER_DEBUG
         DEBUG(log) << "false value";
 #endif
-        *(current->value) = make_bool(false);
-        level_up();
+        handler.bool_value(false);
     }
 
     template<typename I>
     void int_value(I begin, I end) {
-        test_stop();
 #ifdef JSON_PARSER_DEBUG
         DEBUG(log) << "int value " << std::string(begin, end);
 #endif
-        *(current->value) = make_int(std::stoi(std::string(begin, end)));
-        level_up();
+        int64_t int_value;
+        double double_value;
+        if (parse_int(begin, end, int_value)) {
+            handler.int_value(int_value);
+        } else if (parse_double(begin, end, double_value)) {
+            // Integer does not fit into Int, keep at least the magnitude.
+            handler.double_value(double_value);
+        } else {
+            throw ParseException("Number " + std::string(begin, end) + " is out of range.");
+        }
     }
 
     template<typename I>
     void double_value(I begin, I end) {
-        test_stop();
 #ifdef JSON_PARSER_DEBUG
         DEBUG(log) << "double value " << std::string(begin, end);
 #endif
-        *(current->value) = make_double(std::stod(std::string(begin, end)));
-        level_up();
+        double value;
+        if (!parse_double(begin, end, value)) {
+            throw ParseException("Invalid number " + std::string(begin, end) + ".");
+        }
+
+        handler.double_value(value);
     }
 
     template<typename I>
     void string_value(I begin, I end) {
-        test_stop();
 #ifdef JSON_PARSER_DEBUG
         DEBUG(log) << "string value " << std::string(begin, end);
 #endif
-        *(current->value) = make_string(std::string(begin, end));
-        level_up();
+        handler.string_value(begin, end);
     }
 
     template<typename I>
     void array_begin(I, I) {
-        test_stop();
 #ifdef JSON_PARSER_DEBUG
         DEBUG(log) << "array begin";
 #endif
-        *(current->value) = make_array();
-    }
-
-    template<typename I>
-    void new_array_item(I, I) {
-        test_stop();
-#ifdef JSON_PARSER_DEBUG
-        DEBUG(log) << "array item";
-#endif
-        auto &arr = to<Array>(*(current->value));
-        arr.push_back(make_null());
-
-        auto item = std::make_shared<Item>();
-        item->parent = current;
-        item->value = &arr.back();
-        current = item;
+        handler.begin_array();
     }
 
     template<typename I>
     void array_end(I, I) {
-        test_stop();
 #ifdef JSON_PARSER_DEBUG
         DEBUG(log) << "array end";
 #endif
-        level_up();
+        handler.end_array();
     }
 
     template<typename I>
     void obj_begin(I, I) {
-        test_stop();
 #ifdef JSON_PARSER_DEBUG
         DEBUG(log) << "obj begin";
 #endif
-        *(current->value) = make_object();
+        handler.begin_object();
     }
 
     template<typename I>
-    void new_obj_item(I begin, I end) {
-        test_stop();
+    void obj_key(I begin, I end) {
 #ifdef JSON_PARSER_DEBUG
         DEBUG(log) << "new obj item: " << std::string(begin, end);
 #endif
-        auto &obj = to<Object>(*(current->value));
-        
-        auto item = std::make_shared<Item>();
-        item->value = &(obj[std::string(begin, end)] = make_null());
-        item->parent = current;
-
-        current = item;
+        handler.key(begin, end);
     }
 
     template<typename I>
     void obj_end(I, I) {
-        test_stop();
 #ifdef JSON_PARSER_DEBUG
         DEBUG(log) << "obj end";
 #endif
-        level_up();
+        handler.end_object();
     }
 
-    template<typename I>
-    void debug(const std::string &msg, I begin, I end) {
-#ifdef JSON_PARSER_DEBUG
-        DEBUG(log) << msg << " " << std::string(begin, end);
-#endif
-    }
-
-    JsonValue value;
-    std::shared_ptr<Item> current;
-    bool stop;
+    H &handler;
     gcm::logging::Logger &log;
 };
 
-template<typename I>
-JsonValue parse(I &begin, I &end) {
+} // namespace detail
+
+/**
+ * Parse one JSON value from input and report it as events to handler. On success,
+ * begin is moved after the value and true is returned.
+ */
+template<typename I, typename H>
+bool parse(I &begin, I &end, H &handler) {
     using namespace gcm::parser;
     using namespace std::placeholders;
-    
-    parser p;
+
+    using driver = detail::sax_driver<H>;
+    driver p(handler);
 
     rule<I> value;
 
@@ -222,54 +301,65 @@ JsonValue parse(I &begin, I &end) {
 
     auto _char = *((any_rule() - '"'_r - '\\'_r ) | ('\\'_r & ('"'_r | '\\'_r | '/'_r | 'b'_r | 'f'_r | 'n'_r | 'r'_r | 't'_r | ('u' & iteration_rule(xdigit(), 4, 4)))));
 
-    auto v_null = "null"_r >> std::bind(&parser::null_value<I>, &p, _1, _2);
-    auto v_bool = "true"_r >> std::bind(&parser::true_value<I>, &p, _1, _2) | "false"_r >> std::bind(&parser::false_value<I>, &p, _1, _2);
+    auto v_null = "null"_r >> std::bind(&driver::template null_value<I>, &p, _1, _2);
+    auto v_bool = "true"_r >> std::bind(&driver::template true_value<I>, &p, _1, _2) | "false"_r >> std::bind(&driver::template false_value<I>, &p, _1, _2);
 
     auto int_part = (-('+'_r | '-'_r) & +digit());
-    auto v_int = int_part >> std::bind(&parser::int_value<I>, &p, _1, _2);
+    auto v_int = int_part >> std::bind(&driver::template int_value<I>, &p, _1, _2);
 
-    auto frac = '.'_r & *digit();
+    auto frac = '.'_r & +digit();
     auto _e = "e+"_r | "e-"_r | 'e'_r | "E+"_r | "E-"_r | "E"_r;
-    auto _exp = 'e'_r & *digit();
-    auto v_double = (int_part & (frac | _exp | (frac & _exp))) >> std::bind(&parser::double_value<I>, &p, _1, _2);
+    auto _exp = _e & +digit();
+    auto v_double = (int_part & ((frac & -_exp) | _exp)) >> std::bind(&driver::template double_value<I>, &p, _1, _2);
 
-    auto v_string = '"'_r & _char >> std::bind(&parser::string_value<I>, &p, _1, _2) & '"'_r;
+    auto v_string = '"'_r & _char >> std::bind(&driver::template string_value<I>, &p, _1, _2) & '"'_r;
 
     rule<I> value_in_array;
-    value_in_array = !']'_r >> std::bind(&parser::new_array_item<I>, &p, _1, _2)
+    value_in_array = !']'_r
         & value
         & _ws
         & -(','_r & _ws & -value_in_array);
 
     auto v_array =
-        '['_r >> std::bind(&parser::array_begin<I>, &p, _1, _2)
+        '['_r >> std::bind(&driver::template array_begin<I>, &p, _1, _2)
         & _ws
         & -value_in_array
         & _ws
-        & ']'_r >> std::bind(&parser::array_end<I>, &p, _1, _2);
+        & ']'_r >> std::bind(&driver::template array_end<I>, &p, _1, _2);
 
-    auto identifier = '"'_r & _char >> std::bind(&parser::new_obj_item<I>, &p, _1, _2) & '"'_r;
+    auto identifier = '"'_r & _char >> std::bind(&driver::template obj_key<I>, &p, _1, _2) & '"'_r;
 
     rule<I> value_in_obj;
     value_in_obj = identifier & _ws & ':'_r & _ws & value & -(',' & _ws & -value_in_obj);
 
     auto v_object =
-        '{'_r >> std::bind(&parser::obj_begin<I>, &p, _1, _2)
+        '{'_r >> std::bind(&driver::template obj_begin<I>, &p, _1, _2)
         & _ws
         & -value_in_obj
         & _ws
-        & '}'_r >> std::bind(&parser::obj_end<I>, &p, _1, _2);
+        & '}'_r >> std::bind(&driver::template obj_end<I>, &p, _1, _2);
 
     value = v_null | v_bool | v_double | v_int | v_string | v_array | v_object;
 
     auto document = _ws & value & _ws;
 
-    if (document(begin, end)) {
-        return p.value;
+    return document(begin, end);
+}
+
+/**
+ * Parse one JSON value from input into DOM. Returns nullptr when input does not
+ * contain valid JSON.
+ */
+template<typename I>
+JsonValue parse(I &begin, I &end) {
+    DomBuilder builder;
+
+    if (parse(begin, end, builder)) {
+        return builder.value;
     } else {
         return nullptr;
     }
 }
 
 }
-}
\ No newline at end of file
+}
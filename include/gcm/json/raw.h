@@ -0,0 +1,292 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "json.h"
+#include "parser.h"
+#include "detail/number.h"
+#include "detail/scan.h"
+#include "detail/string.h"
+#include "detail/escape.h"
+
+namespace gcm {
+namespace json {
+
+/**
+ * Shared, immutable JSON text, typically body of one request.
+ */
+using Buffer = std::shared_ptr<const std::string>;
+
+JsonValue parse(const Buffer &buffer, const char *&begin, const char *end);
+
+/**
+ * JSON value that is kept as text slice of shared buffer and parsed only when
+ * accessed through to<T>(). get_type() is known without parsing, and to_string()
+ * writes the original text, so values that are only passed through are
+ * never parsed at all. Once parsed, the parsed value is serialized instead,
+ * as it could have been modified through the reference returned by to<T>().
+ */
+class Raw: public Value {
+public:
+    Raw(Buffer buffer, const char *begin, const char *end):
+        Value(detect_type(begin, end), true),
+        buffer(std::move(buffer)),
+        text_begin(begin),
+        text_end(end),
+        parsed_ready(false)
+    {}
+
+    Raw(const Raw &) = delete;
+
+    const char *data() const {
+        return text_begin;
+    }
+
+    std::size_t size() const {
+        return text_end - text_begin;
+    }
+
+    const Buffer &get_buffer() const {
+        return buffer;
+    }
+
+    Value &materialize() {
+        std::call_once(parsed_flag, [this](){
+            parsed = parse_text();
+            parsed_ready.store(true, std::memory_order_release);
+        });
+        return *parsed;
+    }
+
+    /**
+     * Parsed value, or nullptr if the value was not accessed yet.
+     */
+    const Value *get_parsed() const {
+        return parsed_ready.load(std::memory_order_acquire) ? parsed.get() : nullptr;
+    }
+
+    void write(std::string &out) const {
+        if (parsed_ready.load(std::memory_order_acquire)) {
+            parsed->write(out);
+        } else {
+            out.append(text_begin, text_end);
+        }
+    }
+
+protected:
+    static ValueType detect_type(const char *begin, const char *end) {
+        if (begin == end) {
+            return ValueType::Null;
+        }
+
+        switch (*begin) {
+            case '{': return ValueType::Object;
+            case '[': return ValueType::Array;
+            case '"': return ValueType::String;
+            case 't':
+            case 'f': return ValueType::Bool;
+            case 'n': return ValueType::Null;
+            default: {
+                int64_t value;
+                if (detail::parse_int(begin, end, value)) {
+                    return ValueType::Int;
+                } else {
+                    return ValueType::Double;
+                }
+            }
+        }
+    }
+
+    JsonValue parse_text() const {
+        // Scalars are common as method parameters, do not build grammar for them.
+        switch (get_type()) {
+            case ValueType::Null:
+                if (to_string() == "null") {
+                    return make_null();
+                }
+                break;
+
+            case ValueType::Bool: {
+                std::string text = to_string();
+                if (text == "true" || text == "false") {
+                    return make_bool(text == "true");
+                }
+                break;
+            }
+
+            case ValueType::Int: {
+                int64_t value;
+                if (detail::parse_int(text_begin, text_end, value)) {
+                    return make_int(value);
+                }
+                break;
+            }
+
+            case ValueType::String: {
+                std::string out;
+                if (size() >= 2 && text_end[-1] == '"'
+                    && detail::unescape(text_begin + 1, text_end - 1, out))
+                {
+                    return make_string(std::move(out));
+                }
+                break;
+            }
+
+            default: {
+                auto begin = text_begin;
+                auto value = parse(buffer, begin, text_end);
+                if (value && begin == text_end && value->get_type() == get_type()) {
+                    return value;
+                }
+                break;
+            }
+        }
+
+        throw ParseException("Invalid JSON value " + to_string() + ".");
+    }
+
+    Buffer buffer;
+    const char *text_begin;
+    const char *text_end;
+
+    std::once_flag parsed_flag;
+    std::atomic<bool> parsed_ready;
+    JsonValue parsed;
+};
+
+inline JsonValue make_raw(Buffer buffer, const char *begin, const char *end) {
+    return std::make_shared<Raw>(std::move(buffer), begin, end);
+}
+
+/**
+ * Raw value spanning whole buffer, which must hold exactly one serialized JSON value.
+ */
+inline JsonValue make_raw(Buffer buffer) {
+    const char *begin = buffer->data();
+    const char *end = begin + buffer->size();
+    return std::make_shared<Raw>(std::move(buffer), begin, end);
+}
+
+/**
+ * Serialize value once into immutable buffer that can be shared by many readers.
+ * Raw value that was not parsed is written as its original text, which is checked
+ * to be valid JSON first, as the buffer is sent to others as it is.
+ */
+inline Buffer make_buffer(const JsonValue &value) {
+    auto text = std::make_shared<std::string>();
+    value->write(*text);
+
+    if (value->is_lazy()) {
+        const char *begin = text->data();
+        const char *end = begin + text->size();
+        if (!detail::skip_valid_value(begin, end) || begin != end) {
+            throw ParseException("Invalid JSON value " + *text + ".");
+        }
+    }
+
+    return text;
+}
+
+/**
+ * DOM builder for text held in shared buffer. Strings that would be written back
+ * unchanged (no escapes, control characters or invalid UTF-8) are not copied, they
+ * become Raw values referencing the buffer.
+ */
+class BufferDomBuilder: public DomBuilder {
+public:
+    BufferDomBuilder(Buffer buffer): buffer(std::move(buffer))
+    {}
+
+    void string_value(const char *begin, const char *end) {
+        if (!detail::is_verbatim(begin, end - begin)) {
+            DomBuilder::string_value(begin, end);
+        } else {
+            // Include the quotes, Raw detects type from them.
+            add(make_raw(buffer, begin - 1, end + 1));
+        }
+    }
+
+protected:
+    Buffer buffer;
+};
+
+/**
+ * Parse one JSON value from shared buffer, see BufferDomBuilder. On success, begin
+ * is moved after the value. Returns nullptr when input is not valid JSON.
+ */
+inline JsonValue parse(const Buffer &buffer, const char *&begin, const char *end) {
+    BufferDomBuilder builder(buffer);
+
+    if (parse(begin, end, builder)) {
+        return builder.value;
+    } else {
+        return nullptr;
+    }
+}
+
+/**
+ * Return items of array value. When the array is Raw, items are split by
+ * scanning the text and returned as Raw values as well, without parsing them.
+ */
+inline Array split_array(Value &value) {
+    if (!value.is_lazy()) {
+        return to<Array>(value);
+    }
+
+    if (value.get_type() != ValueType::Array) {
+        throw TypeException("Conversion from " + str_type(value.get_type()) + " to " + str_type(ValueType::Array) + " requested.");
+    }
+
+    auto &raw = static_cast<Raw &>(value);
+    const char *p = raw.data() + 1;
+    const char *end = raw.data() + raw.size() - 1;
+
+    Array out;
+    p = detail::skip_ws(p, end);
+    while (p != end) {
+        const char *item_begin = p;
+        if (!detail::skip_value(p, end)) {
+            throw ParseException("Invalid JSON array " + raw.to_string() + ".");
+        }
+        out.push_back(make_raw(raw.get_buffer(), item_begin, p));
+
+        p = detail::skip_ws(p, end);
+        if (p != end) {
+            if (*p != ',') {
+                throw ParseException("Invalid JSON array " + raw.to_string() + ".");
+            }
+            p = detail::skip_ws(p + 1, end);
+        }
+    }
+
+    return out;
+}
+
+} // namespace json
+} // namespace gcm
@@ -25,5 +25,9 @@
 
 #include "rpc/exception.h"
 #include "rpc/rpc.h"
+#include "rpc/execution.h"
+#include "rpc/envelope.h"
 #include "rpc/promise.h"
 #include "rpc/wait_all.h"
+#include "rpc/rate_limit.h"
+#include "rpc/cancellation.h"
@@ -0,0 +1,225 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <string>
+
+#include <gcm/logging/logging.h>
+
+#include "../json.h"
+#include "../raw.h"
+#include "stats.h"
+
+namespace gcm {
+namespace json {
+namespace rpc {
+
+/**
+ * Which finished calls get a record in the access log.
+ */
+struct AccessLogPolicy {
+    // Fraction of calls that are logged, 1 for all of them.
+    double sample_rate;
+
+    // Params are cut to this number of characters.
+    std::size_t max_params;
+
+    // Only calls that took at least this long are logged, 0 for all calls.
+    std::chrono::microseconds slow_threshold;
+};
+
+/**
+ * One INFO record per finished call, on the logger of Rpc. Whether the call is logged
+ * is decided first, from the cheapest check; params are formatted only for calls that
+ * are really written.
+ */
+class AccessLog {
+public:
+    explicit AccessLog(gcm::logging::Logger &log, AccessLogPolicy policy = AccessLogPolicy{1.0, 256, std::chrono::microseconds(0)}):
+        log(log),
+        policy(policy)
+    {}
+
+    gcm::logging::Logger &get_logger() const {
+        return log;
+    }
+
+    void set_policy(const AccessLogPolicy &policy) {
+        this->policy = policy;
+    }
+
+    bool should_log(std::chrono::microseconds duration) const {
+        if (policy.sample_rate < 1.0 && !sampled()) {
+            return false;
+        }
+
+        if (duration < policy.slow_threshold) {
+            return false;
+        }
+
+        return log.is_enabled(gcm::logging::MessageType::Info);
+    }
+
+    /**
+     * Write record of finished call. Lazy params are used when params were not split.
+     */
+    void write(const std::string &method, const Array &params, const JsonValue &lazy_params,
+        std::chrono::microseconds duration, int code) const
+    {
+        if (!should_log(duration)) {
+            return;
+        }
+
+        CallStatus status = call_status(code);
+        std::string str_status = status == CallStatus::Other ? std::to_string(code) : to_string(status);
+
+        INFO(log) << "method=" << method
+            << " status=" << str_status
+            << " time=" << std::setprecision(3) << (duration.count() / 1000.0) << "ms"
+            << " params=" << format_params(params, lazy_params);
+    }
+
+    /**
+     * JSON of params, cut to max_params characters. Only about max_params characters
+     * are ever written, however large the params are.
+     */
+    std::string format_params(const Array &params, const JsonValue &lazy_params) const {
+        std::string out;
+
+        if (params.empty() && lazy_params) {
+            write_limited(*lazy_params, out, policy.max_params);
+        } else {
+            out += '[';
+            for (auto it = params.begin(); it != params.end() && out.size() <= policy.max_params; ++it) {
+                if (it != params.begin()) {
+                    out += ',';
+                }
+
+                // Method is free to move params out.
+                if (*it) {
+                    write_limited(**it, out, policy.max_params);
+                } else {
+                    out += "null";
+                }
+            }
+            out += ']';
+        }
+
+        if (out.size() > policy.max_params) {
+            out.resize(json::detail::utf8_prefix(out.data(), out.size(), policy.max_params));
+            out += "...";
+        }
+
+        return out;
+    }
+
+protected:
+    /**
+     * Append JSON of value to out, stopping once out is longer than limit. Text of Raw
+     * value that was not parsed is copied only up to the limit, strings are cut before
+     * they are escaped. Cuts are moved back to UTF-8 character boundary, so the log line
+     * stays valid text.
+     */
+    static void write_limited(const Value &value, std::string &out, std::size_t limit) {
+        if (out.size() > limit) {
+            return;
+        }
+
+        std::size_t left = limit + 1 - out.size();
+
+        if (value.is_lazy()) {
+            auto &raw = static_cast<const Raw &>(value);
+            if (const Value *parsed = raw.get_parsed()) {
+                write_limited(*parsed, out, limit);
+            } else {
+                out.append(raw.data(), json::detail::utf8_prefix(raw.data(), raw.size(), left));
+            }
+            return;
+        }
+
+        switch (value.get_type()) {
+            case ValueType::Array: {
+                auto &arr = static_cast<const Array &>(value);
+                out += '[';
+                for (auto it = arr.begin(); it != arr.end() && out.size() <= limit; ++it) {
+                    if (it != arr.begin()) {
+                        out += ',';
+                    }
+                    if (*it) {
+                        write_limited(**it, out, limit);
+                    } else {
+                        out += "null";
+                    }
+                }
+                out += ']';
+                break;
+            }
+
+            case ValueType::Object: {
+                auto &obj = static_cast<const Object &>(value);
+                out += '{';
+                for (auto it = obj.begin(); it != obj.end() && out.size() <= limit; ++it) {
+                    if (it != obj.begin()) {
+                        out += ',';
+                    }
+                    auto &key = it->first;
+                    json::detail::write_string(out, key.data(), json::detail::utf8_prefix(key.data(), key.size(), limit + 1 - out.size()));
+                    out += ':';
+                    if (it->second) {
+                        write_limited(*it->second, out, limit);
+                    } else {
+                        out += "null";
+                    }
+                }
+                out += '}';
+                break;
+            }
+
+            case ValueType::String: {
+                auto &str = static_cast<const String &>(value).get_value();
+                json::detail::write_string(out, str.data(), json::detail::utf8_prefix(str.data(), str.size(), left));
+                break;
+            }
+
+            default:
+                value.write(out);
+                break;
+        }
+    }
+
+    bool sampled() const {
+        return (detail::thread_random() >> 11) * (1.0 / 9007199254740992.0) < policy.sample_rate;
+    }
+
+    gcm::logging::Logger &log;
+    AccessLogPolicy policy;
+};
+
+} // namespace rpc
+} // namespace json
+} // namespace gcm
@@ -0,0 +1,265 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../json.h"
+#include "../detail/escape.h"
+
+namespace gcm {
+namespace json {
+namespace rpc {
+
+/**
+ * Response caching of method. Only for methods whose result depends on params alone.
+ */
+struct CachePolicy {
+    std::chrono::milliseconds ttl;
+    std::size_t max_entries;
+
+    // Identical calls arriving while one is executing wait for its result instead of
+    // executing again.
+    bool coalesce;
+};
+
+inline CachePolicy Cached(std::chrono::milliseconds ttl, std::size_t max_entries = 1024, bool coalesce = false) {
+    return {ttl, max_entries, coalesce};
+}
+
+/**
+ * Coalescing of identical concurrent calls, without keeping the result afterwards.
+ */
+inline CachePolicy Coalesced() {
+    return {std::chrono::milliseconds(0), 0, true};
+}
+
+namespace detail {
+
+inline void write_canonical(Value &value, std::string &out) {
+    Value &v = value.materialize();
+
+    switch (v.get_type()) {
+        case ValueType::Array: {
+            out += '[';
+            bool first = true;
+            for (auto &item: static_cast<Array &>(v)) {
+                if (!first) {
+                    out += ',';
+                }
+                first = false;
+
+                if (item) {
+                    write_canonical(*item, out);
+                } else {
+                    out += "null";
+                }
+            }
+            out += ']';
+            break;
+        }
+
+        case ValueType::Object: {
+            auto &obj = static_cast<Object &>(v);
+
+            std::vector<Object::value_type *> items;
+            items.reserve(obj.size());
+            for (auto &item: obj) {
+                items.push_back(&item);
+            }
+
+            std::sort(items.begin(), items.end(), [](Object::value_type *a, Object::value_type *b) {
+                return a->first < b->first;
+            });
+
+            out += '{';
+            bool first = true;
+            for (auto *item: items) {
+                if (!first) {
+                    out += ',';
+                }
+                first = false;
+
+                json::detail::write_string(out, item->first.data(), item->first.size());
+                out += ':';
+
+                if (item->second) {
+                    write_canonical(*item->second, out);
+                } else {
+                    out += "null";
+                }
+            }
+            out += '}';
+            break;
+        }
+
+        default:
+            v.write(out);
+    }
+}
+
+} // namespace detail
+
+/**
+ * Cache key of call params. Params equal as JSON values have the same key, regardless
+ * of whitespace and order of object keys in the request.
+ */
+inline std::string cache_key(Array &params) {
+    std::string out;
+    detail::write_canonical(params, out);
+    return out;
+}
+
+/**
+ * Responses of one method, keyed by cache_key() of params. Entries are split into
+ * shards by hash of key, each shard is LRU with its own lock, so concurrent calls
+ * rarely contend.
+ */
+class ResponseCache {
+public:
+    static constexpr const std::size_t Shards = 8;
+
+    using Clock = std::chrono::steady_clock;
+
+    explicit ResponseCache(const CachePolicy &policy):
+        ttl(policy.ttl),
+        max_per_shard(std::max<std::size_t>(1, (policy.max_entries + Shards - 1) / Shards))
+    {}
+
+    ResponseCache(const ResponseCache &) = delete;
+
+    /**
+     * Find live response for key. Expired entry is removed.
+     */
+    bool get(const std::string &key, JsonValue &out) {
+        Shard &s = shard(key);
+        std::unique_lock<std::mutex> lock(s.mutex);
+
+        auto it = s.index.find(key);
+        if (it == s.index.end()) {
+            return false;
+        }
+
+        if (it->second->expires <= Clock::now()) {
+            s.lru.erase(it->second);
+            s.index.erase(it);
+            return false;
+        }
+
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        out = it->second->value;
+        return true;
+    }
+
+    void put(std::string &&key, JsonValue value) {
+        Shard &s = shard(key);
+        std::unique_lock<std::mutex> lock(s.mutex);
+
+        auto expires = Clock::now() + ttl;
+
+        auto it = s.index.find(key);
+        if (it != s.index.end()) {
+            it->second->value = std::move(value);
+            it->second->expires = expires;
+            s.lru.splice(s.lru.begin(), s.lru, it->second);
+            return;
+        }
+
+        if (s.lru.size() >= max_per_shard) {
+            s.index.erase(s.lru.back().key);
+            s.lru.pop_back();
+        }
+
+        s.lru.push_front(Entry{std::move(key), std::move(value), expires});
+        s.index.emplace(s.lru.front().key, s.lru.begin());
+    }
+
+    /**
+     * Drop response for one key.
+     */
+    void invalidate(const std::string &key) {
+        Shard &s = shard(key);
+        std::unique_lock<std::mutex> lock(s.mutex);
+
+        auto it = s.index.find(key);
+        if (it != s.index.end()) {
+            s.lru.erase(it->second);
+            s.index.erase(it);
+        }
+    }
+
+    /**
+     * Drop all responses.
+     */
+    void clear() {
+        for (auto &s: shards) {
+            std::unique_lock<std::mutex> lock(s.mutex);
+            s.lru.clear();
+            s.index.clear();
+        }
+    }
+
+    std::size_t size() {
+        std::size_t out = 0;
+        for (auto &s: shards) {
+            std::unique_lock<std::mutex> lock(s.mutex);
+            out += s.lru.size();
+        }
+        return out;
+    }
+
+protected:
+    struct Entry {
+        std::string key;
+        JsonValue value;
+        Clock::time_point expires;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru;
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    };
+
+    Shard &shard(const std::string &key) {
+        return shards[std::hash<std::string>()(key) % Shards];
+    }
+
+    std::chrono::milliseconds ttl;
+    std::size_t max_per_shard;
+    std::array<Shard, Shards> shards;
+};
+
+} // namespace rpc
+} // namespace json
+} // namespace gcm
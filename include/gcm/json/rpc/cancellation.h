@@ -0,0 +1,149 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include "types.h"
+#include "exception.h"
+
+namespace gcm {
+namespace json {
+namespace rpc {
+
+/**
+ * Deadline and cancellation flag of a call, shared by all copies. Calls of one request
+ * share one, so that closed connection cancels all of them at once. Calls check it
+ * before they are executed; running methods can poll it and stop early.
+ */
+class Cancellation {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Call that is never cancelled.
+     */
+    Cancellation()
+    {}
+
+    explicit Cancellation(Clock::time_point deadline):
+        state(std::make_shared<State>(deadline))
+    {}
+
+    /**
+     * Call without deadline, that can still be cancelled.
+     */
+    static Cancellation cancellable() {
+        return Cancellation(Clock::time_point::max());
+    }
+
+    void cancel() const {
+        if (state) {
+            state->cancelled.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    bool is_cancelled() const {
+        return state && (state->cancelled.load(std::memory_order_relaxed) || Clock::now() > state->deadline);
+    }
+
+    Clock::time_point get_deadline() const {
+        return state ? state->deadline : Clock::time_point::max();
+    }
+
+    /**
+     * Throw Server Error if the call has been cancelled or its deadline has passed.
+     */
+    void check() const {
+        if (!state) {
+            return;
+        }
+
+        if (state->cancelled.load(std::memory_order_relaxed)) {
+            throw RpcException(ErrorCode::ServerError, "Call cancelled.");
+        }
+
+        if (Clock::now() > state->deadline) {
+            throw RpcException(ErrorCode::ServerError, "Deadline exceeded.");
+        }
+    }
+
+protected:
+    struct State {
+        State(Clock::time_point deadline): cancelled(false), deadline(deadline)
+        {}
+
+        std::atomic<bool> cancelled;
+        const Clock::time_point deadline;
+    };
+
+    std::shared_ptr<State> state;
+};
+
+namespace detail {
+
+inline const Cancellation *&current_cancellation_slot() {
+    static thread_local const Cancellation *current = nullptr;
+    return current;
+}
+
+/**
+ * Make cancellation of executing call visible to current_cancellation() for the
+ * lifetime of this object.
+ */
+class CurrentCancellation {
+public:
+    explicit CurrentCancellation(const Cancellation &cancellation):
+        previous(current_cancellation_slot())
+    {
+        current_cancellation_slot() = &cancellation;
+    }
+
+    CurrentCancellation(const CurrentCancellation &) = delete;
+
+    ~CurrentCancellation() {
+        current_cancellation_slot() = previous;
+    }
+
+protected:
+    const Cancellation *previous;
+};
+
+} // namespace detail
+
+/**
+ * Cancellation of the method call executing on this thread. Outside of call, it is
+ * never cancelled.
+ */
+inline const Cancellation &current_cancellation() {
+    static const Cancellation none;
+    const Cancellation *current = detail::current_cancellation_slot();
+    return current != nullptr ? *current : none;
+}
+
+} // namespace rpc
+} // namespace json
+} // namespace gcm
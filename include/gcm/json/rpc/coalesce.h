@@ -0,0 +1,86 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gcm {
+namespace json {
+namespace rpc {
+
+/**
+ * Executing calls of one method, by cache_key() of their params. Identical calls that
+ * arrive meanwhile are parked as followers and finished with the result of the first.
+ */
+template<typename Call>
+class InFlight {
+public:
+    InFlight() = default;
+    InFlight(const InFlight &) = delete;
+
+    /**
+     * Returns true when no identical call is executing, so the caller has to execute it.
+     * Otherwise call is moved to followers of the executing one and false is returned.
+     */
+    bool join(const std::string &key, Call &call) {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        auto it = calls.find(key);
+        if (it == calls.end()) {
+            calls.emplace(key, std::vector<Call>());
+            return true;
+        }
+
+        it->second.push_back(std::move(call));
+        return false;
+    }
+
+    /**
+     * Finish executing call and return its followers. Identical call arriving after this
+     * is executed again.
+     */
+    std::vector<Call> leave(const std::string &key) {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        std::vector<Call> out;
+        auto it = calls.find(key);
+        if (it != calls.end()) {
+            out = std::move(it->second);
+            calls.erase(it);
+        }
+
+        return out;
+    }
+
+protected:
+    std::mutex mutex;
+    std::unordered_map<std::string, std::vector<Call>> calls;
+};
+
+} // namespace rpc
+} // namespace json
+} // namespace gcm
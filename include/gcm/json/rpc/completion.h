@@ -0,0 +1,93 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <memory>
+
+#include "../json.h"
+
+namespace gcm {
+namespace json {
+namespace rpc {
+
+class Cancellation;
+
+namespace detail {
+    class PendingCall;
+}
+
+/**
+ * Handle through which asynchronous method delivers its result. It can be copied,
+ * stored and called from any thread, only the first result counts. If all copies
+ * are destroyed without result, the call fails with internal error.
+ */
+class Completion {
+public:
+    explicit Completion(std::shared_ptr<detail::PendingCall> call):
+        call(std::move(call))
+    {}
+
+    /**
+     * Finish the call with result.
+     */
+    void operator()(JsonValue result) const;
+
+    /**
+     * Finish the call with error. RpcException is reported as is, other exceptions
+     * as internal error.
+     */
+    void fail(std::exception_ptr error) const;
+
+    template<typename E>
+    void fail(const E &error) const {
+        fail(std::make_exception_ptr(error));
+    }
+
+    /**
+     * Whether the call has been finished already.
+     */
+    bool is_done() const;
+
+    /**
+     * Cancellation of the call. Method can poll it and give up work whose caller is gone.
+     */
+    const Cancellation &cancellation() const;
+
+    /**
+     * Install check of the result, that throws when result is not valid. Used by
+     * validated registration.
+     */
+    void set_result_check(std::function<void(JsonValue &)> check) const;
+
+protected:
+    std::shared_ptr<detail::PendingCall> call;
+};
+
+using AsyncMethod = void(Array &params, Completion done);
+
+} // namespace rpc
+} // namespace json
+} // namespace gcm
@@ -0,0 +1,186 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+namespace gcm {
+namespace json {
+namespace rpc {
+
+/**
+ * Intrusive link for objects that can be pushed to CompletionQueue.
+ */
+class CompletionNode {
+public:
+    friend class CompletionQueue;
+
+    CompletionNode(): next(nullptr)
+    {}
+
+    CompletionNode(const CompletionNode &) = delete;
+
+protected:
+    std::atomic<CompletionNode *> next;
+};
+
+/**
+ * Multiple producer, single consumer queue of completed work (intrusive Vyukov queue).
+ * Producers push without locking, consumer pops in O(1) and sleeps only when the
+ * queue is empty. Mutex is touched by producer only when consumer is sleeping.
+ */
+class CompletionQueue {
+public:
+    CompletionQueue(): head(&stub), tail(&stub), waiting(false)
+    {}
+
+    CompletionQueue(const CompletionQueue &) = delete;
+
+    /**
+     * Push completed node. Can be called from any thread.
+     */
+    void push(CompletionNode *node) {
+        link(node);
+
+        // Pairs with fence in pop(), either consumer sees the node, or we see it waiting.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            cv.notify_one();
+        }
+    }
+
+    /**
+     * Pop completed node, or return nullptr if there is none. Consumer thread only.
+     */
+    CompletionNode *try_pop() {
+        CompletionNode *current = tail;
+        CompletionNode *next = current->next.load(std::memory_order_acquire);
+
+        if (current == &stub) {
+            if (next == nullptr) {
+                return nullptr;
+            }
+
+            tail = next;
+            current = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if (next != nullptr) {
+            tail = next;
+            return current;
+        }
+
+        if (current != head.load(std::memory_order_acquire)) {
+            // Producer is in the middle of push, its node is not linked yet.
+            return nullptr;
+        }
+
+        link(&stub);
+
+        next = current->next.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            tail = next;
+            return current;
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * Wait for completed node and pop it. Consumer thread only.
+     */
+    CompletionNode *pop() {
+        CompletionNode *node = try_pop();
+
+        while (node == nullptr) {
+            std::unique_lock<std::mutex> lock(mutex);
+            waiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            node = try_pop();
+            if (node == nullptr) {
+                cv.wait(lock);
+                node = try_pop();
+            }
+
+            waiting.store(false, std::memory_order_relaxed);
+        }
+
+        return node;
+    }
+
+    /**
+     * Wait at most timeout for completed node and pop it, nullptr if none came. Consumer
+     * thread only.
+     */
+    template<typename Rep, typename Period>
+    CompletionNode *pop_for(std::chrono::duration<Rep, Period> timeout) {
+        CompletionNode *node = try_pop();
+        if (node != nullptr) {
+            return node;
+        }
+
+        auto until = std::chrono::steady_clock::now() + timeout;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        node = try_pop();
+        while (node == nullptr && cv.wait_until(lock, until) != std::cv_status::timeout) {
+            node = try_pop();
+        }
+
+        if (node == nullptr) {
+            node = try_pop();
+        }
+
+        waiting.store(false, std::memory_order_relaxed);
+        return node;
+    }
+
+protected:
+    void link(CompletionNode *node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        CompletionNode *prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    CompletionNode stub;
+    std::atomic<CompletionNode *> head;
+    CompletionNode *tail;
+
+    std::atomic<bool> waiting;
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+} // namespace rpc
+} // namespace json
+} // namespace gcm
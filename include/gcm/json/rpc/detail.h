@@ -24,11 +24,17 @@
 #pragma once
 
 #include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
 
 #include <gcm/logging/logging.h>
 
 #include "types.h"
 #include "exception.h"
+#include "completion.h"
+#include "stats.h"
+#include "result_validation.h"
 #include "../validator.h"
 
 namespace gcm {
@@ -36,85 +42,210 @@ namespace json {
 namespace rpc {
 namespace detail {
 
-template<typename T>
+inline RpcException invalid_params(const validator::Problems &diag) {
+    json::Array array;
+
+    for (auto &problem: diag.get_problems()) {
+        array.push_back(problem.to_json());
+    }
+
+    return RpcException(
+        ErrorCode::InvalidParams,
+        validator::Problems::Message,
+        std::make_shared<Array>(std::move(array))
+    );
+}
+
+/**
+ * Enabled (as void) for callables that can be registered as method of given signature.
+ */
+template<typename F, typename Signature>
+using EnableIfMethod = std::enable_if_t<std::is_convertible<F, std::function<Signature>>::value>;
+
+/**
+ * Method with validated params. It keeps the callable of method as it is, so when stored
+ * in dispatch table, call of method is one type-erased call.
+ */
+template<typename F, typename T>
 class SafeCallback_t {
 public:
-    SafeCallback_t(gcm::logging::Logger &, std::function<Method> method, const std::string &, T params):
-        method(method),
+    SafeCallback_t(gcm::logging::Logger &, F method, const std::string &, T params):
+        method(std::move(method)),
         params(params)
     {}
 
     JsonValue operator()(Array &p) {
-        params.validate(p);
+        validator::Problems problems;
+        if (!params.validate(p, problems)) {
+            throw invalid_params(problems);
+        }
+
         return method(p);
     }
 
 protected:
-    std::function<Method> method;
+    F method;
     T params;
 };
 
-template<typename T, typename R>
-class SafeCallbackR_t {
+/**
+ * Validates result of one method according to ResultCheck of Rpc.
+ */
+template<typename R>
+class ResultValidator_t {
 public:
-    SafeCallbackR_t(gcm::logging::Logger &log, std::function<Method> method, const std::string &method_name, T params, R result):
+    ResultValidator_t(gcm::logging::Logger &log, const std::string &method_name, R result, const ResultCheck &check, MethodStats *stats):
         log(log),
-        method(method),
         method_name(method_name),
-        params(params),
-        result(result)
+        result(result),
+        check(check),
+        stats(stats)
     {}
 
-    JsonValue operator()(Array &p) {
-        try {
-            params.validate(p);
-            auto out = method(p);
-
-            // Validate result of function
-            validator::Diagnostics diag;
-            auto res = result(diag, out);
-            if (!res) {
-                ERROR(log) << "Method " << method_name << " returned invalid result:";
-                for (auto &problem: diag.get_problems()) {
-                    ERROR(log) << problem.get_item() << ": " << problem.get_description();
-                }
-
-                throw RpcException(ErrorCode::InternalError, "Function returned unexpected result.");
-                //throw diag;
-            }
-
-            return out;
-        } catch (validator::Diagnostics &diag) {
-            json::Array array;
-
-            for (auto &problem: diag.get_problems()) {
-                array.push_back(problem.to_json());
-            }
-
-            throw RpcException(
-                ErrorCode::InvalidParams,
-                diag.what(),
-                std::make_shared<Array>(std::move(array))
-            );
+    bool should_check() const {
+        return check.should_check();
+    }
+
+    /**
+     * Count and log invalid result. Throws if invalid result should fail the call.
+     */
+    void operator()(JsonValue &out) const {
+        validator::Problems problems;
+        if (result(problems, out)) {
+            return;
+        }
+
+        if (stats != nullptr) {
+            stats->record_invalid_result();
+        }
+
+        ERROR(log) << "Method " << method_name << " returned invalid result:";
+        for (auto &problem: problems.get_problems()) {
+            ERROR(log) << problem.get_item() << ": " << problem.get_description();
+        }
+
+        if (check.is_strict()) {
+            throw RpcException(ErrorCode::InternalError, "Function returned unexpected result.");
         }
     }
 
 protected:
     gcm::logging::Logger &log;
-    std::function<Method> method;
     std::string method_name;
-    T params;
     R result;
+    const ResultCheck &check;
+    MethodStats *stats;
 };
 
-template<typename T>
-auto SafeCallback(gcm::logging::Logger &log, std::function<Method> method, const std::string &method_name, T params) {
-    return SafeCallback_t<T>(log, method, method_name, params);
+template<typename F, typename T, typename R>
+class SafeCallbackR_t {
+public:
+    SafeCallbackR_t(gcm::logging::Logger &log, F method, const std::string &method_name, T params, R result,
+        const ResultCheck &check, MethodStats *stats):
+        method(std::move(method)),
+        params(params),
+        result(log, method_name, result, check, stats)
+    {}
+
+    JsonValue operator()(Array &p) {
+        validator::Problems problems;
+        if (!params.validate(p, problems)) {
+            throw invalid_params(problems);
+        }
+
+        auto out = method(p);
+
+        // Validate result of function
+        if (result.should_check()) {
+            result(out);
+        }
+
+        return out;
+    }
+
+protected:
+    F method;
+    T params;
+    ResultValidator_t<R> result;
+};
+
+template<typename F, typename T>
+class SafeAsyncCallback_t {
+public:
+    SafeAsyncCallback_t(gcm::logging::Logger &, F method, const std::string &, T params):
+        method(std::move(method)),
+        params(params)
+    {}
+
+    void operator()(Array &p, Completion done) {
+        validator::Problems problems;
+        if (!params.validate(p, problems)) {
+            throw invalid_params(problems);
+        }
+
+        method(p, done);
+    }
+
+protected:
+    F method;
+    T params;
+};
+
+template<typename F, typename T, typename R>
+class SafeAsyncCallbackR_t {
+public:
+    SafeAsyncCallbackR_t(gcm::logging::Logger &log, F method, const std::string &method_name, T params, R result,
+        const ResultCheck &check, MethodStats *stats):
+        method(std::move(method)),
+        params(params),
+        result(std::make_shared<ResultValidator_t<R>>(log, method_name, result, check, stats))
+    {}
+
+    void operator()(Array &p, Completion done) {
+        validator::Problems problems;
+        if (!params.validate(p, problems)) {
+            throw invalid_params(problems);
+        }
+
+        // Result is validated when the method delivers it.
+        if (result->should_check()) {
+            std::shared_ptr<const ResultValidator_t<R>> result = this->result;
+            done.set_result_check([result](JsonValue &out) {
+                (*result)(out);
+            });
+        }
+
+        method(p, done);
+    }
+
+protected:
+    F method;
+    T params;
+    std::shared_ptr<const ResultValidator_t<R>> result;
+};
+
+template<typename F, typename T>
+auto SafeCallback(gcm::logging::Logger &log, F method, const std::string &method_name, T params) {
+    return SafeCallback_t<F, T>(log, std::move(method), method_name, params);
+}
+
+template<typename F, typename T, typename R>
+auto SafeCallback(gcm::logging::Logger &log, F method, const std::string &method_name, T params, R result,
+    const ResultCheck &check, MethodStats *stats)
+{
+    return SafeCallbackR_t<F, T, R>(log, std::move(method), method_name, params, result, check, stats);
+}
+
+template<typename F, typename T>
+auto SafeAsyncCallback(gcm::logging::Logger &log, F method, const std::string &method_name, T params) {
+    return SafeAsyncCallback_t<F, T>(log, std::move(method), method_name, params);
 }
 
-template<typename T, typename R>
-auto SafeCallback(gcm::logging::Logger &log, std::function<Method> method, const std::string &method_name, T params, R result) {
-    return SafeCallbackR_t<T, R>(log, method, method_name, params, result);
+template<typename F, typename T, typename R>
+auto SafeAsyncCallback(gcm::logging::Logger &log, F method, const std::string &method_name, T params, R result,
+    const ResultCheck &check, MethodStats *stats)
+{
+    return SafeAsyncCallbackR_t<F, T, R>(log, std::move(method), method_name, params, result, check, stats);
 }
 
 } // namespace detail
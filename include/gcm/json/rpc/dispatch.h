@@ -0,0 +1,256 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <gcm/thread/pool.h>
+
+#include "types.h"
+#include "execution.h"
+#include "stats.h"
+#include "cache.h"
+#include "coalesce.h"
+#include "completion.h"
+
+namespace gcm {
+namespace json {
+namespace rpc {
+
+namespace detail {
+    class MethodProcessor;
+}
+
+/**
+ * Everything needed to execute call of one method, resolved once at freeze time.
+ */
+struct MethodEntry {
+    std::string name;
+    uint64_t hash;
+    std::function<Method> callback;
+    Execution execution;
+    gcm::thread::Pool<detail::MethodProcessor> *pool;
+    gcm::thread::Priority priority;
+    MethodStats *stats;
+
+    // Set instead of callback for methods registered by register_async_method.
+    std::function<AsyncMethod> async_callback;
+
+    // Responses of methods registered with CachePolicy, nullptr otherwise.
+    ResponseCache *cache;
+
+    // Executing calls of methods registered with coalescing CachePolicy, nullptr otherwise.
+    InFlight<detail::MethodProcessor> *in_flight;
+};
+
+/**
+ * Pre-resolved method. Valid for lifetime of Rpc that returned it, nullptr for unknown method.
+ */
+using MethodHandle = const MethodEntry *;
+
+/**
+ * Immutable method lookup table. Names are placed by hash and displace
+ * (CHD) perfect hashing, so lookup is one hash of the name, one probe and
+ * one string comparison. If no perfect placement is found, the table
+ * falls back to linear probing.
+ */
+class MethodTable {
+public:
+    MethodTable(): mask(0), seed_mask(0), perfect(true), seeds(1, 0), slots(1, 0)
+    {}
+
+    explicit MethodTable(std::vector<MethodEntry> &&methods):
+        entries(std::move(methods))
+    {
+        for (auto &entry: entries) {
+            entry.hash = hash(entry.name.data(), entry.name.size());
+        }
+
+        // At least one slot stays free, so that probing always terminates.
+        std::size_t size = 1;
+        while (size <= entries.size() + entries.size() / 4) {
+            size <<= 1;
+        }
+
+        mask = size - 1;
+        perfect = place_perfect() || place_linear();
+    }
+
+    MethodHandle find(const char *name, std::size_t length) const {
+        uint64_t h = hash(name, length);
+
+        if (perfect) {
+            uint32_t seed = seeds[(h >> 32) & seed_mask];
+            uint32_t index = slots[mix(h, seed) & mask];
+            return (index > 0 && matches(entries[index - 1], h, name, length)) ? &entries[index - 1] : nullptr;
+        }
+
+        for (std::size_t slot = h & mask; slots[slot] > 0; slot = (slot + 1) & mask) {
+            if (matches(entries[slots[slot] - 1], h, name, length)) {
+                return &entries[slots[slot] - 1];
+            }
+        }
+
+        return nullptr;
+    }
+
+    MethodHandle find(const std::string &name) const {
+        return find(name.data(), name.size());
+    }
+
+    bool is_perfect() const {
+        return perfect;
+    }
+
+    std::size_t size() const {
+        return entries.size();
+    }
+
+protected:
+    static constexpr const uint32_t MaxSeed = 1 << 16;
+
+    /**
+     * Hash of method name, consumes 8 bytes per step.
+     */
+    static uint64_t hash(const char *data, std::size_t length) {
+        const uint64_t k = 0x9e3779b97f4a7c15ULL;
+        uint64_t h = length * k;
+
+        for (; length >= 8; data += 8, length -= 8) {
+            uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            h = (h ^ word) * k;
+            h ^= h >> 29;
+        }
+
+        if (length > 0) {
+            uint64_t word = 0;
+            std::memcpy(&word, data, length);
+            h = (h ^ word) * k;
+            h ^= h >> 29;
+        }
+
+        // Lookup mixes the hash with bucket seed, only the bucket bits need spreading here.
+        return h ^ (h >> 32);
+    }
+
+    static uint64_t mix(uint64_t h, uint32_t seed) {
+        h += seed * 0x9e3779b97f4a7c15ULL;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
+
+    static bool matches(const MethodEntry &entry, uint64_t h, const char *name, std::size_t length) {
+        return entry.hash == h && entry.name.size() == length && std::memcmp(entry.name.data(), name, length) == 0;
+    }
+
+    bool place_perfect() {
+        slots.assign(mask + 1, 0);
+        std::size_t num_buckets = 1;
+        while (num_buckets * 4 < entries.size()) {
+            num_buckets <<= 1;
+        }
+
+        seeds.assign(num_buckets, 0);
+        seed_mask = num_buckets - 1;
+
+        std::vector<std::vector<uint32_t>> buckets(num_buckets);
+        for (uint32_t i = 0; i < entries.size(); ++i) {
+            buckets[(entries[i].hash >> 32) & seed_mask].push_back(i);
+        }
+
+        // Largest buckets first, while there is most free space.
+        std::vector<uint32_t> order(buckets.size());
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){
+            return buckets[a].size() > buckets[b].size();
+        });
+
+        std::vector<std::size_t> taken;
+        for (uint32_t b: order) {
+            bool placed = false;
+
+            for (uint32_t seed = 0; !placed && seed < MaxSeed; ++seed) {
+                taken.clear();
+                placed = true;
+
+                for (uint32_t index: buckets[b]) {
+                    std::size_t slot = mix(entries[index].hash, seed) & mask;
+                    if (slots[slot] != 0 || std::find(taken.begin(), taken.end(), slot) != taken.end()) {
+                        placed = false;
+                        break;
+                    }
+                    taken.push_back(slot);
+                }
+
+                if (placed) {
+                    seeds[b] = seed;
+                    for (std::size_t i = 0; i < taken.size(); ++i) {
+                        slots[taken[i]] = buckets[b][i] + 1;
+                    }
+                }
+            }
+
+            if (!placed) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool place_linear() {
+        slots.assign(mask + 1, 0);
+        seeds.clear();
+
+        for (uint32_t i = 0; i < entries.size(); ++i) {
+            std::size_t slot = entries[i].hash & mask;
+            while (slots[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = i + 1;
+        }
+
+        return false;
+    }
+
+    std::vector<MethodEntry> entries;
+    std::size_t mask;
+    std::size_t seed_mask;
+    bool perfect;
+    std::vector<uint32_t> seeds;
+    std::vector<uint32_t> slots;
+};
+
+} // namespace rpc
+} // namespace json
+} // namespace gcm
@@ -0,0 +1,194 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+#include "../json.h"
+#include "../raw.h"
+#include "../detail/scan.h"
+#include "exception.h"
+#include "types.h"
+
+namespace gcm {
+namespace json {
+namespace rpc {
+
+/**
+ * Fields of JSON-RPC request needed for dispatching. All of them are Raw values
+ * pointing into the request body, or nullptr if not present in the request.
+ */
+struct Envelope {
+    JsonValue id;
+    JsonValue method;
+    JsonValue params;
+};
+
+/**
+ * Scan one request object from buffer, starting at begin. Only id, method and
+ * params are extracted, nothing is parsed. The object is checked to be valid JSON
+ * though, as id and params can be written to response as they are. On success,
+ * begin is moved after the object (and trailing whitespace). When there is no more
+ * input or the object is malformed, false is returned and begin points to the
+ * place of error.
+ */
+inline bool scan_envelope(const Buffer &buffer, const char *&begin, const char *end, Envelope &envelope) {
+    using json::detail::skip_ws;
+
+    const char *p = skip_ws(begin, end);
+    begin = p;
+
+    if (p == end) {
+        return false;
+    }
+
+    if (*p != '{') {
+        const char *value_end = p;
+        if (json::detail::skip_valid_value(value_end, end)) {
+            throw RpcException(ErrorCode::InvalidRequest, "Request must be JSON object.");
+        }
+        return false;
+    }
+
+    envelope = Envelope();
+
+    p = skip_ws(p + 1, end);
+    while (p != end && *p != '}') {
+        // Key
+        if (*p != '"') {
+            begin = p;
+            return false;
+        }
+
+        const char *key_begin = p + 1;
+        if (!json::detail::skip_valid_string(p, end)) {
+            begin = p;
+            return false;
+        }
+        const char *key_end = p - 1;
+
+        p = skip_ws(p, end);
+        if (p == end || *p != ':') {
+            begin = p;
+            return false;
+        }
+
+        // Value
+        p = skip_ws(p + 1, end);
+        const char *value_begin = p;
+        if (!json::detail::skip_valid_value(p, end)) {
+            begin = p;
+            return false;
+        }
+
+        JsonValue *target = nullptr;
+        std::size_t key_size = key_end - key_begin;
+        if (key_size == 2 && std::memcmp(key_begin, "id", 2) == 0) {
+            target = &envelope.id;
+        } else if (key_size == 6 && std::memcmp(key_begin, "method", 6) == 0) {
+            target = &envelope.method;
+        } else if (key_size == 6 && std::memcmp(key_begin, "params", 6) == 0) {
+            target = &envelope.params;
+        }
+
+        if (target != nullptr) {
+            *target = make_raw(buffer, value_begin, p);
+        }
+
+        p = skip_ws(p, end);
+        if (p != end && *p == ',') {
+            p = skip_ws(p + 1, end);
+        } else if (p != end && *p != '}') {
+            begin = p;
+            return false;
+        }
+    }
+
+    if (p == end) {
+        begin = p;
+        return false;
+    }
+
+    begin = skip_ws(p + 1, end);
+    return true;
+}
+
+/**
+ * Scan batch request (JSON array of request objects) starting at begin. Returns false
+ * if there is no array at begin, or the array is malformed, in which case begin points
+ * to the place of error. Items that are not objects are stored as empty envelopes, so
+ * each of them gets its own Invalid Request response.
+ */
+inline bool scan_batch(const Buffer &buffer, const char *&begin, const char *end, std::vector<Envelope> &items) {
+    using json::detail::skip_ws;
+
+    const char *p = skip_ws(begin, end);
+    if (p == end || *p != '[') {
+        begin = p;
+        return false;
+    }
+
+    p = skip_ws(p + 1, end);
+    while (p != end && *p != ']') {
+        if (*p == '{') {
+            Envelope envelope;
+            if (!scan_envelope(buffer, p, end, envelope)) {
+                begin = p;
+                return false;
+            }
+            items.push_back(std::move(envelope));
+        } else {
+            if (!json::detail::skip_valid_value(p, end)) {
+                begin = p;
+                return false;
+            }
+            items.emplace_back();
+        }
+
+        p = skip_ws(p, end);
+        if (p != end && *p == ',') {
+            p = skip_ws(p + 1, end);
+            if (p != end && *p == ']') {
+                begin = p;
+                return false;
+            }
+        } else if (p != end && *p != ']') {
+            begin = p;
+            return false;
+        }
+    }
+
+    if (p == end) {
+        begin = p;
+        return false;
+    }
+
+    begin = skip_ws(p + 1, end);
+    return true;
+}
+
+} // namespace rpc
+} // namespace json
+} // namespace gcm
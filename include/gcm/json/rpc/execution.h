@@ -0,0 +1,78 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <gcm/thread/pool.h>
+
+namespace gcm {
+namespace json {
+namespace rpc {
+
+/**
+ * Where method calls are executed.
+ */
+enum class Execution {
+    /** On the thread that received the request. No handoff, for cheap non-blocking methods. */
+    Inline,
+
+    /** On the executor, shared with the server if it was given to Rpc. */
+    Pool,
+
+    /** On dedicated named pool, so blocking methods can not starve the others. */
+    Bulkhead
+};
+
+struct ExecutionPolicy {
+    Execution execution;
+
+    // Bulkhead only. Methods registered with the same name share the pool,
+    // limits of the first registration are used.
+    std::string pool_name;
+    std::size_t min_spare;
+    std::size_t max_workers;
+
+    // Queue the calls wait in for a free worker of the pool.
+    gcm::thread::Priority priority;
+};
+
+inline ExecutionPolicy Inline() {
+    return {Execution::Inline, "", 0, 0, gcm::thread::Priority::Critical};
+}
+
+inline ExecutionPolicy Pooled(gcm::thread::Priority priority = gcm::thread::Priority::Interactive) {
+    return {Execution::Pool, "", 0, 0, priority};
+}
+
+inline ExecutionPolicy Bulkhead(const std::string &pool_name, std::size_t min_spare = 1, std::size_t max_workers = 10,
+    gcm::thread::Priority priority = gcm::thread::Priority::Interactive)
+{
+    return {Execution::Bulkhead, pool_name, min_spare, max_workers, priority};
+}
+
+} // namespace rpc
+} // namespace json
+} // namespace gcm
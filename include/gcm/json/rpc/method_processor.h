@@ -23,17 +23,26 @@
 
 #pragma once
 
+#include <atomic>
+#include <exception>
 #include <memory>
 #include <string>
 #include <chrono>
-#include <iomanip>
+#include <vector>
 
 #include <gcm/logging/logging.h>
 
 #include "../json.h"
+#include "../raw.h"
 #include "types.h"
 #include "promise.h"
 #include "exception.h"
+#include "stats.h"
+#include "cache.h"
+#include "dispatch.h"
+#include "completion.h"
+#include "cancellation.h"
+#include "access_log.h"
 
 namespace gcm {
 namespace json {
@@ -42,94 +51,374 @@ namespace detail {
 
 class MethodProcessor {
 public:
-    MethodProcessor(gcm::logging::Logger &log, MethodRegistry &registry, std::shared_ptr<Promise> promise, JsonValue request_id, std::string &&method, Array &&params):
+    MethodProcessor(const AccessLog &log, MethodHandle entry, std::shared_ptr<Promise> promise, JsonValue request_id, std::string &&method, Array &&params,
+        Cancellation cancellation = Cancellation()):
         log(log),
-        registry(registry),
+        entry(entry),
         promise(promise),
         request_id(request_id),
         method(std::forward<std::string>(method)),
-        params(std::forward<Array>(params))
+        params(std::forward<Array>(params)),
+        cancellation(std::move(cancellation))
+    {}
+
+    /**
+     * Request with params that are not parsed yet (see Raw). Params are split on the
+     * worker thread, and each of them is parsed only when the method accesses it.
+     */
+    MethodProcessor(const AccessLog &log, MethodHandle entry, std::shared_ptr<Promise> promise, JsonValue request_id, std::string &&method, JsonValue &&lazy_params,
+        Cancellation cancellation = Cancellation()):
+        log(log),
+        entry(entry),
+        promise(promise),
+        request_id(request_id),
+        method(std::forward<std::string>(method)),
+        lazy_params(std::forward<JsonValue>(lazy_params)),
+        cancellation(std::move(cancellation))
     {}
 
     void operator()() {
-        std::chrono::high_resolution_clock::time_point tm_start = std::chrono::high_resolution_clock::now();
+        tm_start = std::chrono::high_resolution_clock::now();
+
+        try {
+            // Call waited in queue past its deadline, or nobody waits for it anymore.
+            cancellation.check();
+
+            if (lazy_params && lazy_params->get_type() == ValueType::Array) {
+                params = split_array(*lazy_params);
+            }
+
+            if (entry == nullptr) {
+                throw MethodNotFound(JsonValue(request_id), method);
+            }
+
+            if (entry->cache != nullptr || entry->in_flight != nullptr) {
+                cache_key = rpc::cache_key(params);
+            }
+
+            if (entry->cache != nullptr) {
+
+                JsonValue cached;
+                bool hit = entry->cache->get(cache_key, cached);
+
+                if (entry->stats != nullptr) {
+                    entry->stats->record_cache(hit);
+                }
+
+                if (hit) {
+                    cache_key.clear();
+                    finish(std::move(cached));
+                    return;
+                }
+            }
+
+            if (entry->in_flight != nullptr) {
+                // Identical call is executing, this one is finished together with it.
+                if (!entry->in_flight->join(cache_key, *this)) {
+                    return;
+                }
+
+                leader = true;
+            }
+        } catch (...) {
+            fail(std::current_exception());
+            return;
+        }
+
+        execute();
+    }
+
+    MethodHandle get_entry() const {
+        return entry;
+    }
+
+    const Cancellation &get_cancellation() const {
+        return cancellation;
+    }
+
+    /**
+     * Respond with result of the call.
+     */
+    void finish(JsonValue result) {
+        if (leader) {
+            for (auto &follower: leave()) {
+                follower.finish(result);
+            }
+        }
+
+        // Key is set only on cache miss.
+        if (!cache_key.empty() && entry->cache != nullptr) {
+            entry->cache->put(std::move(cache_key), result);
+        }
+
+        if (!promise) {
+            // Notification, nobody reads the response.
+            record(0);
+            return;
+        }
 
         auto response = Object();
         response["jsonrpc"] = make_string("2.0");
         response["id"] = request_id;
+        response["result"] = std::move(result);
 
-        bool is_success = true;
+        respond(std::move(response), 0);
+    }
 
-        std::string str_params = params.to_string();
-        INFO(log) << "Calling method " << method << "(" << str_params.substr(1, str_params.size() - 2) << ").";
+    /**
+     * Respond with error the call ended with.
+     */
+    void fail(std::exception_ptr exception) {
+        std::vector<MethodProcessor> successor;
 
+        if (leader) {
+            auto followers = leave();
+
+            if (cancellation.is_cancelled()) {
+                // Error belongs to this call only, identical calls still waiting are executed again.
+                successor = hand_over(followers);
+            } else {
+                for (auto &follower: followers) {
+                    follower.fail(exception);
+                }
+            }
+        }
+
+        respond_error(exception);
+
+        for (auto &next: successor) {
+            next.execute();
+        }
+    }
+
+    /**
+     * Respond with error without executing the call.
+     */
+    void reject(std::exception_ptr exception) {
+        tm_start = std::chrono::high_resolution_clock::now();
+        fail(exception);
+    }
+
+protected:
+    void start_async();
+
+    /**
+     * Call the method, after cache and coalescing were resolved.
+     */
+    void execute() {
         try {
-            auto it = registry.find(method);
-            if (it == registry.end()) {
-                throw MethodNotFound(std::forward<JsonValue>(request_id), method);
+            if (entry->async_callback) {
+                start_async();
+                return;
+            }
+
+            detail::CurrentCancellation current(cancellation);
+            finish(entry->callback(params));
+        } catch (...) {
+            fail(std::current_exception());
+        }
+    }
+
+    /**
+     * Followers of leader that was cancelled or ran past its deadline. Those that are not
+     * cancelled themselves join the call again; the one that becomes leader is returned,
+     * to be executed by the caller.
+     */
+    std::vector<MethodProcessor> hand_over(std::vector<MethodProcessor> &followers) {
+        std::vector<MethodProcessor> successor;
+
+        for (auto &follower: followers) {
+            try {
+                follower.cancellation.check();
+            } catch (...) {
+                follower.fail(std::current_exception());
+                continue;
             }
 
-            auto &result = response["result"];
-            result = it->second(params);
+            follower.cache_key = cache_key;
+            if (entry->in_flight->join(cache_key, follower)) {
+                follower.leader = true;
+                successor.push_back(std::move(follower));
+            }
+        }
+
+        return successor;
+    }
+
+    void respond_error(std::exception_ptr exception) {
+        if (!promise) {
+            record(error_code(exception));
+            return;
+        }
+
+        auto response = Object();
+        response["jsonrpc"] = make_string("2.0");
+        response["id"] = request_id;
+
+        try {
+            std::rethrow_exception(exception);
         } catch (RpcException &e) {
-            is_success = false;
             response["error"] = e.to_json(false);
+        } catch (ParseException &e) {
+            response["error"] = RpcException(ErrorCode::ParseError, e.what()).to_json(false);
         } catch (std::exception &e) {
-            is_success = false;
             auto &error = to<Object>(response["error"] = make_object());
             error["code"] = make_int(ErrorCode::InternalError);
             error["message"] = make_string(e.what());
         } catch (...) {
-            is_success = false;
             auto &error = to<Object>(response["error"] = make_object());
             error["code"] = make_int(ErrorCode::InternalError);
             error["message"] = make_string("Server error.");
         }
 
-        std::chrono::microseconds method_duration =
-            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - tm_start);
+        int code = static_cast<int>(to<Int>(to<Object>(response["error"])["code"]));
+        respond(std::move(response), code);
+    }
 
-        std::string str_status;
-        if (is_success) {
-            str_status = "OK";
-        } else {
-            int code = to<Int>(to<Object>(response["error"])["code"]);
-            switch (code) {
-                case static_cast<int>(ErrorCode::ParseError): str_status = "ParseError"; break;
-                case static_cast<int>(ErrorCode::InvalidRequest): str_status = "InvalidRequest"; break;
-                case static_cast<int>(ErrorCode::MethodNotFound): str_status = "MethodNotFound"; break;
-                case static_cast<int>(ErrorCode::InvalidParams): str_status = "InvalidParams"; break;
-                case static_cast<int>(ErrorCode::InternalError): str_status = "InternalError"; break;
-                case static_cast<int>(ErrorCode::ServerError): str_status = "ServerError"; break;
-                default: str_status = std::to_string(code); break;
-            }
+    /**
+     * Stop accepting identical calls and return those that waited for this one.
+     */
+    std::vector<MethodProcessor> leave() {
+        leader = false;
+
+        auto followers = entry->in_flight->leave(cache_key);
+        for (auto &follower: followers) {
+            // Result is stored by the leader.
+            follower.cache_key.clear();
         }
 
-        INFO(log) << method << "(" << str_params.substr(1, str_params.size() - 2) << ") "
-            << "status=" << str_status << "; "
-            << "time=" << std::setprecision(3) << (method_duration.count() / 1000.0) << "ms";
+        return followers;
+    }
+
+    static int error_code(std::exception_ptr exception) {
+        try {
+            std::rethrow_exception(exception);
+        } catch (RpcException &e) {
+            return e.get_code();
+        } catch (ParseException &) {
+            return static_cast<int>(ErrorCode::ParseError);
+        } catch (...) {
+            return static_cast<int>(ErrorCode::InternalError);
+        }
+    }
+
+    void respond(Object &&response, int code) {
+        record(code);
 
         // Notify of job done.
-        promise->result = std::make_shared<Object>(response);
-        promise->has_result = true;
+        promise->set_result(std::make_shared<Object>(std::move(response)));
+    }
 
-        if (promise->notify_done != nullptr) {
-            promise->notify_done->notify_one();
+    /**
+     * Record stats and log the finished call.
+     */
+    void record(int code) {
+        std::chrono::microseconds method_duration =
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - tm_start);
+
+        if (entry != nullptr && entry->stats != nullptr) {
+            entry->stats->record(method_duration, call_status(code));
         }
 
-        promise->cb.notify_one();
+        log.write(method, params, lazy_params, method_duration, code);
     }
 
 protected:
-    gcm::logging::Logger &log;
-    MethodRegistry &registry;
+    const AccessLog &log;
+    MethodHandle entry;
     std::shared_ptr<Promise> promise;
     JsonValue request_id;
     std::string method;
+    JsonValue lazy_params;
     Array params;
+
+    std::chrono::high_resolution_clock::time_point tm_start;
+    std::string cache_key;
+    bool leader = false;
+
+    Cancellation cancellation;
 };
 
+/**
+ * State of asynchronous call, shared by all copies of its Completion.
+ */
+class PendingCall {
+public:
+    PendingCall(MethodProcessor &&processor):
+        processor(std::move(processor)),
+        done(false)
+    {}
+
+    PendingCall(const PendingCall &) = delete;
+
+    ~PendingCall() {
+        if (!done.exchange(true)) {
+            processor.fail(std::make_exception_ptr(
+                RpcException(ErrorCode::InternalError, "Method finished without result.")
+            ));
+        }
+    }
+
+    void finish(JsonValue &&result) {
+        if (check) {
+            try {
+                check(result);
+            } catch (...) {
+                fail(std::current_exception());
+                return;
+            }
+        }
+
+        if (!done.exchange(true)) {
+            processor.finish(std::move(result));
+        }
+    }
+
+    void fail(std::exception_ptr exception) {
+        if (!done.exchange(true)) {
+            processor.fail(exception);
+        }
+    }
+
+    MethodProcessor processor;
+    std::atomic<bool> done;
+    std::function<void(JsonValue &)> check;
+};
+
+inline void MethodProcessor::start_async() {
+    auto call = std::make_shared<PendingCall>(std::move(*this));
+    auto &processor = call->processor;
+
+    try {
+        detail::CurrentCancellation current(processor.cancellation);
+        processor.entry->async_callback(processor.params, Completion(call));
+    } catch (...) {
+        call->fail(std::current_exception());
+    }
+}
+
 } // namespace detail
+
+inline void Completion::operator()(JsonValue result) const {
+    call->finish(std::move(result));
+}
+
+inline void Completion::fail(std::exception_ptr error) const {
+    call->fail(error);
+}
+
+inline bool Completion::is_done() const {
+    return call->done.load();
+}
+
+inline const Cancellation &Completion::cancellation() const {
+    return call->processor.get_cancellation();
+}
+
+inline void Completion::set_result_check(std::function<void(JsonValue &)> check) const {
+    call->check = std::move(check);
+}
+
 } // namespace rpc
 } // namespace json
 } // namespace gcm
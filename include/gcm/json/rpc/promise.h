@@ -23,10 +23,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 
 #include "../json.h"
+#include "completion_queue.h"
 
 namespace gcm {
 namespace json {
@@ -36,22 +40,22 @@ namespace detail {
     class MethodProcessor;
 }
 
-class Promise {
+class Promise: public CompletionNode {
 public:
     friend class detail::MethodProcessor;
 
-    Promise(): notify_done(nullptr), has_result(false)
+    Promise(): has_result(false)
     {}
 
     void wait() {
-        while (!has_result) {
-            std::unique_lock<std::mutex> lk(mutex);
-            cb.wait(lk);
-        }
+        std::unique_lock<std::mutex> lk(mutex);
+        cb.wait(lk, [&](){
+            return has_result.load(std::memory_order_acquire);
+        });
     }
 
     bool try_wait() {
-        return has_result;
+        return has_result.load(std::memory_order_acquire);
     }
 
     JsonValue get() {
@@ -59,17 +63,72 @@ public:
         return result;
     }
 
-public:
-    std::condition_variable *notify_done;
+    /**
+     * Push this promise to queue when it is done. If it is done already, it is pushed
+     * immediately, so no completion is lost regardless of when the queue is attached.
+     */
+    void notify(std::shared_ptr<CompletionQueue> queue) {
+        {
+            std::unique_lock<std::mutex> lk(mutex);
+            if (!has_result.load(std::memory_order_relaxed)) {
+                completion_queue = std::move(queue);
+                return;
+            }
+        }
+
+        queue->push(this);
+    }
+
+    /**
+     * Pass result to callback when this promise is done, on the thread that sets it. If it
+     * is done already, callback is called immediately. Only one callback can be set.
+     */
+    void then(std::function<void(JsonValue)> callback) {
+        {
+            std::unique_lock<std::mutex> lk(mutex);
+            if (!has_result.load(std::memory_order_relaxed)) {
+                done_callback = std::move(callback);
+                return;
+            }
+        }
+
+        callback(result);
+    }
 
 protected:
+    void set_result(JsonValue value) {
+        std::shared_ptr<CompletionQueue> queue;
+        std::function<void(JsonValue)> callback;
+
+        {
+            std::unique_lock<std::mutex> lk(mutex);
+            result = std::move(value);
+            has_result.store(true, std::memory_order_release);
+            queue = std::move(completion_queue);
+            callback = std::move(done_callback);
+        }
+
+        cb.notify_all();
+
+        // Queue is held by shared_ptr, so consumer can not destroy it while we push.
+        if (queue) {
+            queue->push(this);
+        }
+
+        if (callback) {
+            callback(result);
+        }
+    }
+
     std::condition_variable cb;
     std::mutex mutex;
 
-    bool has_result;
+    std::atomic<bool> has_result;
     JsonValue result;
+    std::shared_ptr<CompletionQueue> completion_queue;
+    std::function<void(JsonValue)> done_callback;
 };
 
-} // namespace gcm
+} // namespace rpc
 } // namespace json
 } // namespace gcm
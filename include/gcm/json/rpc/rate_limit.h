@@ -0,0 +1,254 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace gcm {
+namespace json {
+namespace rpc {
+
+/**
+ * Token bucket: sustained number of calls per second, and number of calls that can be
+ * made at once when the bucket is full.
+ */
+struct RateLimit {
+    double rate;
+    double burst;
+};
+
+/**
+ * Token buckets of one limit, by key. Bucket is kept as theoretical arrival time of
+ * the next call (GCRA), so taking a token is a compare-and-swap of one word. Slots are
+ * split into shards and probed without locks; slot whose bucket is full again is the
+ * same as a new one, so it is taken over by other key when needed.
+ */
+class RateLimiter {
+public:
+    static constexpr const std::size_t Shards = 16;
+    static constexpr const std::size_t Probes = 8;
+
+    explicit RateLimiter(RateLimit limit, std::size_t max_entries = 4096):
+        interval(limit.rate > 0 ? static_cast<int64_t>(1e6 / limit.rate) : 0),
+        tolerance(static_cast<int64_t>(interval * std::max(limit.burst, 1.0))),
+        shard_size(std::max(max_entries / Shards, static_cast<std::size_t>(Probes))),
+        slots(new Slot[Shards * shard_size])
+    {}
+
+    RateLimiter(const RateLimiter &) = delete;
+
+    /**
+     * Take one token from bucket of key. Returns false when the bucket is empty.
+     */
+    bool try_acquire(const std::string &key) {
+        return try_acquire(key, now());
+    }
+
+    /**
+     * Take one token at given time, in microseconds of steady clock.
+     */
+    bool try_acquire(const std::string &key, int64_t now_us) {
+        if (interval == 0) {
+            return true;
+        }
+
+        Slot *slot = find(hash(key), now_us);
+        if (slot == nullptr) {
+            // All slots are taken by active keys, limit of one key is not worth
+            // rejecting calls of everybody.
+            return true;
+        }
+
+        int64_t tat = slot->tat.load(std::memory_order_relaxed);
+        while (true) {
+            int64_t next = std::max(tat, now_us) + interval;
+            if (next - now_us > tolerance) {
+                return false;
+            }
+
+            if (slot->tat.compare_exchange_weak(tat, next, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+
+    /**
+     * Return token taken by try_acquire() at given time, for call that is not made
+     * after all.
+     */
+    void release(const std::string &key, int64_t now_us) {
+        if (interval == 0) {
+            return;
+        }
+
+        Slot *slot = find(hash(key), now_us);
+        if (slot == nullptr) {
+            return;
+        }
+
+        int64_t tat = slot->tat.load(std::memory_order_relaxed);
+        while (tat > now_us) {
+            int64_t prev = std::max(tat - interval, now_us);
+            if (slot->tat.compare_exchange_weak(tat, prev, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+protected:
+    struct Slot {
+        std::atomic<uint64_t> key{0};
+        std::atomic<int64_t> tat{0};
+    };
+
+    static uint64_t hash(const std::string &key) {
+        uint64_t h = std::hash<std::string>()(key);
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+
+        // Zero marks a slot that was never used.
+        return h != 0 ? h : 1;
+    }
+
+    /**
+     * Slot of key, taking over first idle one if the key has none. Key can lose its slot
+     * only while its bucket is full, so call racing with the takeover is at most
+     * counted to the new key.
+     */
+    Slot *find(uint64_t h, int64_t now_us) {
+        Slot *shard = &slots[(h % Shards) * shard_size];
+        std::size_t start = (h / Shards) % shard_size;
+
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            Slot *idle = nullptr;
+            uint64_t idle_key = 0;
+
+            for (std::size_t i = 0; i < Probes; ++i) {
+                Slot &slot = shard[(start + i) % shard_size];
+                uint64_t key = slot.key.load(std::memory_order_acquire);
+
+                if (key == h) {
+                    return &slot;
+                }
+
+                if (idle == nullptr && slot.tat.load(std::memory_order_relaxed) <= now_us) {
+                    idle = &slot;
+                    idle_key = key;
+                }
+
+                if (key == 0) {
+                    // Slots are never emptied, so the key is not further.
+                    break;
+                }
+            }
+
+            if (idle == nullptr) {
+                return nullptr;
+            }
+
+            if (idle->key.compare_exchange_strong(idle_key, h, std::memory_order_acq_rel)) {
+                return idle;
+            }
+        }
+
+        return nullptr;
+    }
+
+    int64_t interval;
+    int64_t tolerance;
+    std::size_t shard_size;
+    std::unique_ptr<Slot[]> slots;
+};
+
+/**
+ * Limits of calls per client, and per client and method. Set up before serving, only
+ * read afterwards.
+ */
+class RateLimits {
+public:
+    void set_client_limit(RateLimit limit, std::size_t max_entries = 4096) {
+        client = std::make_unique<RateLimiter>(limit, max_entries);
+    }
+
+    void set_method_limit(const std::string &method, RateLimit limit, std::size_t max_entries = 4096) {
+        methods[method] = std::make_unique<RateLimiter>(limit, max_entries);
+    }
+
+    bool empty() const {
+        return !client && methods.empty();
+    }
+
+    /**
+     * Take token for call of method from client. Returns false if the call has to be
+     * rejected.
+     */
+    bool try_acquire(const std::string &client_address, const std::string &method) {
+        return try_acquire(client_address, method, RateLimiter::now());
+    }
+
+    /**
+     * Take token at given time, in microseconds of steady clock. Token of method is given
+     * back when the client limit rejects the call, as the call is not executed.
+     */
+    bool try_acquire(const std::string &client_address, const std::string &method, int64_t now_us) {
+        auto it = methods.find(method);
+        RateLimiter *method_limiter = it != methods.end() ? it->second.get() : nullptr;
+
+        if (method_limiter != nullptr && !method_limiter->try_acquire(client_address, now_us)) {
+            return false;
+        }
+
+        if (client && !client->try_acquire(client_address, now_us)) {
+            if (method_limiter != nullptr) {
+                method_limiter->release(client_address, now_us);
+            }
+            return false;
+        }
+
+        return true;
+    }
+
+protected:
+    std::unique_ptr<RateLimiter> client;
+    std::unordered_map<std::string, std::unique_ptr<RateLimiter>> methods;
+};
+
+} // namespace rpc
+} // namespace json
+} // namespace gcm
@@ -0,0 +1,100 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include "stats.h"
+
+namespace gcm {
+namespace json {
+namespace rpc {
+
+/**
+ * How results of methods registered with result definition are validated.
+ */
+enum class ResultValidation {
+    // Every result is validated, invalid one fails the call with Internal Error.
+    Always,
+
+    // Only sampled results are validated. Invalid one is logged and counted, but
+    // still delivered to the client.
+    Sampled,
+
+    // Results are not validated.
+    Off
+};
+
+struct ResultValidationPolicy {
+    ResultValidation mode;
+
+    // With Sampled mode, one of this many results is validated.
+    unsigned sample_every;
+};
+
+/**
+ * Decides which results are validated, shared by all methods of one Rpc.
+ */
+class ResultCheck {
+public:
+    explicit ResultCheck(ResultValidationPolicy policy = ResultValidationPolicy{ResultValidation::Always, 1}):
+        policy(policy)
+    {}
+
+    void set_policy(const ResultValidationPolicy &policy) {
+        this->policy = policy;
+    }
+
+    ResultValidation get_mode() const {
+        return policy.mode;
+    }
+
+    /**
+     * Whether result of the current call should be validated.
+     */
+    bool should_check() const {
+        switch (policy.mode) {
+            case ResultValidation::Always:
+                return true;
+
+            case ResultValidation::Sampled:
+                return policy.sample_every <= 1 || detail::thread_random() % policy.sample_every == 0;
+
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Whether invalid result fails the call.
+     */
+    bool is_strict() const {
+        return policy.mode == ResultValidation::Always;
+    }
+
+protected:
+    ResultValidationPolicy policy;
+};
+
+} // namespace rpc
+} // namespace json
+} // namespace gcm
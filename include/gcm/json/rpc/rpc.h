@@ -23,16 +23,30 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <string>
 #include <map>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
 
 #include <gcm/thread/pool.h>
+#include <gcm/thread/executor.h>
 #include <gcm/thread/signal.h>
 
 #include "detail.h"
+#include "execution.h"
 #include "method_processor.h"
+#include "stats.h"
+#include "cache.h"
+#include "dispatch.h"
+#include "access_log.h"
+#include "result_validation.h"
+#include "typed.h"
 #include "../validator.h"
 
 namespace gcm {
@@ -45,14 +59,391 @@ public:
         Rpc(gcm::logging::getLogger("json-rpc"))
     {}
 
+    /**
+     * Rpc with its own executor, used by calls of methods without execution policy.
+     */
     Rpc(gcm::logging::Logger &log):
-        on_sigint(gcm::thread::Signal::at(SIGINT, std::bind(&Rpc::stop, this))),
+        access_log(log),
+        own_executor(std::make_unique<gcm::thread::Executor>()),
+        executor(*own_executor),
+        on_sigint(gcm::thread::Signal::at(SIGINT, std::bind(&Rpc::reject_queued, this))),
         log(log)
     {
+        register_system_methods();
+    }
+
+    /**
+     * Rpc executing calls on executor shared with the server. Executor must outlive the Rpc.
+     */
+    Rpc(gcm::logging::Logger &log, gcm::thread::Executor &executor):
+        access_log(log),
+        executor(executor),
+        on_sigint(gcm::thread::Signal::at(SIGINT, std::bind(&Rpc::reject_queued, this))),
+        log(log)
+    {
+        register_system_methods();
+    }
+
+    Rpc(const Rpc &) = delete;
+
+    ~Rpc() {
+        stop();
+    }
+
+    /**
+     * Set which calls are written to access log, see AccessLogPolicy. Not synchronized
+     * with running calls, set it before serving.
+     */
+    void set_access_log(const AccessLogPolicy &policy) {
+        access_log.set_policy(policy);
+    }
+
+    /**
+     * Set which method results are validated against their result definition. Not
+     * synchronized with running calls, set it before serving.
+     */
+    void set_result_validation(const ResultValidationPolicy &policy) {
+        result_check.set_policy(policy);
+    }
+
+    /**
+     * Scheduling of priority queues of all bulkheads, and of the executor if it is owned
+     * by this Rpc (see gcm::thread::Pool::set_scheduling()). Shared executor is set up
+     * by its owner.
+     */
+    void set_scheduling(const std::array<unsigned, gcm::thread::NumPriorities> &weights, std::chrono::milliseconds max_wait) {
+        this->weights = weights;
+        this->max_wait = max_wait;
+
+        if (own_executor) {
+            own_executor->set_scheduling(weights, max_wait);
+        }
+
+        for (auto &it: bulkheads) {
+            it.second->set_scheduling(weights, max_wait);
+        }
+    }
+
+    /**
+     * Max. number of calls of this Rpc queued on or executed by the executor at once, 0 for
+     * no limit. Calls over it are executed on the calling thread, so one busy interface
+     * does not take every worker of the shared executor. Not synchronized with running
+     * calls, set it before serving.
+     *
+     * It bounds only calls on the executor. Calling threads (connections of interfaces,
+     * each interface with its own pool) are not counted, and nothing caps the threads of
+     * all interfaces together: up to sum of their MaxThreads plus max_workers of the
+     * executor.
+     */
+    void set_max_queued(std::size_t max_queued) {
+        this->max_queued = max_queued;
+    }
+
+    /**
+     * Fail calls waiting in queue of the executor with Server Error instead of executing
+     * them, including calls queued later. It does not wait for anything, so it is what
+     * SIGINT does; stop() follows when the Rpc is destroyed.
+     */
+    void reject_queued() {
+        stopping.store(true);
+    }
+
+    /**
+     * Stop executing calls. Own executor is stopped; calls queued on shared executor are
+     * rejected, and only the running ones are waited for, as they use the methods.
+     */
+    void stop() {
+        reject_queued();
+
+        if (own_executor) {
+            own_executor->stop();
+        } else {
+            std::unique_lock<std::mutex> lock(queued_mutex);
+            while (!queued_cond.wait_for(lock, std::chrono::seconds(5), [&](){ return num_queued == 0; })) {
+                WARNING(log) << "Waiting for " << num_queued << " running calls to finish.";
+            }
+        }
+
+        for (auto &it: bulkheads) {
+            it.second->stop();
+        }
+    }
+
+    /**
+     * Build immutable dispatch table from registered methods. Handler should call it once
+     * modules are initialized, otherwise it is done by first call. Methods can not be
+     * registered after that.
+     */
+    void freeze() {
+        std::call_once(frozen_flag, [&](){
+            std::vector<MethodEntry> entries;
+            entries.reserve(methods.size());
+
+            for (auto &it: methods) {
+                auto &target = targets[it.first];
+                entries.push_back(MethodEntry{
+                    it.first, 0, it.second, target.execution, target.pool, target.priority, target.stats, async_methods[it.first], target.cache, target.in_flight
+                });
+            }
+
+            table = MethodTable(std::move(entries));
+            frozen = true;
+
+            INFO(log) << "Dispatch table frozen with " << table.size() << " methods"
+                << (table.is_perfect() ? " (perfect hash)." : ".");
+        });
+    }
+
+    /**
+     * Resolve method name to handle, that can be used to call the method without lookup.
+     * Returns nullptr for unknown method.
+     */
+    MethodHandle resolve(const std::string &method) {
+        freeze();
+        return table.find(method);
+    }
+
+    /**
+     * Add call of method. Call that is cancelled or past deadline of given cancellation
+     * before it is executed only fails with Server Error.
+     */
+    std::shared_ptr<Promise> add_work(JsonValue request_id, std::string &&method, Array &&params, Cancellation cancellation = Cancellation()) {
+        MethodHandle entry = resolve(method);
+        return submit(entry, request_id, std::forward<std::string>(method), std::forward<Array>(params), std::move(cancellation));
+    }
+
+    /**
+     * Add work with params that are parsed lazily on the worker thread (see Raw).
+     * Params that are not array are treated as empty array.
+     */
+    std::shared_ptr<Promise> add_work(JsonValue request_id, std::string &&method, JsonValue &&params, Cancellation cancellation = Cancellation()) {
+        MethodHandle entry = resolve(method);
+        return submit(entry, request_id, std::forward<std::string>(method), std::forward<JsonValue>(params), std::move(cancellation));
+    }
+
+    /**
+     * Add work for method resolved by resolve(). Handle must not be nullptr.
+     */
+    std::shared_ptr<Promise> add_work(MethodHandle method, JsonValue request_id, Array &&params, Cancellation cancellation = Cancellation()) {
+        return submit(method, request_id, std::string(method->name), std::forward<Array>(params), std::move(cancellation));
+    }
+
+    std::shared_ptr<Promise> add_work(MethodHandle method, JsonValue request_id, JsonValue &&params, Cancellation cancellation = Cancellation()) {
+        return submit(method, request_id, std::string(method->name), std::forward<JsonValue>(params), std::move(cancellation));
+    }
+
+    /**
+     * Execute call of method that would be queued on the executor in interactive class on
+     * calling thread instead. Caller is expected to wait for the result anyway, so the
+     * call is not handed over to other worker only to be waited for. Other calls are
+     * dispatched the same way as by add_work().
+     *
+     * Call executed here runs on the thread of the caller, not on the executor, and is not
+     * counted by set_max_queued().
+     */
+    std::shared_ptr<Promise> execute(JsonValue request_id, std::string &&method, JsonValue &&params, Cancellation cancellation = Cancellation()) {
+        MethodHandle entry = resolve(method);
+        auto p = std::make_shared<Promise>();
+
+        detail::MethodProcessor processor(access_log, entry, p, request_id, std::forward<std::string>(method), std::forward<JsonValue>(params),
+            std::move(cancellation));
+
+        if (entry != nullptr && entry->execution == Execution::Pool && entry->priority == gcm::thread::Priority::Interactive) {
+            processor();
+        } else {
+            dispatch(std::move(processor));
+        }
+
+        return p;
+    }
+
+    /**
+     * Execute notification (request without id). It is dispatched the same way as other
+     * calls, but no response is built, as nobody would read it.
+     */
+    void add_notification(std::string &&method, Array &&params, Cancellation cancellation = Cancellation()) {
+        MethodHandle entry = resolve(method);
+        dispatch(detail::MethodProcessor(access_log, entry, nullptr, nullptr, std::forward<std::string>(method), std::forward<Array>(params),
+            std::move(cancellation)));
+    }
+
+    void add_notification(std::string &&method, JsonValue &&params, Cancellation cancellation = Cancellation()) {
+        MethodHandle entry = resolve(method);
+        dispatch(detail::MethodProcessor(access_log, entry, nullptr, nullptr, std::forward<std::string>(method), std::forward<JsonValue>(params),
+            std::move(cancellation)));
+    }
+
+    /**
+     * Register method with execution policy (Inline(), Pooled() or Bulkhead()). Rest of
+     * arguments is the same as for other register_method overloads. Methods registered
+     * without policy are executed on the executor.
+     */
+    template<typename F, typename... Args>
+    auto register_method(const std::string &name, const ExecutionPolicy &policy, F callback, Args&&... args) -> detail::EnableIfMethod<F, Method> {
+        register_method(name, std::move(callback), std::forward<Args>(args)...);
+        set_policy(name, policy);
+    }
+
+    /**
+     * Register method whose responses are cached or whose identical concurrent calls are
+     * coalesced, see CachePolicy. Rest of arguments is the same as for other
+     * register_method overloads.
+     */
+    template<typename F, typename... Args>
+    auto register_method(const std::string &name, const CachePolicy &cache, F callback, Args&&... args) -> detail::EnableIfMethod<F, Method> {
+        register_method(name, std::move(callback), std::forward<Args>(args)...);
+        set_cache(name, cache);
+    }
+
+    template<typename F, typename... Args>
+    auto register_method(const std::string &name, const ExecutionPolicy &policy, const CachePolicy &cache, F callback, Args&&... args) -> detail::EnableIfMethod<F, Method> {
+        register_method(name, std::move(callback), std::forward<Args>(args)...);
+        set_policy(name, policy);
+        set_cache(name, cache);
+    }
+
+    /**
+     * Drop all cached responses of method. Modules call it when data the method returns change.
+     */
+    void invalidate_cache(const std::string &method) {
+        MethodHandle entry = resolve(method);
+        if (entry != nullptr && entry->cache != nullptr) {
+            entry->cache->clear();
+        }
+    }
+
+    /**
+     * Drop cached response of method called with given params.
+     */
+    void invalidate_cache(const std::string &method, Array &params) {
+        MethodHandle entry = resolve(method);
+        if (entry != nullptr && entry->cache != nullptr) {
+            entry->cache->invalidate(cache_key(params));
+        }
+    }
+
+    /**
+     * Register asynchronous method. The method gets Completion, through which it delivers
+     * result later, from any thread, so it does not hold worker while waiting.
+     */
+    template<typename F, typename T>
+    auto register_async_method(const std::string &name, F callback, const std::string &desc, T params)
+        -> detail::EnableIfMethod<F, AsyncMethod>
+    {
+        add_method(name, nullptr, validator::genhelp(name, desc, params),
+            detail::SafeAsyncCallback(log, std::move(callback), name, params));
+    }
+
+    template<typename F, typename T, typename R>
+    auto register_async_method(const std::string &name, F callback, const std::string &desc, T params, R result)
+        -> detail::EnableIfMethod<F, AsyncMethod>
+    {
+        add_method(name, nullptr, validator::genhelp(name, desc, params, result),
+            detail::SafeAsyncCallback(log, std::move(callback), name, params, result, result_check, &stats_of(name)));
+    }
+
+    template<typename F, typename... Args>
+    auto register_async_method(const std::string &name, const ExecutionPolicy &policy, F callback, Args&&... args) -> detail::EnableIfMethod<F, AsyncMethod> {
+        register_async_method(name, std::move(callback), std::forward<Args>(args)...);
+        set_policy(name, policy);
+    }
+
+    template<typename F, typename... Args>
+    auto register_async_method(const std::string &name, const CachePolicy &cache, F callback, Args&&... args) -> detail::EnableIfMethod<F, AsyncMethod> {
+        register_async_method(name, std::move(callback), std::forward<Args>(args)...);
+        set_cache(name, cache);
+    }
+
+    template<typename F, typename... Args>
+    auto register_async_method(const std::string &name, const ExecutionPolicy &policy, const CachePolicy &cache, F callback, Args&&... args) -> detail::EnableIfMethod<F, AsyncMethod> {
+        register_async_method(name, std::move(callback), std::forward<Args>(args)...);
+        set_policy(name, policy);
+        set_cache(name, cache);
+    }
+
+    void register_method(const std::string &name, std::function<Method> callback) {
+        add_method(name, callback, validator::genhelp(name, ""));
+    }
+
+    template<typename F>
+    auto register_method(const std::string &name, F callback, const std::string &desc) -> detail::EnableIfMethod<F, Method> {
+        add_method(name, std::move(callback), validator::genhelp(name, desc));
+    }
+
+    /**
+     * Register method with validated params (and result). Validation wraps callback as it
+     * was given, so the dispatch table holds only one type-erased callable per method.
+     */
+    template<typename F, typename T>
+    auto register_method(const std::string &name, F callback, T params) -> detail::EnableIfMethod<F, Method> {
+        add_method(name, detail::SafeCallback(log, std::move(callback), name, params), validator::genhelp(name, "", params));
+    }
+
+    template<typename F, typename T>
+    auto register_method(const std::string &name, F callback, const std::string &desc, T params) -> detail::EnableIfMethod<F, Method> {
+        add_method(name, detail::SafeCallback(log, std::move(callback), name, params), validator::genhelp(name, desc, params));
+    }
+
+    template<typename F, typename T, typename R>
+    auto register_method(const std::string &name, F callback, T params, R result) -> detail::EnableIfMethod<F, Method> {
+        add_method(name, detail::SafeCallback(log, std::move(callback), name, params, result, result_check, &stats_of(name)),
+            validator::genhelp(name, "", params, result));
+    }
+
+    template<typename F, typename T, typename R>
+    auto register_method(const std::string &name, F callback, const std::string &desc, T params, R result) -> detail::EnableIfMethod<F, Method> {
+        add_method(name, detail::SafeCallback(log, std::move(callback), name, params, result, result_check, &stats_of(name)),
+            validator::genhelp(name, desc, params, result));
+    }
+
+    /**
+     * Register method with typed callback, such as (std::string, int64_t, optional<int64_t>) -> bool.
+     * Params are converted to the argument types directly and the result is serialized
+     * without building JSON values, see JsonTraits. Validators and help text are
+     * generated from the signature, args give names of the arguments.
+     */
+    template<typename F, std::size_t N>
+    void register_method(const std::string &name, F callback, const std::string &desc, const ArgList<N> &args, const Arg &result) {
+        using Signature = detail::Signature<F>;
+        static_assert(Signature::Arity == N, "Each argument of typed method must have its Arg.");
+
+        auto params = detail::typed_params<typename Signature::Args>(args, std::make_index_sequence<N>{});
+        auto result_definition = JsonTraits<typename Signature::Result>::definition(result.item, result.help);
+
+        add_method(name, detail::TypedCallback(std::move(callback), params), validator::genhelp(name, desc, params, result_definition));
+    }
+
+    template<typename F, std::size_t N>
+    void register_method(const std::string &name, const ExecutionPolicy &policy, F callback, const std::string &desc,
+        const ArgList<N> &args, const Arg &result)
+    {
+        register_method(name, std::move(callback), desc, args, result);
+        set_policy(name, policy);
+    }
+
+    template<typename F, std::size_t N>
+    void register_method(const std::string &name, const CachePolicy &cache, F callback, const std::string &desc,
+        const ArgList<N> &args, const Arg &result)
+    {
+        register_method(name, std::move(callback), desc, args, result);
+        set_cache(name, cache);
+    }
+
+    template<typename F, std::size_t N>
+    void register_method(const std::string &name, const ExecutionPolicy &policy, const CachePolicy &cache, F callback,
+        const std::string &desc, const ArgList<N> &args, const Arg &result)
+    {
+        register_method(name, std::move(callback), desc, args, result);
+        set_policy(name, policy);
+        set_cache(name, cache);
+    }
+
+protected:
+    void register_system_methods() {
         using namespace std::placeholders;
         namespace v = validator;
 
-        register_method("system.listMethods", std::bind(&Rpc::list_methods, this, _1),
+        register_method("system.listMethods", Inline(), std::bind(&Rpc::list_methods, this, _1),
             "List available methods.",
             v::ParamDefinitions(),
             v::Array("methods", "List of methods",
@@ -60,75 +451,120 @@ public:
             )
         );
 
-        register_method("system.methodHelp", std::bind(&Rpc::method_help, this, _1),
+        // Help text does not change once methods are registered.
+        register_method("system.methodHelp", Inline(), Cached(std::chrono::minutes(1)), std::bind(&Rpc::method_help, this, _1),
             "Get help for method.",
             v::ParamDefinitions(
                 v::String("method_name", "Name of method to get help for.")
             ),
             v::String("method_help", "Help for given method.")
         );
-    }
-
-    void stop() {
-        pool.stop();
-    }
-
-    std::shared_ptr<Promise> add_work(JsonValue request_id, std::string &&method, Array &&params) {
-        auto p = std::make_shared<Promise>();
 
-        pool.add_work(detail::MethodProcessor(
-            log,
-            methods,
-            p,
-            request_id,
-            std::forward<std::string>(method),
-            std::forward<Array>(params)
-        ));
+        register_method("system.stats", Inline(), std::bind(&Rpc::method_stats, this, _1),
+            "Call statistics of registered methods. Latencies are in microseconds.",
+            v::ParamDefinitions(),
+            v::Array("methods", "Statistics of each method",
+                v::Object("method", "Method statistics",
+                    v::String("name", "Method name"),
+                    v::Int("calls", "Number of finished calls"),
+                    v::Object("statuses", "Number of calls by result",
+                        v::Int("OK", "Successful calls"),
+                        v::Int("ParseError", "Calls failed with parse error"),
+                        v::Int("InvalidRequest", "Calls failed with invalid request"),
+                        v::Int("MethodNotFound", "Calls failed with method not found"),
+                        v::Int("InvalidParams", "Calls failed with invalid params"),
+                        v::Int("InternalError", "Calls failed with internal error"),
+                        v::Int("ServerError", "Calls failed with server error"),
+                        v::Int("Other", "Calls failed with other error code")
+                    ),
+                    v::Object("latency", "Call latency",
+                        v::Int("mean", "Mean latency"),
+                        v::Int("p50", "Median latency"),
+                        v::Int("p90", "90th percentile"),
+                        v::Int("p99", "99th percentile"),
+                        v::Int("p999", "99.9th percentile"),
+                        v::Int("max", "Maximum latency")
+                    ),
+                    v::Int("invalidResults", "Results that did not match result definition"),
+                    v::Optional(v::Object("cache", "Response cache, for cached methods only",
+                        v::Int("hits", "Calls answered from cache"),
+                        v::Int("misses", "Calls that had to be executed")
+                    ))
+                )
+            )
+        );
 
-        return p;
+        register_method("system.queues", Inline(), std::bind(&Rpc::queue_stats, this, _1),
+            "Calls waiting for worker, by pool and priority class. Times are in microseconds.",
+            v::ParamDefinitions(),
+            v::Array("queues", "Statistics of each queue",
+                v::Object("queue", "Queue statistics",
+                    v::String("pool", "Name of bulkhead, empty for the executor"),
+                    v::String("priority", "Priority class (critical, interactive or bulk)"),
+                    v::Int("queued", "Number of calls waiting now"),
+                    v::Int("started", "Number of calls taken by worker"),
+                    v::Object("wait", "Time calls waited for worker",
+                        v::Int("mean", "Mean wait of started calls"),
+                        v::Int("max", "Maximum wait, including calls still waiting")
+                    )
+                )
+            )
+        );
     }
 
-    void register_method(const std::string &name, std::function<Method> callback) {
-        methods[name] = callback;
-        help[name] = validator::genhelp(name, "");
-        INFO(log) << "Registered method " << name << ".";
+    void set_policy(const std::string &name, const ExecutionPolicy &policy) {
+        MethodTarget &target = targets[name];
+        target.execution = policy.execution;
+        target.priority = policy.priority;
+        if (policy.execution == Execution::Bulkhead) {
+            auto &bulkhead = bulkheads[policy.pool_name];
+            if (!bulkhead) {
+                bulkhead = std::make_unique<gcm::thread::Pool<detail::MethodProcessor>>(policy.min_spare, policy.max_workers);
+                bulkhead->set_scheduling(weights, max_wait);
+                INFO(log) << "Created bulkhead pool " << policy.pool_name << " (max " << policy.max_workers << " workers).";
+            }
+            target.pool = bulkhead.get();
+        }
     }
 
-    void register_method(const std::string &name, std::function<Method> callback, const std::string &desc) {
-        methods[name] = callback;
-        help[name] = validator::genhelp(name, desc);
-        INFO(log) << "Registered method " << name << ".";
-    }
+    void set_cache(const std::string &name, const CachePolicy &policy) {
+        if (policy.ttl.count() > 0) {
+            auto &cache = caches[name];
+            cache = std::make_unique<ResponseCache>(policy);
+            targets[name].cache = cache.get();
+        }
 
-    template<typename T>
-    void register_method(const std::string &name, std::function<Method> callback, T params) {
-        methods[name] = detail::SafeCallback(log, callback, name, params);
-        help[name] = validator::genhelp(name, "", params);
-        INFO(log) << "Registered method " << name << ".";
+        if (policy.coalesce) {
+            auto &calls = in_flight[name];
+            calls = std::make_unique<InFlight<detail::MethodProcessor>>();
+            targets[name].in_flight = calls.get();
+        }
     }
 
-    template<typename T>
-    void register_method(const std::string &name, std::function<Method> callback, const std::string &desc, T params) {
-        methods[name] = detail::SafeCallback(log, callback, name, params);
-        help[name] = validator::genhelp(name, desc, params);
-        INFO(log) << "Registered method " << name << ".";
+    MethodStats &stats_of(const std::string &name) {
+        auto &method_stats = stats[name];
+        if (!method_stats) {
+            method_stats = std::make_unique<MethodStats>();
+        }
+        return *method_stats;
     }
 
-    template<typename T, typename R>
-    void register_method(const std::string &name, std::function<Method> callback, T params, R result) {
-        methods[name] = detail::SafeCallback(log, callback, name, params, result);
-        help[name] = validator::genhelp(name, "", params, result);
-        INFO(log) << "Registered method " << name << ".";
-    }
+    void add_method(const std::string &name, std::function<Method> callback, std::string &&help_text,
+        std::function<AsyncMethod> async_callback = nullptr)
+    {
+        if (frozen) {
+            throw RpcException(ErrorCode::InternalError, "Method " + name + " registered after dispatch table was frozen.");
+        }
+
+        methods[name] = callback;
+        async_methods[name] = async_callback;
+        help[name] = std::move(help_text);
+
+        targets[name] = MethodTarget{Execution::Pool, nullptr, gcm::thread::Priority::Interactive, &stats_of(name), nullptr, nullptr};
 
-    template<typename T, typename R>
-    void register_method(const std::string &name, std::function<Method> callback, const std::string &desc, T params, R result) {
-        methods[name] = detail::SafeCallback(log, callback, name, params, result);
-        help[name] = validator::genhelp(name, desc, params, result);
         INFO(log) << "Registered method " << name << ".";
     }
 
-protected:
     JsonValue list_methods(Array &) {
         Array result;
         for (auto &m: methods) {
@@ -137,6 +573,78 @@ protected:
         return std::make_shared<Array>(result);
     }
 
+    JsonValue method_stats(Array &) {
+        auto result = make_array();
+        auto &arr = to<Array>(result);
+
+        for (auto &it: stats) {
+            StatsSnapshot snapshot = it.second->snapshot();
+
+            auto item = make_object();
+            auto &obj = to<Object>(item);
+            obj["name"] = make_string(it.first);
+            obj["calls"] = make_int(snapshot.calls);
+
+            auto &statuses = to<Object>(obj["statuses"] = make_object());
+            for (std::size_t i = 0; i < NumCallStatuses; ++i) {
+                statuses[to_string(static_cast<CallStatus>(i))] = make_int(snapshot.statuses[i]);
+            }
+
+            auto &latency = to<Object>(obj["latency"] = make_object());
+            latency["mean"] = make_int(snapshot.calls > 0 ? snapshot.total_us / snapshot.calls : 0);
+            latency["p50"] = make_int(snapshot.percentile(0.5));
+            latency["p90"] = make_int(snapshot.percentile(0.9));
+            latency["p99"] = make_int(snapshot.percentile(0.99));
+            latency["p999"] = make_int(snapshot.percentile(0.999));
+            latency["max"] = make_int(snapshot.max_us);
+
+            obj["invalidResults"] = make_int(snapshot.invalid_results);
+
+            auto target = targets.find(it.first);
+            if (target != targets.end() && target->second.cache != nullptr) {
+                auto &cache = to<Object>(obj["cache"] = make_object());
+                cache["hits"] = make_int(snapshot.cache_hits);
+                cache["misses"] = make_int(snapshot.cache_misses);
+            }
+
+            arr.push_back(item);
+        }
+
+        return result;
+    }
+
+    JsonValue queue_stats(Array &) {
+        auto result = make_array();
+        auto &arr = to<Array>(result);
+
+        auto add_pool = [&](const std::string &name, auto &worker_pool) {
+            for (std::size_t i = 0; i < gcm::thread::NumPriorities; ++i) {
+                auto priority = static_cast<gcm::thread::Priority>(i);
+                gcm::thread::QueueStats queue = worker_pool.queue_stats(priority);
+
+                auto item = make_object();
+                auto &obj = to<Object>(item);
+                obj["pool"] = make_string(name);
+                obj["priority"] = make_string(gcm::thread::to_string(priority));
+                obj["queued"] = make_int(queue.queued);
+                obj["started"] = make_int(queue.started);
+
+                auto &wait = to<Object>(obj["wait"] = make_object());
+                wait["mean"] = make_int(queue.started > 0 ? queue.total_wait_us / queue.started : 0);
+                wait["max"] = make_int(queue.max_wait_us);
+
+                arr.push_back(item);
+            }
+        };
+
+        add_pool("", executor);
+        for (auto &it: bulkheads) {
+            add_pool(it.first, *it.second);
+        }
+
+        return result;
+    }
+
     JsonValue method_help(Array &params) {
         std::string methodName = to<String>(params[0]);
 
@@ -150,11 +658,128 @@ protected:
         }
     }
 
+protected:
+    using WorkerPool = gcm::thread::Pool<detail::MethodProcessor>;
+
+    struct MethodTarget {
+        Execution execution;
+        WorkerPool *pool;
+        gcm::thread::Priority priority;
+        MethodStats *stats;
+        ResponseCache *cache;
+        InFlight<detail::MethodProcessor> *in_flight;
+    };
+
+    template<typename P>
+    std::shared_ptr<Promise> submit(MethodHandle entry, JsonValue request_id, std::string &&method, P &&params, Cancellation &&cancellation) {
+        auto p = std::make_shared<Promise>();
+
+        dispatch(detail::MethodProcessor(access_log, entry, p, request_id, std::forward<std::string>(method), std::forward<P>(params),
+            std::move(cancellation)));
+
+        return p;
+    }
+
+    void dispatch(detail::MethodProcessor &&processor) {
+        MethodHandle entry = processor.get_entry();
+
+        if (entry == nullptr || entry->execution == Execution::Inline) {
+            // Unknown method only produces an error, there is no reason to hand it off.
+            processor();
+        } else if (entry->execution == Execution::Bulkhead) {
+            entry->pool->add_work(std::move(processor), entry->priority);
+        } else if (reserve_queued()) {
+            executor.submit(QueuedCall(*this, std::move(processor)), entry->priority);
+        } else {
+            // Share of the executor is used up, caller that queues more calls executes them.
+            processor();
+        }
+    }
+
+    /**
+     * Count call that is going to be queued on the executor, unless max_queued calls are
+     * there already.
+     */
+    bool reserve_queued() {
+        std::unique_lock<std::mutex> lock(queued_mutex);
+        if (max_queued > 0 && num_queued >= max_queued) {
+            return false;
+        }
+
+        ++num_queued;
+        return true;
+    }
+
+    /**
+     * Call waiting on the executor, counted by reserve_queued(). Shared executor outlives
+     * the Rpc, so stop() waits until none of them is left.
+     */
+    class QueuedCall {
+    public:
+        QueuedCall(Rpc &rpc, detail::MethodProcessor &&processor):
+            rpc(&rpc),
+            processor(std::move(processor))
+        {}
+
+        QueuedCall(QueuedCall &&other):
+            rpc(other.rpc),
+            processor(std::move(other.processor))
+        {
+            other.rpc = nullptr;
+        }
+
+        ~QueuedCall() {
+            if (rpc != nullptr) {
+                std::unique_lock<std::mutex> lock(rpc->queued_mutex);
+                --rpc->num_queued;
+                rpc->queued_cond.notify_all();
+            }
+        }
+
+        void operator()() {
+            if (rpc->stopping.load()) {
+                processor.reject(std::make_exception_ptr(RpcException(ErrorCode::ServerError, "Server is stopping.")));
+            } else {
+                processor();
+            }
+        }
+
+    protected:
+        Rpc *rpc;
+        detail::MethodProcessor processor;
+    };
+
 protected:
     std::map<std::string, std::function<Method>> methods;
+    std::map<std::string, std::function<AsyncMethod>> async_methods;
     std::map<std::string, std::string> help;
+    std::map<std::string, MethodTarget> targets;
+    std::map<std::string, std::unique_ptr<MethodStats>> stats;
+    std::map<std::string, std::unique_ptr<ResponseCache>> caches;
+    std::map<std::string, std::unique_ptr<InFlight<detail::MethodProcessor>>> in_flight;
+
+    // Before the pools, running calls write to it until the pools are stopped.
+    AccessLog access_log;
+    ResultCheck result_check;
+
+    std::once_flag frozen_flag;
+    bool frozen = false;
+    MethodTable table;
+
+    // Guarded by queued_mutex, see QueuedCall. Before the executor, calls left in stopped
+    // own executor are released with it.
+    std::mutex queued_mutex;
+    std::condition_variable queued_cond;
+    std::size_t num_queued = 0;
+    std::size_t max_queued = 0;
+    std::atomic<bool> stopping{false};
+
+    std::unique_ptr<gcm::thread::Executor> own_executor;
+    gcm::thread::Executor &executor;
+    std::map<std::string, std::unique_ptr<WorkerPool>> bulkheads;
 
-    gcm::thread::Pool<detail::MethodProcessor> pool;
+    std::array<unsigned, gcm::thread::NumPriorities> weights{{16, 4, 1}};
+    std::chrono::milliseconds max_wait{1000};
     gcm::thread::SignalBind on_sigint;
 
     gcm::logging::Logger &log;
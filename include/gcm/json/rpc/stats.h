@@ -0,0 +1,256 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+#include "types.h"
+
+namespace gcm {
+namespace json {
+namespace rpc {
+
+namespace detail {
+
+/**
+ * Cheap pseudo-random number for sampling (xorshift64*), one generator per thread.
+ */
+inline uint64_t thread_random() {
+    static thread_local uint64_t state = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+
+    return state * 0x2545f4914f6cdd1dULL;
+}
+
+} // namespace detail
+
+/**
+ * Outcome of method call, as counted in statistics.
+ */
+enum class CallStatus {
+    Ok, ParseError, InvalidRequest, MethodNotFound, InvalidParams, InternalError, ServerError, Other
+};
+
+static constexpr const std::size_t NumCallStatuses = static_cast<std::size_t>(CallStatus::Other) + 1;
+
+/**
+ * Status of call that ended with given error code (0 for success).
+ */
+inline CallStatus call_status(int code) {
+    switch (code) {
+        case 0: return CallStatus::Ok;
+        case static_cast<int>(ErrorCode::ParseError): return CallStatus::ParseError;
+        case static_cast<int>(ErrorCode::InvalidRequest): return CallStatus::InvalidRequest;
+        case static_cast<int>(ErrorCode::MethodNotFound): return CallStatus::MethodNotFound;
+        case static_cast<int>(ErrorCode::InvalidParams): return CallStatus::InvalidParams;
+        case static_cast<int>(ErrorCode::InternalError): return CallStatus::InternalError;
+        case static_cast<int>(ErrorCode::ServerError): return CallStatus::ServerError;
+        default: return CallStatus::Other;
+    }
+}
+
+inline const char *to_string(CallStatus status) {
+    switch (status) {
+        case CallStatus::Ok: return "OK";
+        case CallStatus::ParseError: return "ParseError";
+        case CallStatus::InvalidRequest: return "InvalidRequest";
+        case CallStatus::MethodNotFound: return "MethodNotFound";
+        case CallStatus::InvalidParams: return "InvalidParams";
+        case CallStatus::InternalError: return "InternalError";
+        case CallStatus::ServerError: return "ServerError";
+        default: return "Other";
+    }
+}
+
+/**
+ * Bucketing of latency histogram. Each power of two is split into 16 linear
+ * sub-buckets (HDR histogram style), so values are kept with relative error
+ * below 1/16. Values are in microseconds, up to 2^41 us.
+ */
+struct Histogram {
+    static constexpr const unsigned SubBits = 4;
+    static constexpr const std::size_t SubBuckets = 1 << SubBits;
+    static constexpr const unsigned MaxExponent = 40;
+    static constexpr const std::size_t Buckets = (MaxExponent - SubBits + 2) * SubBuckets;
+
+    static std::size_t index(uint64_t value) {
+        if (value < SubBuckets) {
+            return value;
+        }
+
+        unsigned exponent = 63 - __builtin_clzll(value);
+        if (exponent > MaxExponent) {
+            return Buckets - 1;
+        }
+
+        return (exponent - SubBits + 1) * SubBuckets + (value >> (exponent - SubBits)) - SubBuckets;
+    }
+
+    /**
+     * Highest value that falls into bucket.
+     */
+    static uint64_t upper_bound(std::size_t index) {
+        if (index < SubBuckets) {
+            return index;
+        }
+
+        uint64_t exponent = index / SubBuckets + SubBits - 1;
+        uint64_t mantissa = index % SubBuckets + SubBuckets;
+        return ((mantissa + 1) << (exponent - SubBits)) - 1;
+    }
+};
+
+/**
+ * Merged view of MethodStats.
+ */
+struct StatsSnapshot {
+    uint64_t calls = 0;
+    uint64_t total_us = 0;
+    uint64_t max_us = 0;
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
+    uint64_t invalid_results = 0;
+    std::array<uint64_t, NumCallStatuses> statuses{};
+    std::array<uint64_t, Histogram::Buckets> latency{};
+
+    /**
+     * Latency (in microseconds) below which given fraction of calls finished.
+     */
+    uint64_t percentile(double fraction) const {
+        uint64_t target = static_cast<uint64_t>(fraction * calls + 0.5);
+        if (target == 0) {
+            target = 1;
+        }
+
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < latency.size(); ++i) {
+            seen += latency[i];
+            if (seen >= target) {
+                return std::min(Histogram::upper_bound(i), max_us);
+            }
+        }
+
+        return max_us;
+    }
+};
+
+/**
+ * Call statistics of one method. Recording is lock-free: counters are striped
+ * into shards selected by thread, so workers do not contend on the same cache
+ * lines. Shards are merged on read.
+ */
+class MethodStats {
+public:
+    static constexpr const std::size_t Shards = 8;
+
+    MethodStats(): shards{}
+    {}
+
+    MethodStats(const MethodStats &) = delete;
+
+    void record(std::chrono::microseconds duration, CallStatus status) {
+        uint64_t us = duration.count() > 0 ? static_cast<uint64_t>(duration.count()) : 0;
+        Shard &shard = local_shard();
+
+        shard.latency[Histogram::index(us)].fetch_add(1, std::memory_order_relaxed);
+        shard.statuses[static_cast<std::size_t>(status)].fetch_add(1, std::memory_order_relaxed);
+        shard.total_us.fetch_add(us, std::memory_order_relaxed);
+
+        uint64_t max = shard.max_us.load(std::memory_order_relaxed);
+        while (us > max && !shard.max_us.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * Count lookup in response cache of the method.
+     */
+    void record_cache(bool hit) {
+        Shard &shard = local_shard();
+        (hit ? shard.cache_hits : shard.cache_misses).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Count result that did not match result definition of the method.
+     */
+    void record_invalid_result() {
+        local_shard().invalid_results.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    StatsSnapshot snapshot() const {
+        StatsSnapshot out;
+
+        for (auto &shard: shards) {
+            for (std::size_t i = 0; i < Histogram::Buckets; ++i) {
+                uint64_t count = shard.latency[i].load(std::memory_order_relaxed);
+                out.latency[i] += count;
+                out.calls += count;
+            }
+
+            for (std::size_t i = 0; i < NumCallStatuses; ++i) {
+                out.statuses[i] += shard.statuses[i].load(std::memory_order_relaxed);
+            }
+
+            out.total_us += shard.total_us.load(std::memory_order_relaxed);
+            out.cache_hits += shard.cache_hits.load(std::memory_order_relaxed);
+            out.cache_misses += shard.cache_misses.load(std::memory_order_relaxed);
+            out.invalid_results += shard.invalid_results.load(std::memory_order_relaxed);
+            out.max_us = std::max(out.max_us, shard.max_us.load(std::memory_order_relaxed));
+        }
+
+        return out;
+    }
+
+protected:
+    struct Shard {
+        std::array<std::atomic<uint64_t>, Histogram::Buckets> latency;
+        std::array<std::atomic<uint64_t>, NumCallStatuses> statuses;
+        std::atomic<uint64_t> total_us;
+        std::atomic<uint64_t> max_us;
+        std::atomic<uint64_t> cache_hits;
+        std::atomic<uint64_t> cache_misses;
+        std::atomic<uint64_t> invalid_results;
+
+        // Keep tail of one shard and head of next one on different cache lines.
+        char padding[64];
+    };
+
+    Shard &local_shard() {
+        static thread_local const std::size_t slot = std::hash<std::thread::id>()(std::this_thread::get_id());
+        return shards[slot % Shards];
+    }
+
+    std::array<Shard, Shards> shards;
+};
+
+} // namespace rpc
+} // namespace json
+} // namespace gcm
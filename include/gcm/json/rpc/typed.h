@@ -0,0 +1,398 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <experimental/optional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../json.h"
+#include "../raw.h"
+#include "../validator.h"
+#include "types.h"
+#include "detail.h"
+
+namespace gcm {
+namespace json {
+namespace rpc {
+
+/**
+ * Name and description of typed method argument or result. Its type is taken from
+ * the method signature.
+ */
+struct Arg {
+    Arg(const char *item, const char *help): item(item), help(help)
+    {}
+
+    const char *item;
+    const char *help;
+};
+
+template<std::size_t N>
+using ArgList = std::array<Arg, N>;
+
+template<typename... T>
+ArgList<sizeof...(T)> Args(T... args) {
+    return ArgList<sizeof...(T)>{{Arg(args)...}};
+}
+
+/**
+ * Conversion of C++ type from and to JSON, for arguments and results of typed methods.
+ *
+ * - from_json() converts value in one step with checking its type. Empty value means
+ *   that the argument is missing. Returns false if the value cannot be converted.
+ * - write() appends JSON text of the value, without building JSON values.
+ * - definition() returns validator matching the same values, used for help text and
+ *   for describing problems once conversion fails.
+ *
+ * Specialize it to pass other types.
+ */
+template<typename T, typename Enable = void>
+struct JsonTraits;
+
+template<>
+struct JsonTraits<bool> {
+    static bool from_json(const JsonValue &value, bool &out) {
+        if (!value || value->get_type() != ValueType::Bool) {
+            return false;
+        }
+
+        out = to<Bool>(value).get_value();
+        return true;
+    }
+
+    static void write(std::string &out, bool value) {
+        out += value ? "true" : "false";
+    }
+
+    static auto definition(const char *item, const char *help) {
+        return validator::Bool(item, help);
+    }
+};
+
+template<typename T>
+struct JsonTraits<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>> {
+    static bool from_json(const JsonValue &value, T &out) {
+        if (!value || value->get_type() != ValueType::Int) {
+            return false;
+        }
+
+        auto number = to<Int>(value).get_value();
+        if (!in_range(number)) {
+            return false;
+        }
+
+        out = static_cast<T>(number);
+        return true;
+    }
+
+    static void write(std::string &out, T value) {
+        char buffer[json::detail::IntBufferSize];
+        out.append(buffer, json::detail::format_int(buffer, value));
+    }
+
+    static auto definition(const char *item, const char *help) {
+        return validator::Int(item, help);
+    }
+
+protected:
+    /**
+     * Whether number fits into T, instead of being wrapped by the cast.
+     */
+    template<typename N>
+    static bool in_range(N number) {
+        if (std::is_unsigned<T>::value) {
+            return number >= 0
+                && static_cast<std::make_unsigned_t<N>>(number) <= std::numeric_limits<T>::max();
+        } else {
+            return static_cast<int64_t>(number) >= static_cast<int64_t>(std::numeric_limits<T>::min())
+                && static_cast<int64_t>(number) <= static_cast<int64_t>(std::numeric_limits<T>::max());
+        }
+    }
+};
+
+template<typename T>
+struct JsonTraits<T, std::enable_if_t<std::is_floating_point<T>::value>> {
+    static bool from_json(const JsonValue &value, T &out) {
+        if (!value || value->get_type() != ValueType::Double) {
+            return false;
+        }
+
+        out = static_cast<T>(to<Double>(value).get_value());
+        return true;
+    }
+
+    static void write(std::string &out, T value) {
+        char buffer[json::detail::DoubleBufferSize];
+        out.append(buffer, json::detail::format_double(buffer, value));
+    }
+
+    static auto definition(const char *item, const char *help) {
+        return validator::Double(item, help);
+    }
+};
+
+template<>
+struct JsonTraits<std::string> {
+    static bool from_json(const JsonValue &value, std::string &out) {
+        if (!value || value->get_type() != ValueType::String) {
+            return false;
+        }
+
+        out = to<String>(value).get_value();
+        return true;
+    }
+
+    static void write(std::string &out, const std::string &value) {
+        json::detail::write_string(out, value.data(), value.size());
+    }
+
+    static auto definition(const char *item, const char *help) {
+        return validator::String(item, help);
+    }
+};
+
+/**
+ * Any JSON value, passed as it is.
+ */
+template<>
+struct JsonTraits<JsonValue> {
+    static bool from_json(const JsonValue &value, JsonValue &out) {
+        if (!value) {
+            return false;
+        }
+
+        out = value;
+        return true;
+    }
+
+    static void write(std::string &out, const JsonValue &value) {
+        if (value) {
+            value->write(out);
+        } else {
+            out += "null";
+        }
+    }
+
+    static auto definition(const char *item, const char *help) {
+        return validator::AnyType(item, help);
+    }
+};
+
+/**
+ * Argument that can be missing or null, null in result.
+ */
+template<typename T>
+struct JsonTraits<std::experimental::optional<T>> {
+    static bool from_json(const JsonValue &value, std::experimental::optional<T> &out) {
+        if (!value || value->get_type() == ValueType::Null) {
+            out = std::experimental::nullopt;
+            return true;
+        }
+
+        T item;
+        if (!JsonTraits<T>::from_json(value, item)) {
+            return false;
+        }
+
+        out = std::move(item);
+        return true;
+    }
+
+    static void write(std::string &out, const std::experimental::optional<T> &value) {
+        if (value) {
+            JsonTraits<T>::write(out, *value);
+        } else {
+            out += "null";
+        }
+    }
+
+    static auto definition(const char *item, const char *help) {
+        return validator::Optional(validator::Nullable(JsonTraits<T>::definition(item, help)));
+    }
+};
+
+template<typename T>
+struct JsonTraits<std::vector<T>> {
+    static bool from_json(const JsonValue &value, std::vector<T> &out) {
+        if (!value || value->get_type() != ValueType::Array) {
+            return false;
+        }
+
+        auto &arr = to<Array>(value);
+        out.resize(arr.size());
+        for (std::size_t i = 0; i < arr.size(); ++i) {
+            if (!JsonTraits<T>::from_json(arr[i], out[i])) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static void write(std::string &out, const std::vector<T> &value) {
+        out += '[';
+        for (std::size_t i = 0; i < value.size(); ++i) {
+            if (i > 0) {
+                out += ',';
+            }
+            JsonTraits<T>::write(out, value[i]);
+        }
+        out += ']';
+    }
+
+    static auto definition(const char *item, const char *help) {
+        return validator::Array(item, help, JsonTraits<T>::definition(item, help));
+    }
+};
+
+namespace detail {
+
+/**
+ * Result and argument types of callable.
+ */
+template<typename F>
+struct Signature: Signature<decltype(&F::operator())> {
+};
+
+template<typename R, typename... A>
+struct Signature<R (*)(A...)> {
+    using Result = std::decay_t<R>;
+    using Args = std::tuple<std::decay_t<A>...>;
+    static constexpr const std::size_t Arity = sizeof...(A);
+};
+
+template<typename C, typename R, typename... A>
+struct Signature<R (C::*)(A...)>: Signature<R (*)(A...)> {
+};
+
+template<typename C, typename R, typename... A>
+struct Signature<R (C::*)(A...) const>: Signature<R (*)(A...)> {
+};
+
+template<typename Args, std::size_t... I>
+auto typed_params(const ArgList<sizeof...(I)> &args, std::index_sequence<I...>) {
+    return validator::ParamDefinitions(
+        JsonTraits<std::tuple_element_t<I, Args>>::definition(args[I].item, args[I].help)...
+    );
+}
+
+/**
+ * Method with arguments converted from params according to signature of the callback.
+ */
+template<typename F, typename Args, typename Params>
+class TypedCallback_t;
+
+template<typename F, typename... A, typename Params>
+class TypedCallback_t<F, std::tuple<A...>, Params> {
+public:
+    TypedCallback_t(F callback, Params params):
+        callback(std::move(callback)),
+        params(std::move(params))
+    {}
+
+    JsonValue operator()(Array &p) {
+        std::tuple<A...> args;
+        std::size_t failed = 0;
+        if (p.size() > sizeof...(A) || !convert(p, args, failed)) {
+            // Conversion only tells that params are wrong, validator tells what is wrong with them.
+            validator::Problems problems;
+            params.validate(p, problems);
+            if (!problems) {
+                // Value has type the validator accepts, but does not fit into the argument type.
+                auto item = item_name(failed);
+                problems.add_problem(item, validator::ProblemCode::OutOfRange,
+                    "Item " + item + " is out of range of the argument type.");
+            }
+            throw invalid_params(problems);
+        }
+
+        return make_result(call(args, std::index_sequence_for<A...>{}));
+    }
+
+protected:
+    template<std::size_t I = 0>
+    static std::enable_if_t<(I < sizeof...(A)), bool> convert(Array &p, std::tuple<A...> &args, std::size_t &failed) {
+        static const JsonValue missing;
+
+        using T = std::tuple_element_t<I, std::tuple<A...>>;
+        failed = I;
+        return JsonTraits<T>::from_json(I < p.size() ? p[I] : missing, std::get<I>(args))
+            && convert<I + 1>(p, args, failed);
+    }
+
+    template<std::size_t I>
+    static std::enable_if_t<(I == sizeof...(A)), bool> convert(Array &, std::tuple<A...> &, std::size_t &) {
+        return true;
+    }
+
+    std::string item_name(std::size_t index) {
+        std::string name;
+        std::size_t i = 0;
+        params.map([&](const auto &definition) {
+            if (i++ == index) {
+                name = definition.get_item();
+            }
+        });
+        return name;
+    }
+
+    template<std::size_t... I>
+    auto call(std::tuple<A...> &args, std::index_sequence<I...>) {
+        return callback(std::move(std::get<I>(args))...);
+    }
+
+    /**
+     * Result is serialized right away, and passed on as raw JSON text.
+     */
+    template<typename T>
+    static JsonValue make_result(T &&value) {
+        auto text = std::make_shared<std::string>();
+        JsonTraits<std::decay_t<T>>::write(*text, value);
+        return make_raw(std::move(text));
+    }
+
+    static JsonValue make_result(JsonValue value) {
+        return value;
+    }
+
+    F callback;
+    Params params;
+};
+
+template<typename F, typename Params>
+auto TypedCallback(F callback, Params params) {
+    return TypedCallback_t<F, typename Signature<F>::Args, Params>(std::move(callback), std::move(params));
+}
+
+} // namespace detail
+} // namespace rpc
+} // namespace json
+} // namespace gcm
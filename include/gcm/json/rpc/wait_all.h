@@ -23,52 +23,82 @@
 
 #pragma once
 
+#include <chrono>
 #include <vector>
 #include <memory>
-#include <mutex>
-#include <condition_variable>
-
-#include <gcm/logging/logging.h>
 
 #include "promise.h"
+#include "completion_queue.h"
 
 namespace gcm {
 namespace json {
 namespace rpc {
 
+/**
+ * Wait for all promises and call done for each of them in order of completion.
+ * Finished promises are collected through completion queue, so each completion
+ * costs O(1) regardless of number of promises.
+ */
 template<typename PromiseDone>
-inline void wait_all(std::vector<std::shared_ptr<Promise>> promises, PromiseDone done) {
-    std::mutex m;
-    std::condition_variable cv;
+inline void wait_all(const std::vector<std::shared_ptr<Promise>> &promises, PromiseDone done) {
+    auto queue = std::make_shared<CompletionQueue>();
 
     for (auto &p: promises) {
-        p->notify_done = &cv;
+        p->notify(queue);
+    }
+
+    for (std::size_t i = 0; i < promises.size(); ++i) {
+        done(static_cast<Promise &>(*queue->pop()));
+    }
+}
+
+/**
+ * Start count calls, with at most concurrency of them unfinished at once (0 means no
+ * limit), and call done for each of them in order of completion. Start gets index of
+ * the call and returns its promise. Next call is started when a previous one finishes.
+ * While waiting, idle is called each interval without completion.
+ */
+template<typename Start, typename PromiseDone, typename Idle>
+inline void wait_limited(std::size_t count, std::size_t concurrency, Start start, PromiseDone done,
+    std::chrono::milliseconds interval, Idle idle)
+{
+    if (concurrency == 0 || concurrency > count) {
+        concurrency = count;
     }
 
-    auto &log = gcm::logging::getLogger("debug");
+    auto queue = std::make_shared<CompletionQueue>();
 
-    bool changed = false;
-    while (!promises.empty()) {
-        changed = false;
+    // Promise must live until it is popped from the queue, completion only holds raw pointer.
+    std::vector<std::shared_ptr<Promise>> running;
+    running.reserve(count);
 
-        for (auto it = promises.begin(); it != promises.end(); ++it) {
-            if ((*it)->try_wait()) {
-                // Promise has work done.
-                done(**it);
+    std::size_t started = 0;
+    for (; started < concurrency; ++started) {
+        running.push_back(start(started));
+        running.back()->notify(queue);
+    }
 
-                promises.erase(it);
-                changed = true;
-                break;
-            }
+    for (std::size_t finished = 0; finished < count; ++finished) {
+        CompletionNode *node = queue->pop_for(interval);
+        while (node == nullptr) {
+            idle();
+            node = queue->pop_for(interval);
         }
 
-        if (!changed) {
-            std::unique_lock<std::mutex> lock(m);
-            cv.wait(lock);
+        done(static_cast<Promise &>(*node));
+
+        if (started < count) {
+            running.push_back(start(started++));
+            running.back()->notify(queue);
         }
     }
 }
 
+template<typename Start, typename PromiseDone>
+inline void wait_limited(std::size_t count, std::size_t concurrency, Start start, PromiseDone done) {
+    wait_limited(count, concurrency, start, done, std::chrono::hours(24), [](){});
+}
+
 } // namespace rpc
 } // namespace json
 } // namespace gcm
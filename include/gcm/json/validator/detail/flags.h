@@ -36,7 +36,7 @@ public:
     Nullable_t(T param_def): param_def(param_def)
     {}
 
-    bool operator()(Diagnostics &diag, JsonValue &value) const {
+    bool operator()(Problems &diag, JsonValue &value) const {
         if (value && value->get_type() == ValueType::Null) {
             return true;
         } else {
@@ -44,11 +44,15 @@ public:
         }
     }
 
-    auto get_item() {
+    const std::string &get_item() const {
         return param_def.get_item();
     }
 
-    auto get_help() {
+    auto get_type() const {
+        return param_def.get_type();
+    }
+
+    const std::string &get_help() const {
         return param_def.get_help();
     }
 
@@ -63,7 +67,7 @@ public:
 
     }
 
-    bool operator()(Diagnostics &diag, JsonValue &value) const {
+    bool operator()(Problems &diag, JsonValue &value) const {
         if (!value) {
             // Optional and not present.
             return true;
@@ -72,15 +76,15 @@ public:
         }
     }
 
-    auto get_item() {
+    const std::string &get_item() const {
         return param_def.get_item();
     }
 
-    auto get_type() {
+    auto get_type() const {
         return param_def.get_type();
     }
 
-    auto get_help() {
+    const std::string &get_help() const {
         return param_def.get_help();
     }
 
@@ -97,7 +101,7 @@ public:
     {
     }
 
-    bool operator()(Diagnostics &diag, JsonValue &value) const {
+    bool operator()(Problems &diag, JsonValue &value) const {
         if (!value) {
             // Optional and not present.
             value = default_value;
@@ -107,15 +111,15 @@ public:
         }
     }
 
-    auto get_item() {
+    const std::string &get_item() const {
         return param_def.get_item();
     }
 
-    auto get_type() {
+    auto get_type() const {
         return param_def.get_type();
     }
 
-    auto get_help() {
+    const std::string &get_help() const {
         return param_def.get_help();
     }
 
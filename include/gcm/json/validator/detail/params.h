@@ -44,16 +44,27 @@ public:
     ParamDefinitions_t(ParamDefinitions_t &&) = default;
     ParamDefinitions_t(const ParamDefinitions_t &) = default;
 
-    bool validate(json::Array &value) {
-        Diagnostics diag;
+    /**
+     * Validate params, throw Diagnostics when they are not valid.
+     */
+    bool validate(json::Array &value) const {
+        Problems problems;
+        if (!validate(value, problems)) {
+            throw Diagnostics(std::move(problems));
+        }
+        return true;
+    }
+
+    /**
+     * Validate params and collect found problems. Nothing is allocated
+     * unless the validation fails or missing argument is appended.
+     */
+    bool validate(json::Array &value, Problems &problems) const {
         auto begin = value.begin();
         auto end = value.end();
+        std::size_t given = value.size();
 
-        auto res = call_func(diag, value, begin, end, std::index_sequence_for<Args...>{});
-        if (!res) {
-            throw diag;
-        }
-        return true;
+        return call_func(problems, value, begin, end, given, std::index_sequence_for<Args...>{});
     }
 
     template<typename T>
@@ -72,17 +83,15 @@ public:
 protected:
     std::tuple<Args...> params;
     std::size_t num_args;
-    std::size_t actual_args;
 
     template<typename I, typename Head, typename... Tail>
-    bool int_validator(Diagnostics &diag, json::Array &value, I &begin, I &end, Head head, Tail... tail) {
+    bool int_validator(Problems &diag, json::Array &value, I &begin, I &end, std::size_t given, const Head &head, const Tail &... tail) const {
         // Argument missing (no more items in array)
         if (begin == end) {
             // TODO: Append empty value (nullptr).
             value.push_back(nullptr);
             begin = value.end() - 1;
             end = value.end();
-            actual_args++;
 
             //diag.add_problem(head.get_item(), ProblemCode::MustBePresent, "Missing argument for function.");
         }
@@ -91,16 +100,16 @@ protected:
         // on the rest of the arguments to generate as much error messages as possible.
         bool res_head = head(diag, *begin);
         ++begin;
-        bool res_tail = int_validator(diag, value, begin, end, tail...);
+        bool res_tail = int_validator(diag, value, begin, end, given, tail...);
         return res_head && res_tail;
     }
 
     template<typename I>
-    bool int_validator(Diagnostics &diag, json::Array &, I &begin, I &end) {
+    bool int_validator(Problems &diag, json::Array &, I &begin, I &end, std::size_t given) const {
         if (begin != end) {
             // Too many arguments for function.
             diag.add_problem("", ProblemCode::UnexpectedParam,
-                "Function accepts " + std::to_string(num_args) + " arguments, " + std::to_string(actual_args) + " given.");
+                "Function accepts " + std::to_string(num_args) + " arguments, " + std::to_string(given) + " given.");
             return false;
         } else {
             return true;
@@ -108,9 +117,8 @@ protected:
     }
 
     template<typename Iterator, std::size_t ...I>
-    bool call_func(Diagnostics &diag, json::Array &value, Iterator &begin, Iterator &end, std::index_sequence<I...>) {
-        actual_args = std::distance(begin, end);
-        return int_validator(diag, value, begin, end, std::get<I>(params)...);
+    bool call_func(Problems &diag, json::Array &value, Iterator &begin, Iterator &end, std::size_t given, std::index_sequence<I...>) const {
+        return int_validator(diag, value, begin, end, given, std::get<I>(params)...);
     }
 
     template<typename T, std::size_t... I>
@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include <array>
+
 #include "../../json.h"
 #include "types.h"
 #include "../diagnostics.h"
@@ -42,15 +44,15 @@ public:
         return type;
     }
 
-    std::string get_item() const {
+    const std::string &get_item() const {
         return item;
     }
 
-    std::string get_help() const {
+    const std::string &get_help() const {
         return help;
     }
 
-    bool operator()(Diagnostics &diag, JsonValue &value) const {
+    bool operator()(Problems &diag, JsonValue &value) const {
         if (!value) {
             diag.add_problem(
                 get_item(),
@@ -96,7 +98,7 @@ public:
         return validator;
     }
 
-    bool operator()(Diagnostics &diag, JsonValue &value) {
+    bool operator()(Problems &diag, JsonValue &value) const {
         bool result = ParamDefinition::operator()(diag, value);
         if (result) {
             auto &arr = to<json::Array>(value);
@@ -111,28 +113,36 @@ protected:
     T validator;
 };
 
+/**
+ * Object with fixed set of items. Key hashes of the items are computed once
+ * at construction, lookups then compare them with hashes cached by json::Object.
+ */
 template<typename... T>
 class Object_t: public ParamDefinition, public Mappable {
 public:
     Object_t(const char *item, const char *help, T... params):
         ParamDefinition(ValueType::Object, item, help),
-        params(std::forward_as_tuple(params...))
+        params(std::forward_as_tuple(params...)),
+        hashes{{json::detail::hash_key(params.get_item())...}}
     {}
 
-    bool operator()(Diagnostics &diag, JsonValue &value) const {
+    bool operator()(Problems &diag, JsonValue &value) const {
         auto res = ParamDefinition::operator()(diag, value);
 
         if (res) {
             auto &obj = to<json::Object>(value);
 
             // Test if there are all required options in the struct
-            res &= call_func(diag, obj, std::index_sequence_for<T...>{});
-
-            // TODO: Test if there is no unexpected argument.
-            for (auto &pair: obj) {
-                if (!find_item(pair.first, std::index_sequence_for<T...>{})) {
-                    diag.add_problem(pair.first, ProblemCode::UnexpectedParam, "Object does not have item " + pair.first);
-                    res &= false;
+            std::size_t found = 0;
+            res &= validate_items(diag, obj, found);
+
+            // Keys are unique, so if all of them were matched, there is no unexpected one.
+            if (found != obj.size()) {
+                for (auto &pair: obj) {
+                    if (!has_item(pair.first, pair.get_hash())) {
+                        diag.add_problem(pair.first, ProblemCode::UnexpectedParam, "Object does not have item " + pair.first);
+                        res &= false;
+                    }
                 }
             }
         }
@@ -147,37 +157,46 @@ public:
 
 protected:
     std::tuple<T...> params;
+    std::array<uint32_t, sizeof...(T)> hashes;
 
-    template<typename Head, typename... Tail>
-    bool int_validator(Diagnostics &diag, json::Object &obj, Head head, Tail... tail) const {
-        auto res = head(diag, obj[head.get_item()]);
-        res &= int_validator(diag, obj, tail...);
+    template<std::size_t I = 0>
+    std::enable_if_t<(I < sizeof...(T)), bool> validate_items(Problems &diag, json::Object &obj, std::size_t &found) const {
+        auto &param = std::get<I>(params);
+        bool res;
+
+        auto it = obj.find(param.get_item(), hashes[I]);
+        if (it != obj.end()) {
+            ++found;
+            res = param(diag, it->second);
+        } else {
+            // Item is stored only when validator provides default value for it.
+            JsonValue missing;
+            res = param(diag, missing);
+            if (missing) {
+                obj.emplace(param.get_item(), std::move(missing));
+                ++found;
+            }
+        }
+
+        res &= validate_items<I + 1>(diag, obj, found);
         return res;
     }
 
-    bool int_validator(Diagnostics &, json::Object &) const {
+    template<std::size_t I>
+    std::enable_if_t<(I == sizeof...(T)), bool> validate_items(Problems &, json::Object &, std::size_t &) const {
         return true;
     }
 
-    template<std::size_t ...I>
-    bool call_func(Diagnostics &diag, json::Object &obj, std::index_sequence<I...>) const {
-        return int_validator(diag, obj, std::get<I>(params)...);
-    }
-
-    template<typename Head, typename... Tail>
-    bool int_find_item(const std::string &item, Head head, Tail... tail) const {
-        return head.get_item() == item || int_find_item(item, tail...);
+    template<std::size_t I = 0>
+    std::enable_if_t<(I < sizeof...(T)), bool> has_item(const std::string &item, uint32_t hash) const {
+        return (hashes[I] == hash && std::get<I>(params).get_item() == item) || has_item<I + 1>(item, hash);
     }
 
-    bool int_find_item(const std::string &) const {
+    template<std::size_t I>
+    std::enable_if_t<(I == sizeof...(T)), bool> has_item(const std::string &, uint32_t) const {
         return false;
     }
 
-    template<std::size_t ...I>
-    bool find_item(const std::string &item, std::index_sequence<I...>) const {
-        return int_find_item(item, std::get<I>(params)...);
-    }
-
     template<typename C, std::size_t... I>
     void int_map(C call, std::index_sequence<I...>) {
         int_map2(call, std::get<I>(params)...);
@@ -37,7 +37,8 @@ enum class ProblemCode {
     WrongType = 401,
     CannotBeNull = 402,
     MustBePresent = 403,
-    UnexpectedParam = 404
+    UnexpectedParam = 404,
+    OutOfRange = 405
 };
 
 class Problem {
@@ -76,13 +77,13 @@ protected:
     const std::string description;
 };
 
-class Diagnostics: public json::Exception {
+/**
+ * Problems found by validators. Empty list does not allocate, so validation
+ * that succeeds costs no memory allocation.
+ */
+class Problems {
 public:
-    Diagnostics(): json::Exception("There were errors processing your request.")
-    {}
-
-    Diagnostics(Diagnostics &&) = default;
-    Diagnostics(const Diagnostics &) = default;
+    static constexpr const char *Message = "There were errors processing your request.";
 
     void add_problem(Problem &&problem) {
         problems.emplace_back(std::forward<Problem>(problem));
@@ -96,11 +97,11 @@ public:
         );
     }
 
-    const std::vector<Problem> &get_problems() {
+    const std::vector<Problem> &get_problems() const {
         return problems;
     }
 
-    operator bool() {
+    operator bool() const {
         return !problems.empty();
     }
 
@@ -108,6 +109,21 @@ protected:
     std::vector<Problem> problems;
 };
 
+/**
+ * Problems thrown as exception by the throwing validate() variant.
+ */
+class Diagnostics: public json::Exception, public Problems {
+public:
+    Diagnostics(): json::Exception(Message)
+    {}
+
+    explicit Diagnostics(Problems &&problems): json::Exception(Message), Problems(std::move(problems))
+    {}
+
+    Diagnostics(Diagnostics &&) = default;
+    Diagnostics(const Diagnostics &) = default;
+};
+
 } // namespace gcm
 } // namespace json
 } // namespace validator
@@ -76,7 +76,7 @@ public:
         detail::ParamDefinition(ValueType::Null, item, help)
     {}
 
-    bool operator()(Diagnostics &diag, JsonValue &value) const {
+    bool operator()(Problems &diag, JsonValue &value) const {
         if (!value) {
             diag.add_problem(
                 get_item(),
@@ -92,6 +92,19 @@ public:
         return handlers;
     }
 
+    /**
+     * Whether message of given type would be written by any handler. Lets callers skip
+     * building expensive messages.
+     */
+    bool is_enabled(MessageType type) {
+        for (auto &handler: get_handlers()) {
+            if (handler->is_enabled(type)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
 	const std::string &get_name() {
 		return name;
 	}
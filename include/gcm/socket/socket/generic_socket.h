@@ -27,8 +27,10 @@
 #include <string>
 #include <vector>
 
+#include <errno.h>
 #include <string.h>
 
+#include <poll.h>
 #include <pthread.h>
 #include <signal.h>
 #include <sys/socket.h>
@@ -190,6 +192,31 @@ public:
         return ::read(this->fd, val, size);
     }
 
+    /**
+     * Whether the other side has closed the connection. Does not block and does not
+     * consume any data waiting in the socket. On TCP, closed socket of peer is seen only
+     * as end of file, same as peer that just shut down its writing side, so both are
+     * taken as closed.
+     */
+    bool peer_closed() {
+        pollfd pfd{this->fd, POLLIN | POLLRDHUP, 0};
+        if (::poll(&pfd, 1, 0) <= 0) {
+            return false;
+        }
+
+        if (pfd.revents & (POLLHUP | POLLRDHUP | POLLERR)) {
+            return true;
+        }
+
+        char ch;
+        ssize_t received = ::recv(this->fd, &ch, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (received >= 0) {
+            return received == 0;
+        }
+
+        return errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+    }
+
     // Set binary flag.
     WritableSocket &operator<<(binary_flag binary) {
         binary_flag = binary.is_binary();
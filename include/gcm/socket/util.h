@@ -42,6 +42,11 @@ IPs can have following formats:
 
 */
 
+/**
+ * Unlike std::find, returns begin when item is not found. Call it qualified as
+ * util::find, for std iterators unqualified call is ambiguous with std::find
+ * once <algorithm> is included.
+ */
 template<typename I, typename T>
 I find(I begin, I end, T item) {
     I old_begin = begin;
@@ -61,7 +66,7 @@ in_port_t get_port(I begin, I end) {
     std::reverse_iterator<I> rbegin(end);
     std::reverse_iterator<I> rend(begin);
 
-    auto pos = find(rbegin, rend, ':');
+    auto pos = util::find(rbegin, rend, ':');
     if (pos == rbegin) {
         pos = rend;
     }
@@ -83,7 +88,7 @@ std::pair<I, I> get_ipv4(I begin, I end) {
     }
 
     // Find port part.
-    auto pos = find(begin, end, ':');
+    auto pos = util::find(begin, end, ':');
 
     // If there is no port in the string...
     if (begin == pos) {
@@ -111,10 +116,10 @@ std::pair<I, I> get_ipv6(I begin, I end) {
     std::reverse_iterator<I> rbegin(end);
     std::reverse_iterator<I> rend(begin);
 
-    I endpos = find(rbegin, rend, ':').base();
+    I endpos = util::find(rbegin, rend, ':').base();
 
     if (*begin == '[') {
-        endpos = find(begin, end, ']');
+        endpos = util::find(begin, end, ']');
         if (endpos == begin) {
             return std::make_pair(end, end);
         }
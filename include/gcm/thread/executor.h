@@ -0,0 +1,104 @@
+/**
+ * Copyright 2014 Michal Kuchta <niximor@gmail.com>
+ *
+ * This file is part of GCM::AppSrv.
+ *
+ * GCM::AppSrv is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * GCM::AppSrv is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with GCM::AppSrv. If not, see http://www.gnu.org/licenses/.
+ *
+ * @author Michal Kuchta <niximor@gmail.com>
+ * @date 2026-10-18
+ *
+ */
+
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "pool.h"
+
+namespace gcm {
+namespace thread {
+
+/**
+ * Move-only task of Executor. Unlike std::function, it can own callables that can not
+ * be copied, such as connected sockets.
+ */
+class Task {
+public:
+    Task() = default;
+
+    template<typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Task>::value>>
+    Task(F &&f):
+        callable(std::make_unique<Callable<std::decay_t<F>>>(std::forward<F>(f)))
+    {}
+
+    Task(Task &&) = default;
+    Task &operator=(Task &&) = default;
+
+    void operator()() {
+        (*callable)();
+    }
+
+    explicit operator bool() const {
+        return callable != nullptr;
+    }
+
+protected:
+    struct Base {
+        virtual ~Base() = default;
+        virtual void operator()() = 0;
+    };
+
+    template<typename F>
+    struct Callable: public Base {
+        template<typename G>
+        explicit Callable(G &&g): f(std::forward<G>(g))
+        {}
+
+        void operator()() override {
+            f();
+        }
+
+        F f;
+    };
+
+    std::unique_ptr<Base> callable;
+};
+
+/**
+ * Pool of move-only tasks. Server shares one by all interfaces of the process for calls
+ * of methods that are not in a bulkhead; each interface serves its connections by its
+ * own, as they block their threads while waiting for clients or calls.
+ *
+ * It is not a single executor of connections and calls. Threads a request uses:
+ * - Single call of method without policy runs on the connection thread that read it.
+ * - Async method, bulkhead or other priority class finishes single call on other thread;
+ *   continuation writing the response is then scheduled on the connection pool.
+ * - Calls of batch run here, while the connection thread waits for them.
+ * - Closed connections are detected by a watcher thread of each HTTP JSON-RPC interface.
+ */
+class Executor: public Pool<Task> {
+public:
+    using Pool<Task>::Pool;
+
+    template<typename F>
+    void submit(F &&f, Priority priority = Priority::Interactive) {
+        add_work(Task(std::forward<F>(f)), priority);
+    }
+};
+
+} // namespace thread
+} // namespace gcm
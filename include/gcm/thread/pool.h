@@ -29,8 +29,11 @@
 #include <chrono>
 #include <deque>
 #include <list>
+#include <array>
 #include <atomic>
 #include <memory>
+#include <cstdint>
+#include <algorithm>
 
 #include <gcm/logging/logging.h>
 
@@ -41,6 +44,34 @@ enum class WorkerState {
     Starting, Free, Busy
 };
 
+/**
+ * Scheduling class of task. Each class has its own queue, see Pool::set_scheduling().
+ */
+enum class Priority {
+    Critical, Interactive, Bulk
+};
+
+static constexpr const std::size_t NumPriorities = static_cast<std::size_t>(Priority::Bulk) + 1;
+
+inline const char *to_string(Priority priority) {
+    switch (priority) {
+        case Priority::Critical: return "critical";
+        case Priority::Interactive: return "interactive";
+        default: return "bulk";
+    }
+}
+
+/**
+ * Queue of one scheduling class, as seen at the time of Pool::queue_stats() call.
+ * Times are in microseconds.
+ */
+struct QueueStats {
+    std::size_t queued = 0;
+    uint64_t started = 0;
+    uint64_t total_wait_us = 0;
+    uint64_t max_wait_us = 0;
+};
+
 template<typename T>
 class Pool;
 
@@ -95,7 +126,7 @@ public:
 
             std::unique_lock<std::mutex> lock(pool.worker_mutex);
             while (!quit) {
-                if (!pool.tasks.empty()) break;
+                if (pool.num_queued > 0) break;
                 pool.worker_cond.wait(lock);
             }
 
@@ -107,8 +138,7 @@ public:
             pool.num_free--;
             pool.num_busy++;
 
-            T task{std::move(pool.tasks.front())};
-            pool.tasks.pop_front();
+            T task{pool.take()};
 
             lock.unlock();
 
@@ -160,9 +190,17 @@ public:
     Pool(Pool &&other) = delete;
 
     void stop() {
-        quit = true;
+        {
+            std::unique_lock<std::mutex> lock(keeper_mutex);
+            quit = true;
+        }
         keeper_cond.notify_all();
 
+        // Keeper must be gone before workers are collected, it touches the same lists.
+        if (keeper_thread.joinable()) {
+            keeper_thread.join();
+        }
+
         std::unique_lock<std::mutex> lock(worker_mutex);
         while (!workers.empty()) {
             auto it = workers.begin();
@@ -180,16 +218,45 @@ public:
         }
     }
 
-    void add_work(T &&w) {
+    void add_work(T &&w, Priority priority = Priority::Interactive) {
         std::unique_lock<std::mutex> lock(worker_mutex);
-        tasks.emplace_back(std::forward<T>(w));
+        queues[static_cast<std::size_t>(priority)].tasks.emplace_back(Queued{std::forward<T>(w), Clock::now()});
+        ++num_queued;
 
         worker_cond.notify_one();
     }
 
+    /**
+     * Set share of workers each class gets while all of them have work (weighted round
+     * robin, in order of Priority), and the time after which waiting task is taken first
+     * regardless of its class, so that no class starves.
+     */
+    void set_scheduling(const std::array<unsigned, NumPriorities> &weights, std::chrono::milliseconds max_wait) {
+        std::unique_lock<std::mutex> lock(worker_mutex);
+        for (std::size_t i = 0; i < NumPriorities; ++i) {
+            this->weights[i] = std::max(weights[i], 1u);
+        }
+        this->max_wait = max_wait;
+    }
+
+    QueueStats queue_stats(Priority priority) {
+        std::unique_lock<std::mutex> lock(worker_mutex);
+        auto &queue = queues[static_cast<std::size_t>(priority)];
+
+        QueueStats out = queue.stats;
+        out.queued = queue.tasks.size();
+
+        // Tasks still waiting count too, otherwise starving queue would look fine.
+        if (!queue.tasks.empty()) {
+            uint64_t waiting = wait_us(queue.tasks.front().queued, Clock::now());
+            out.max_wait_us = std::max(out.max_wait_us, waiting);
+        }
+
+        return out;
+    }
+
     ~Pool() {
         stop();
-        keeper_thread.join();
     }
 
 protected:
@@ -199,7 +266,24 @@ protected:
     size_t max_workers;
     size_t check_interval;
 
-    std::deque<T> tasks;
+    using Clock = std::chrono::steady_clock;
+
+    struct Queued {
+        T task;
+        Clock::time_point queued;
+    };
+
+    struct Queue {
+        std::deque<Queued> tasks;
+        int64_t current = 0;
+        QueueStats stats;
+    };
+
+    // Guarded by worker_mutex.
+    std::array<Queue, NumPriorities> queues;
+    std::array<unsigned, NumPriorities> weights{{16, 4, 1}};
+    std::size_t num_queued = 0;
+    std::chrono::milliseconds max_wait{1000};
 
     std::condition_variable worker_cond;
     std::mutex worker_mutex;
@@ -212,14 +296,74 @@ protected:
     std::atomic<int> num_starting;
 
     bool quit;
-    std::thread keeper_thread;
 
     std::condition_variable keeper_cond;
     std::mutex keeper_mutex;
 
+    // Started last, after everything it uses has been constructed.
+    std::thread keeper_thread;
+
 protected:
+    static uint64_t wait_us(Clock::time_point queued, Clock::time_point now) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(now - queued).count();
+    }
+
+    /**
+     * Take next task, called with worker_mutex held and some task queued. Smooth
+     * weighted round robin picks between non-empty queues, unless head of some queue
+     * waits longer than max_wait; then the longest waiting one is taken.
+     */
+    T take() {
+        auto now = Clock::now();
+
+        Queue *chosen = nullptr;
+        for (auto &queue: queues) {
+            if (!queue.tasks.empty() && now - queue.tasks.front().queued > max_wait
+                && (chosen == nullptr || queue.tasks.front().queued < chosen->tasks.front().queued))
+            {
+                chosen = &queue;
+            }
+        }
+
+        if (chosen == nullptr) {
+            int64_t total = 0;
+            for (std::size_t i = 0; i < NumPriorities; ++i) {
+                auto &queue = queues[i];
+                if (!queue.tasks.empty()) {
+                    queue.current += weights[i];
+                    total += weights[i];
+
+                    if (chosen == nullptr || queue.current > chosen->current) {
+                        chosen = &queue;
+                    }
+                }
+            }
+
+            chosen->current -= total;
+        }
+
+        Queued queued{std::move(chosen->tasks.front())};
+        chosen->tasks.pop_front();
+        --num_queued;
+
+        // Queue that ran empty does not keep credit for later.
+        if (chosen->tasks.empty()) {
+            chosen->current = 0;
+        }
+
+        uint64_t waited = wait_us(queued.queued, now);
+        ++chosen->stats.started;
+        chosen->stats.total_wait_us += waited;
+        chosen->stats.max_wait_us = std::max(chosen->stats.max_wait_us, waited);
+
+        return std::move(queued.task);
+    }
+
     void keeper_func() {
+        std::unique_lock<std::mutex> lock(keeper_mutex);
         while (!quit) {
+            lock.unlock();
+
             kill_spares();
             start_spares();
 
@@ -228,8 +372,8 @@ protected:
                 to_collect.pop_back();
             }
 
-            std::unique_lock<std::mutex> lock(keeper_mutex);
-            keeper_cond.wait_for(lock, std::chrono::milliseconds(check_interval));
+            lock.lock();
+            keeper_cond.wait_for(lock, std::chrono::milliseconds(check_interval), [&](){ return quit; });
         }
     }
 
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <gcm/json/json.h>
+#include <gcm/json/parser.h>
+#include <gcm/json/msgpack.h>
+#include <gcm/json/cbor.h>
+#include <gcm/json/rpc/exception.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Encodings of request and response bodies. All of them map to the same
+ * gcm::json values, so methods do not need to care which one was used.
+ */
+enum class BodyFormat {
+    Json, MsgPack, Cbor
+};
+
+/**
+ * Response to body that cannot be decoded.
+ */
+inline gcm::json::JsonValue parse_error() {
+    return gcm::json::rpc::RpcException(
+        gcm::json::make_null(),
+        gcm::json::rpc::ErrorCode::ParseError,
+        "Parse error."
+    ).to_json();
+}
+
+/**
+ * Whether binary body starts with an array, which makes it a batch.
+ */
+inline bool starts_with_array(BodyFormat format, const char *begin, const char *end) {
+    if (begin == end) {
+        return false;
+    }
+
+    uint8_t tag = static_cast<uint8_t>(*begin);
+    if (format == BodyFormat::MsgPack) {
+        return (tag >= 0x90 && tag <= 0x9f) || tag == 0xdc || tag == 0xdd;
+    } else {
+        return (tag >> 5) == 4;
+    }
+}
+
+/**
+ * MessagePack or CBOR body. Body can contain more request objects following each
+ * other, the same as for JSON, or one array of requests.
+ */
+struct BinaryBody {
+    bool batch = false;
+
+    // Body could not be decoded to its end, items contain requests before the broken one.
+    bool broken = false;
+
+    std::vector<gcm::json::JsonValue> items;
+};
+
+/**
+ * Decode MessagePack or CBOR body. Broken batch throws ParseError, as nothing from it
+ * is executed.
+ */
+inline BinaryBody decode_binary_body(BodyFormat format, const char *begin, const char *end) {
+    BinaryBody body;
+    body.batch = starts_with_array(format, begin, end);
+
+    while (begin != end) {
+        gcm::json::JsonValue value;
+        try {
+            value = (format == BodyFormat::MsgPack)
+                ? gcm::json::msgpack::decode(begin, end)
+                : gcm::json::cbor::decode(begin, end);
+        } catch (gcm::json::ParseException &) {
+            if (body.batch) {
+                throw gcm::json::rpc::RpcException(gcm::json::rpc::ErrorCode::ParseError, "Parse error.");
+            }
+
+            body.broken = true;
+            break;
+        }
+
+        if (body.batch) {
+            body.items = std::move(gcm::json::to<gcm::json::Array>(value));
+
+            // Batch is one array, anything after it is not a request.
+            if (begin != end) {
+                throw gcm::json::rpc::RpcException(gcm::json::rpc::ErrorCode::ParseError, "Parse error.");
+            }
+            break;
+        }
+
+        body.items.push_back(std::move(value));
+    }
+
+    return body;
+}
@@ -25,17 +25,31 @@
 #include <gcm/socket/socket.h>
 #include <gcm/socket/http.h>
 #include <gcm/logging/logging.h>
-#include <gcm/thread/pool.h>
+#include <gcm/thread/executor.h>
 #include <gcm/json/json.h>
 #include <gcm/json/rpc.h>
 #include <gcm/json/parser.h>
+#include <gcm/json/msgpack.h>
+#include <gcm/json/cbor.h>
 #include <gcm/io/util.h>
 #include <gcm/appsrv/json_rpc_api.h>
 #include <gcm/dl/dl.h>
 
+#include "body.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <thread>
 #include <stdexcept>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 
 namespace s = gcm::socket;
 namespace l = gcm::logging;
@@ -54,8 +68,192 @@ std::string find_module(gcm::config::Config &cfg, std::string name, bool test_de
     }
 }
 
+const char *media_type(BodyFormat format) {
+    switch (format) {
+        case BodyFormat::MsgPack: return "application/msgpack";
+        case BodyFormat::Cbor: return "application/cbor";
+        default: return "application/json";
+    }
+}
+
+/**
+ * Match media type (without parameters, case insensitive) to body format.
+ */
+bool parse_media_type(std::string value, BodyFormat &format) {
+    value = value.substr(0, value.find(';'));
+    // Header comes from client, bytes over 0x7f must not reach <cctype> as negative values.
+    value.erase(std::remove_if(value.begin(), value.end(), [](unsigned char ch){ return std::isspace(ch); }), value.end());
+    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch){ return static_cast<char>(std::tolower(ch)); });
+
+    if (value == "application/json") {
+        format = BodyFormat::Json;
+    } else if (value == "application/msgpack" || value == "application/x-msgpack") {
+        format = BodyFormat::MsgPack;
+    } else if (value == "application/cbor") {
+        format = BodyFormat::Cbor;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Select response format. First supported type from Accept header wins, otherwise
+ * the response is encoded the same way as the request.
+ */
+BodyFormat negotiate_response(const std::string &accept, BodyFormat request_format) {
+    std::size_t pos = 0;
+    while (pos < accept.size()) {
+        std::size_t next = accept.find(',', pos);
+        if (next == std::string::npos) {
+            next = accept.size();
+        }
+
+        BodyFormat format;
+        if (parse_media_type(accept.substr(pos, next - pos), format)) {
+            return format;
+        }
+
+        pos = next + 1;
+    }
+
+    return request_format;
+}
+
+std::string encode_body(BodyFormat format, const gcm::json::JsonValue &value) {
+    switch (format) {
+        case BodyFormat::MsgPack: return gcm::json::msgpack::encode(value);
+        case BodyFormat::Cbor: return gcm::json::cbor::encode(value);
+        default: return value->to_string();
+    }
+}
+
+/**
+ * Cancels calls whose client has closed the connection. Batch polls its connection
+ * itself while waiting for calls (see run_calls()), but nobody waits for single call
+ * that is executing inline or on other thread, so its connection is polled here.
+ */
+class CloseWatcher {
+public:
+    using Socket = s::ConnectedSocket<s::AnyIpAddress>;
+
+    CloseWatcher(gcm::logging::Logger &log, std::chrono::milliseconds interval):
+        log(log),
+        interval(interval),
+        thread(&CloseWatcher::run, this)
+    {}
+
+    CloseWatcher(const CloseWatcher &) = delete;
+
+    ~CloseWatcher() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            quit = true;
+        }
+        cond.notify_all();
+        thread.join();
+    }
+
+    /**
+     * Cancel given cancellation once client closes the connection. Returns id for unwatch().
+     */
+    std::size_t watch(Socket &client, const gcm::json::rpc::Cancellation &cancellation) {
+        std::unique_lock<std::mutex> lock(mutex);
+        std::size_t id = next_id++;
+        watched.emplace(id, Watched{&client, cancellation});
+        cond.notify_all();
+        return id;
+    }
+
+    /**
+     * Stop watching. Socket is not touched by the watcher once this returns.
+     */
+    void unwatch(std::size_t id) {
+        std::unique_lock<std::mutex> lock(mutex);
+        watched.erase(id);
+    }
+
+protected:
+    struct Watched {
+        Socket *client;
+        gcm::json::rpc::Cancellation cancellation;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!quit) {
+            if (watched.empty()) {
+                cond.wait(lock);
+                continue;
+            }
+
+            if (cond.wait_for(lock, interval, [&](){ return quit; })) {
+                break;
+            }
+
+            // Polling does not block, socket is still owned by its connection.
+            for (auto it = watched.begin(); it != watched.end();) {
+                if (it->second.client->peer_closed()) {
+                    auto &addr = it->second.client->get_client_address();
+                    DEBUG(log) << "Client " << addr.get_ip() << ":" << addr.get_port() << " closed connection, cancelling its call.";
+                    it->second.cancellation.cancel();
+                    it = watched.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    gcm::logging::Logger &log;
+    std::chrono::milliseconds interval;
+
+    // Guarded by mutex.
+    std::map<std::size_t, Watched> watched;
+    std::size_t next_id = 0;
+    bool quit = false;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    // Started last, after everything it uses has been constructed.
+    std::thread thread;
+};
+
 class JsonHttpHandler: public gcm::appsrv::Handler {
 protected:
+    using Socket = s::ConnectedSocket<s::AnyIpAddress>;
+    using Response = HttpResponse<Socket &>;
+
+    /**
+     * Connection of client. It is owned by the task that serves it, or by continuation
+     * of the call it waits for.
+     */
+    struct Connection {
+        Connection(JsonHttpHandler &handler, Socket &&client):
+            handler(handler),
+            client(std::move(client))
+        {
+            std::unique_lock<std::mutex> lock(handler.connections_mutex);
+            ++handler.num_connections;
+        }
+
+        Connection(const Connection &) = delete;
+
+        ~Connection() {
+            std::unique_lock<std::mutex> lock(handler.connections_mutex);
+            --handler.num_connections;
+            handler.connections_cond.notify_all();
+        }
+
+        JsonHttpHandler &handler;
+        Socket client;
+        std::unique_ptr<HttpRequest> request;
+        std::unique_ptr<Response> response;
+        BodyFormat response_format = BodyFormat::Json;
+    };
+
     gcm::appsrv::ServerApi &api;
     gcm::dl::Library module;
     gcm::logging::Logger &log;
@@ -64,141 +262,554 @@ protected:
     
     void *module_data;
 
+    // Max. number of calls from one request executed at once, 0 for no limit.
+    std::size_t batch_concurrency;
+
+    // Time calls of one request have to finish, 0 for no limit.
+    std::chrono::milliseconds call_timeout;
+
+    // Calls per client address and method, see rate_limit in interface config.
+    gcm::json::rpc::RateLimits limits;
+
+    // Single calls executing, cancelled when their client goes away.
+    CloseWatcher close_watcher;
+
+    // Open connections, guarded by connections_mutex. Handler waits for them when stopped.
+    std::mutex connections_mutex;
+    std::condition_variable connections_cond;
+    std::size_t num_connections = 0;
+
+    // Set when handler is stopped, keep-alive connections are closed after their response.
+    std::atomic<bool> stopping{false};
+
 public:
     JsonHttpHandler(gcm::appsrv::ServerApi &api):
         api(api),
         module(find_module(api.config, api.interface_config["module"].asString())),
         log(l::getLogger(api.handler_name)),
-        json(log),
+        json(log, api.executor),
         rpc_api(json, api, log),
-        module_data(nullptr)
+        module_data(nullptr),
+        batch_concurrency(api.interface_config.get("batch_concurrency", 16)),
+        call_timeout(api.interface_config.get("call_timeout", 0)),
+        close_watcher(log, std::chrono::milliseconds(100))
     {
+        // Share of the executor this interface can take, further calls are executed by
+        // connections that wait for them.
+        json.set_max_queued(api.interface_config.get("max_queued_calls", 64));
+
+        setup_rate_limits();
+        setup_scheduling();
+        setup_access_log();
+        setup_result_validation();
+
         // Init the library
         try {
             module_data = module.get<void *, void *>("init")(&rpc_api);
         } catch (gcm::dl::DlError &e) {
             ERROR(log) << "Exception thrown while loading module: " << e.what();
         }
+
+        // All methods are registered now.
+        json.freeze();
     }
 
     ~JsonHttpHandler() {
+        stopping = true;
+
         // Finish the library
         try {
             module.get<void, void *>("stop")(module_data);
         } catch (gcm::dl::DlError &e) {
             ERROR(log) << "Exception thrown while unloading module: " << e.what();
         }
+
+        // Calls the module left unfinished have failed, so their connections get response.
+        std::unique_lock<std::mutex> lock(connections_mutex);
+        connections_cond.wait(lock, [&](){ return num_connections == 0; });
+    }
+
+    static gcm::json::rpc::RateLimit read_limit(gcm::config::Value &cfg) {
+        return gcm::json::rpc::RateLimit{cfg.get("rate", 0.0), cfg.get("burst", 1.0)};
     }
 
-    template<typename R, typename I>
-    void process_body(R &response, I begin, I end) {
+    void setup_rate_limits() {
+        auto *cfg = api.interface_config.get("rate_limit");
+        if (cfg == nullptr) {
+            return;
+        }
+
+        std::size_t max_clients = cfg->get("max_clients", 4096);
+
+        if (auto *client = cfg->get("client")) {
+            limits.set_client_limit(read_limit(*client), max_clients);
+        }
+
+        if (auto *methods = cfg->get("methods")) {
+            for (auto &method: methods->asArray()) {
+                limits.set_method_limit(method["name"].asString(), read_limit(method), max_clients);
+            }
+        }
+    }
+
+    void setup_access_log() {
+        auto *cfg = api.interface_config.get("access_log");
+        if (cfg == nullptr) {
+            return;
+        }
+
+        json.set_access_log(gcm::json::rpc::AccessLogPolicy{
+            cfg->get("sample_rate", 1.0),
+            static_cast<std::size_t>(cfg->get("max_params", 256)),
+            std::chrono::milliseconds(cfg->get("slow_ms", 0))
+        });
+    }
+
+    void setup_result_validation() {
+        auto *cfg = api.interface_config.get("result_validation");
+        if (cfg == nullptr) {
+            return;
+        }
+
+        using gcm::json::rpc::ResultValidation;
+
+        std::string mode = cfg->get("mode", "always");
+        gcm::json::rpc::ResultValidationPolicy policy{ResultValidation::Always, 1};
+
+        if (mode == "sampled") {
+            policy.mode = ResultValidation::Sampled;
+            auto sample_every = cfg->get("sample_every", 100);
+            policy.sample_every = sample_every > 1 ? static_cast<unsigned>(sample_every) : 1;
+        } else if (mode == "off") {
+            policy.mode = ResultValidation::Off;
+        } else if (mode != "always") {
+            WARNING(log) << "Unknown result validation mode " << mode << ", validating all results.";
+        }
+
+        json.set_result_validation(policy);
+    }
+
+    void setup_scheduling() {
+        auto *cfg = api.interface_config.get("scheduling");
+        if (cfg == nullptr) {
+            return;
+        }
+
+        std::array<unsigned, gcm::thread::NumPriorities> weights{{16, 4, 1}};
+        if (auto *cfg_weights = cfg->get("weights")) {
+            for (std::size_t i = 0; i < weights.size() && i < cfg_weights->asArray().size(); ++i) {
+                weights[i] = (*cfg_weights)[i].asInt();
+            }
+        }
+
+        json.set_scheduling(weights, std::chrono::milliseconds(cfg->get("max_wait", 1000)));
+    }
+
+    /**
+     * One request of the body. Notification (request without id) gets no response.
+     */
+    struct Call {
+        gcm::json::JsonValue id;
+        std::string method;
+        gcm::json::JsonValue params;
+        bool notification;
+    };
+
+    /**
+     * Parsed request body. Batch is a JSON-RPC 2.0 array of requests; without batch, body
+     * can contain more request objects following each other.
+     */
+    struct Requests {
+        bool batch = false;
+        std::size_t size = 0;
+        std::size_t num_notifications = 0;
+        std::vector<Call> calls;
+        std::vector<gcm::json::JsonValue> invalid;
+
+        // Address the request came from, for rate limits.
+        std::string client;
+
+        // Calls not started by this time are dropped.
+        gcm::json::rpc::Cancellation::Clock::time_point deadline = gcm::json::rpc::Cancellation::Clock::time_point::max();
+    };
+
+    /**
+     * Deadline of calls of request: call_timeout from interface config, or shorter
+     * timeout in milliseconds from X-Request-Timeout header.
+     */
+    template<typename Request>
+    gcm::json::rpc::Cancellation::Clock::time_point call_deadline(Request &request) {
+        std::chrono::milliseconds timeout = call_timeout;
+
+        if (request.has_header("X-Request-Timeout")) {
+            long value = std::strtol(request["X-Request-Timeout"].c_str(), nullptr, 10);
+            if (value > 0 && (timeout.count() == 0 || value < timeout.count())) {
+                timeout = std::chrono::milliseconds(value);
+            }
+        }
+
+        if (timeout.count() == 0) {
+            return gcm::json::rpc::Cancellation::Clock::time_point::max();
+        }
+
+        return gcm::json::rpc::Cancellation::Clock::now() + timeout;
+    }
+
+    /**
+     * Queue call for execution. Requests without method get Invalid Request response,
+     * calls over rate limit get Server Error response.
+     */
+    void add_call(gcm::json::JsonValue &&id, const gcm::json::JsonValue &method, gcm::json::JsonValue &&params, Requests &requests) {
+        ++requests.size;
+
+        // Id is written to response, only string, number or null can be there.
+        bool valid_id = !id || id->get_type() == gcm::json::ValueType::String || id->get_type() == gcm::json::ValueType::Int
+            || id->get_type() == gcm::json::ValueType::Double || id->get_type() == gcm::json::ValueType::Null;
+
+        if (!valid_id || !method || method->get_type() != gcm::json::ValueType::String) {
+            requests.invalid.push_back(gcm::json::rpc::RpcException(
+                id && valid_id ? std::move(id) : gcm::json::make_null(),
+                gcm::json::rpc::ErrorCode::InvalidRequest,
+                "Invalid request."
+            ).to_json());
+            return;
+        }
+
+        std::string method_name(gcm::json::to<gcm::json::String>(method));
+        bool notification = !id;
+
+        if (!limits.empty() && !limits.try_acquire(requests.client, method_name)) {
+            DEBUG(log) << "Rate limit of " << method_name << " exceeded by " << requests.client << ".";
+
+            if (!notification) {
+                requests.invalid.push_back(gcm::json::rpc::RpcException(
+                    std::move(id),
+                    gcm::json::rpc::ErrorCode::ServerError,
+                    "Rate limit exceeded."
+                ).to_json());
+            }
+            return;
+        }
+
+        if (notification) {
+            ++requests.num_notifications;
+        }
+
+        requests.calls.push_back(Call{std::move(id), std::move(method_name), std::move(params), notification});
+    }
+
+    /**
+     * Read JSON requests. Only the envelope is scanned here, params are parsed by the worker.
+     */
+    void add_json_calls(const gcm::json::Buffer &body, Requests &requests) {
+        const char *begin = body->data();
+        const char *end = body->data() + body->size();
+
+        const char *begin1 = gcm::json::detail::skip_ws(begin, end);
+        std::vector<gcm::json::rpc::Envelope> items;
+
+        bool ok = true;
+        if (begin1 != end && *begin1 == '[') {
+            requests.batch = true;
+            ok = gcm::json::rpc::scan_batch(body, begin1, end, items);
+        } else {
+            gcm::json::rpc::Envelope call;
+            while (gcm::json::rpc::scan_envelope(body, begin1, end, call)) {
+                items.push_back(std::move(call));
+            }
+        }
+
+        if (!ok || begin1 != end) {
+            auto pos = gcm::parser::calc_line_column(begin, begin1);
+            ERROR(log) << "Bad request. Parse error at " << pos.first << " column " << pos.second;
+            DEBUG(log) << "Request was: " << std::string(begin, end);
+
+            std::string spaces(pos.second - 1, ' ');
+            DEBUG(log) << "             " << spaces << "^";
+
+            // Nothing from broken batch is executed.
+            if (requests.batch) {
+                throw gcm::json::rpc::RpcException(gcm::json::rpc::ErrorCode::ParseError, "Parse error.");
+            }
+
+            // Requests before the broken one are executed, the rest of body gets one error.
+            ++requests.size;
+            requests.invalid.push_back(parse_error());
+        }
+
+        for (auto &call: items) {
+            add_call(std::move(call.id), call.method, std::move(call.params), requests);
+        }
+    }
+
+    /**
+     * Read MessagePack or CBOR requests, see decode_binary_body().
+     */
+    void add_binary_calls(BodyFormat format, const gcm::json::Buffer &body, Requests &requests) {
+        auto decoded = decode_binary_body(format, body->data(), body->data() + body->size());
+        requests.batch = decoded.batch;
+
+        for (auto &call: decoded.items) {
+            if (!call || call->get_type() != gcm::json::ValueType::Object) {
+                add_call(gcm::json::make_null(), nullptr, nullptr, requests);
+                continue;
+            }
+
+            auto &obj = gcm::json::to<gcm::json::Object>(call);
+            auto it = obj.find("id");
+            add_call(it != obj.end() ? it->second : nullptr, obj["method"], std::move(obj["params"]), requests);
+        }
+
+        // Requests before the broken one are executed, the rest of body gets one error.
+        if (decoded.broken) {
+            ERROR(log) << "Bad request. Cannot decode " << media_type(format) << " body.";
+
+            ++requests.size;
+            requests.invalid.push_back(parse_error());
+        }
+    }
+
+    /**
+     * Execute requests of body and write response. Returns false if the only call of the
+     * request finishes on other thread; response is written by its continuation then.
+     */
+    bool process_body(const std::shared_ptr<Connection> &connection, const gcm::json::Buffer &body) {
+        auto &response = *connection->response;
+        auto &client = connection->client;
+        auto &request = response.get_request();
+
+        BodyFormat request_format = BodyFormat::Json;
+        if (request.has_header("Content-Type")) {
+            parse_media_type(request["Content-Type"], request_format);
+        }
+
+        BodyFormat response_format = negotiate_response(request["Accept"], request_format);
+        response.set_header("Content-Type", media_type(response_format));
+        connection->response_format = response_format;
+
         try {
             try {
-                std::vector<std::shared_ptr<gcm::json::rpc::Promise>> promises;
-
-                gcm::json::JsonValue call;
-                I begin1 = begin;
-                I end1 = end;
-                while ((call = gcm::json::parse(begin1, end1)) != nullptr) {
-                    end1 = end;
-
-                    auto &obj = gcm::json::to<gcm::json::Object>(call);
-                    auto &id = obj["id"];
-                    auto &method = obj["method"];
-                    auto &params = obj["params"];
-
-                    if (method->get_type() == gcm::json::ValueType::String) {
-                        promises.push_back(json.add_work(
-                            id,
-                            std::string(gcm::json::to<gcm::json::String>(method)),
-                            (params->get_type() == gcm::json::ValueType::Array)
-                                ? gcm::json::to<gcm::json::Array>(params)
-                                : gcm::json::Array()
-                        ));
-                    }
+                Requests requests;
+                requests.client = client.get_client_address().get_ip();
+                requests.deadline = call_deadline(request);
+
+                if (request_format == BodyFormat::Json) {
+                    add_json_calls(body, requests);
+                } else {
+                    add_binary_calls(request_format, body, requests);
                 }
 
-                if (begin1 != end) {
-                    auto pos = gcm::parser::calc_line_column(begin, begin1);
-                    ERROR(log) << "Bad request. Parse error at " << pos.first << " column " << pos.second;
-                    DEBUG(log) << "Request was: " << std::string(begin, end);
+                if (requests.batch && requests.size == 0) {
+                    throw gcm::json::rpc::RpcException(gcm::json::rpc::ErrorCode::InvalidRequest, "Empty batch.");
+                }
+
+                if (requests.batch) {
+                    // Batch response is one array, it is sent when all calls are done.
+                    auto results = gcm::json::make_array();
+                    auto &arr = gcm::json::to<gcm::json::Array>(results);
+                    arr = std::move(requests.invalid);
+
+                    run_calls(requests, client, [&](gcm::json::JsonValue &&resp) {
+                        arr.push_back(std::move(resp));
+                    });
+
+                    // Batch of notifications only has no response at all.
+                    std::string out{arr.empty() ? std::string() : encode_body(response_format, results)};
+                    response.set_header("Content-Length", std::to_string(out.size()));
+                    response << out;
+                    return true;
+                }
 
-                    std::string spaces(pos.second - 1, ' ');
-                    DEBUG(log) << "             " << spaces << "^";
+                if (requests.calls.size() == 1 && requests.invalid.empty() && !requests.calls.front().notification) {
+                    return execute_call(connection, requests);
                 }
 
-                bool know_length = promises.size() <= 1;
+                std::size_t num_responses = requests.calls.size() - requests.num_notifications + requests.invalid.size();
+                bool know_length = num_responses <= 1;
+
+                if (num_responses == 0) {
+                    response.set_header("Content-Length", "0");
+                }
 
-                gcm::json::rpc::wait_all(promises, [&](gcm::json::rpc::Promise &p){
-                    auto resp = p.get();
-                    std::string out{resp->to_string()};
+                auto write = [&](gcm::json::JsonValue &&resp) {
+                    std::string out{encode_body(response_format, resp)};
 
                     if (know_length) {
                         response.set_header("Content-Length", std::to_string(out.size()));
                     }
 
                     response << out;
-                    return true;
-                });
+                };
+
+                for (auto &resp: requests.invalid) {
+                    write(std::move(resp));
+                }
+
+                run_calls(requests, client, write);
+                return true;
             } catch (gcm::json::rpc::RpcException &e) {
                 throw;
             } catch (gcm::json::Exception &e) {
                 throw gcm::json::rpc::RpcException(gcm::json::rpc::ErrorCode::InternalError, e.what());
             }
         } catch (gcm::json::rpc::RpcException &e) {
-            response << e.to_json()->to_string();
+            response << encode_body(response_format, e.to_json());
 
             throw;
         } catch (std::exception &e) {
-            auto obj = gcm::json::Object();
-            obj["id"] = gcm::json::make_null();
-            auto err = gcm::json::to<gcm::json::Object>(obj["error"] = gcm::json::make_object());
+            auto obj = gcm::json::make_object();
+            auto &o = gcm::json::to<gcm::json::Object>(obj);
+            o["id"] = gcm::json::make_null();
+            auto &err = gcm::json::to<gcm::json::Object>(o["error"] = gcm::json::make_object());
             err["code"] = gcm::json::make_int(gcm::json::rpc::ErrorCode::InternalError);
             err["message"] = gcm::json::make_string(e.what());
 
-            response << obj.to_string();
+            response << encode_body(response_format, obj);
 
             throw;
         }
     }
 
-    void handle(s::ConnectedSocket<s::AnyIpAddress> &&client) {
-        auto &addr = client.get_client_address();
+    /**
+     * Execute the only call of request. Connection would only wait for it, so the call
+     * runs right here unless its method is in a bulkhead, asynchronous or of other
+     * priority class. If it finishes on other thread, serving of the connection is
+     * scheduled on the connection pool then, and this task is free in the meantime.
+     * Like calls of run_calls(), the call is cancelled when client closes connection.
+     */
+    bool execute_call(const std::shared_ptr<Connection> &connection, Requests &requests) {
+        auto &call = requests.calls.front();
+
+        // Cancellable even without deadline.
+        gcm::json::rpc::Cancellation cancellation(requests.deadline);
+        std::size_t watch = close_watcher.watch(connection->client, cancellation);
+
+        auto promise = json.execute(std::move(call.id), std::move(call.method), std::move(call.params), cancellation);
+
+        if (promise->try_wait()) {
+            close_watcher.unwatch(watch);
+            respond(*connection, promise->get());
+            return true;
+        }
 
-        DEBUG(log) << "Handle client " << addr.get_ip() << ":" << addr.get_port() << ".";
+        promise->then([this, connection, watch](gcm::json::JsonValue result) {
+            close_watcher.unwatch(watch);
+            api.connections.submit([this, connection, result]() mutable {
+                serve(connection, std::move(result));
+            });
+        });
+
+        return false;
+    }
+
+    void respond(Connection &connection, gcm::json::JsonValue &&result) {
+        std::string out{encode_body(connection.response_format, result)};
+        connection.response->set_header("Content-Length", std::to_string(out.size()));
+        *connection.response << out;
+    }
+
+    bool keep_alive(Connection &connection) {
+        return !stopping && (*connection.response)["Connection"] == "keep-alive";
+    }
+
+    /**
+     * Execute calls in parallel, at most batch_concurrency of them at once, and pass
+     * responses to done in order of completion. Notifications are dispatched in request
+     * order as the calls before them are started, and nobody waits for them.
+     *
+     * Calls share one cancellation, that is cancelled when client closes the connection
+     * while waiting. Notifications only have the deadline, closing connection after
+     * sending them is fine.
+     */
+    template<typename Done>
+    void run_calls(Requests &requests, s::ConnectedSocket<s::AnyIpAddress> &client, Done done) {
+        auto &calls = requests.calls;
+        gcm::json::rpc::Cancellation cancellation(requests.deadline);
+        gcm::json::rpc::Cancellation notification_cancellation(requests.deadline);
+
+        std::size_t next = 0;
+        auto notify = [&](bool all) {
+            while (next < calls.size() && (all || calls[next].notification)) {
+                auto &call = calls[next++];
+                json.add_notification(std::move(call.method), std::move(call.params), notification_cancellation);
+            }
+        };
+
+        std::size_t num_calls = 0;
+        for (auto &call: calls) {
+            num_calls += call.notification ? 0 : 1;
+        }
+
+        if (num_calls == 0) {
+            notify(true);
+            return;
+        }
+
+        gcm::json::rpc::wait_limited(num_calls, batch_concurrency, [&](std::size_t i) {
+            notify(false);
+            auto &call = calls[next++];
+            auto promise = json.add_work(std::move(call.id), std::move(call.method), std::move(call.params), cancellation);
+
+            if (i + 1 == num_calls) {
+                notify(true);
+            }
+
+            return promise;
+        }, [&](gcm::json::rpc::Promise &p) {
+            done(p.get());
+        }, std::chrono::milliseconds(100), [&]() {
+            if (!cancellation.is_cancelled() && client.peer_closed()) {
+                DEBUG(log) << "Client " << requests.client << " closed connection, cancelling its calls.";
+                cancellation.cancel();
+            }
+        });
+    }
+
+    /**
+     * Serve requests of connection until it is closed, or until its call finishes on other
+     * thread. Continuation of the call then serves it further, starting with the result.
+     */
+    void serve(std::shared_ptr<Connection> connection, gcm::json::JsonValue &&result = nullptr) {
+        auto &client = connection->client;
+        auto &addr = client.get_client_address();
 
         try {
-            client << s::ascii;
+            bool open = true;
 
-            bool close = true;
-            do {
-                HttpRequest req;
+            if (result) {
+                respond(*connection, std::move(result));
+                open = keep_alive(*connection);
+            }
+
+            while (open) {
+                connection->request = std::make_unique<HttpRequest>();
+                auto &req = *connection->request;
                 req.parse(client);
 
-                auto response = req.get_response(client);
+                connection->response = std::make_unique<Response>(req.get_response(client));
+                auto &response = *connection->response;
                 response.set_header("Server", "GCM::JsonRpc Server " + gcm::appsrv::get_version());
-                response.set_header("Content-Type", "application/json");
 
                 if (!req.has_header("Content-Length")) {
                     throw HttpException(400);
                 }
 
-                std::string body;
-                body.reserve(std::stoi(req["Content-Length"]));
+                auto body = std::make_shared<std::string>();
+                body->reserve(std::stoi(req["Content-Length"]));
 
-                client >> body;
+                client >> *body;
 
-                process_body(response, body.begin(), body.end());
+                if (!process_body(connection, body)) {
+                    return;
+                }
 
                 /*DEBUG(log) << "Request headers:";
                 DEBUG(log) << std::string(req.get_headers());
                 DEBUG(log) << "Response headers:";
                 DEBUG(log) << std::string(response.get_headers());*/
 
-                if (response["Connection"] == "keep-alive") {
-                    close = false;
-                }
-            } while (!close);
+                open = keep_alive(*connection);
+            }
 
             /*response << "Hello world!<br />";
             response << "Interface " << api.handler_name << " statistics: <br />";
@@ -214,6 +825,15 @@ public:
 
         DEBUG(log) << "Client " << addr.get_ip() << ":" << addr.get_port() << " handled.";
     }
+
+    void handle(Socket &&client) {
+        auto &addr = client.get_client_address();
+
+        DEBUG(log) << "Handle client " << addr.get_ip() << ":" << addr.get_port() << ".";
+
+        client << s::ascii;
+        serve(std::make_shared<Connection>(*this, std::move(client)));
+    }
 };
 
 extern "C" {
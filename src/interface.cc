@@ -22,12 +22,14 @@
  */
 
 #include <future>
+#include <mutex>
+#include <condition_variable>
 
 #include <gcm/config/value.h>
 #include <gcm/socket/server.h>
 #include <gcm/socket/socket.h>
 #include <gcm/socket/util.h>
-#include <gcm/thread/pool.h>
+#include <gcm/thread/executor.h>
 #include <gcm/thread/signal.h>
 #include <gcm/appsrv/interface.h>
 #include <gcm/logging/logging.h>
@@ -56,11 +58,12 @@ std::string find_handler(gcm::config::Config &cfg, std::string name, bool test_d
     }
 }
 
-IntInterface::IntInterface(gcm::config::Config &cfg, gcm::config::Value &interface):
+IntInterface::IntInterface(gcm::config::Config &cfg, gcm::config::Value &interface, gcm::thread::Executor &executor):
     library(find_handler(cfg, interface["handler"].asString())),
     config(interface),
     interface_name(interface["name"].asString()),
-    cfgfile(cfg)
+    cfgfile(cfg),
+    executor(executor)
 {}
 
 IntInterface::~IntInterface() {
@@ -76,19 +79,16 @@ class IntHandler;
 
 class ClientProcessor {
 public:
-    ClientProcessor(s::ConnectedSocket<s::AnyIpAddress> &&client, Handler *handler, IntHandler &int_handler):
-        client(std::forward<s::ConnectedSocket<s::AnyIpAddress>>(client)),
-        handler(handler),
-        int_handler(int_handler)
-    {}
-    ClientProcessor(ClientProcessor &&) = default;
+    ClientProcessor(s::ConnectedSocket<s::AnyIpAddress> &&client, Handler *handler, IntHandler &int_handler);
+    ClientProcessor(ClientProcessor &&other);
+    ~ClientProcessor();
 
     void operator()();
 
 protected:
     s::ConnectedSocket<s::AnyIpAddress> client;
     Handler *handler;
-    IntHandler &int_handler;
+    IntHandler *int_handler;
 };
 
 class IntHandler {
@@ -98,7 +98,7 @@ public:
     IntHandler(gcm::dl::Library &lib, gcm::config::Value &cfg, ServerApi &api):
         library(lib),
         handler((Handler *)(library.get<void *, void *>("init")(&api))),
-        pool(gcm::thread::make_pool<ClientProcessor>(cfg.get("MinThreads", 5), cfg.get("MaxThreads", 100))),
+        connections(api.connections),
         name(cfg["name"].asString()),
         handler_stats(api.handler_stats)
     {
@@ -107,7 +107,11 @@ public:
     }
 
     ~IntHandler() {
-        pool->stop();
+        // Pool outlives the handler, wait only until its connections are served.
+        {
+            std::unique_lock<std::mutex> lock(queued_mutex);
+            queued_cond.wait(lock, [&](){ return num_queued == 0; });
+        }
 
         // Cleanup the module.
         try {
@@ -123,7 +127,7 @@ public:
 
     void operator()(s::ConnectedSocket<s::AnyIpAddress> &&client) {
         ++handler_stats.req_received;
-        pool->add_work(ClientProcessor(
+        connections.submit(ClientProcessor(
             std::forward<s::ConnectedSocket<s::AnyIpAddress>>(client),
             handler,
             *this
@@ -133,11 +137,41 @@ public:
 protected:
     gcm::dl::Library &library;
     Handler *handler;
-    std::shared_ptr<gcm::thread::Pool<ClientProcessor>> pool;
+    gcm::thread::Executor &connections;
     std::string name;
     Stats &handler_stats;
+
+    // Connections waiting for or being served by the pool, guarded by queued_mutex.
+    std::mutex queued_mutex;
+    std::condition_variable queued_cond;
+    std::size_t num_queued = 0;
 };
 
+ClientProcessor::ClientProcessor(s::ConnectedSocket<s::AnyIpAddress> &&client, Handler *handler, IntHandler &int_handler):
+    client(std::forward<s::ConnectedSocket<s::AnyIpAddress>>(client)),
+    handler(handler),
+    int_handler(&int_handler)
+{
+    std::unique_lock<std::mutex> lock(int_handler.queued_mutex);
+    ++int_handler.num_queued;
+}
+
+ClientProcessor::ClientProcessor(ClientProcessor &&other):
+    client(std::move(other.client)),
+    handler(other.handler),
+    int_handler(other.int_handler)
+{
+    other.int_handler = nullptr;
+}
+
+ClientProcessor::~ClientProcessor() {
+    if (int_handler != nullptr) {
+        std::unique_lock<std::mutex> lock(int_handler->queued_mutex);
+        --int_handler->num_queued;
+        int_handler->queued_cond.notify_all();
+    }
+}
+
 bool IntInterface::start() {
     auto &log = gcm::logging::getLogger("");
 
@@ -174,7 +208,11 @@ bool IntInterface::start() {
     // Stop server at sigint.
     gcm::thread::SignalBind on_sigint{Signal::at(SIGINT, std::bind(&s::TcpServer::stop, &server))};
 
-    ServerApi api{cfgfile, config, handler_stats, config["name"].asString()};
+    // Connections block their threads, so they are kept off the executor that runs calls.
+    // Before the handler, it uses the pool until it is stopped.
+    gcm::thread::Executor connections(config.get("MinThreads", 5), config.get("MaxThreads", 100));
+
+    ServerApi api{cfgfile, config, handler_stats, config["name"].asString(), executor, connections};
 
     try {
         IntHandler handler(library, config, api);
@@ -191,14 +229,14 @@ bool IntInterface::start() {
 void ClientProcessor::operator()() {
     try {
         handler->handle(std::move(client));
-        ++int_handler.handler_stats.req_handled;
+        ++int_handler->handler_stats.req_handled;
     } catch (std::exception &e) {
-        auto &log = l::getLogger(int_handler.name);
+        auto &log = l::getLogger(int_handler->name);
         ERROR(log) << "Caught exception while processing connection: " << e.what();
-        ++int_handler.handler_stats.req_error;
+        ++int_handler->handler_stats.req_error;
     } catch (...) {
-        auto &log = l::getLogger(int_handler.name);
+        auto &log = l::getLogger(int_handler->name);
         ERROR(log) << "Caught unknown exception while processing connection.";
-        ++int_handler.handler_stats.req_error;
+        ++int_handler->handler_stats.req_error;
     }
 }
\ No newline at end of file
@@ -26,6 +26,7 @@
 #include <gcm/config/config.h>
 #include <gcm/dl/dl.h>
 #include <gcm/socket/socket.h>
+#include <gcm/thread/executor.h>
 
 #include <future>
 
@@ -34,7 +35,7 @@ namespace appsrv {
 
 class IntInterface {
 public:
-    IntInterface(gcm::config::Config &cfg, gcm::config::Value &interface);
+    IntInterface(gcm::config::Config &cfg, gcm::config::Value &interface, gcm::thread::Executor &executor);
     IntInterface(IntInterface &&) = default;
     ~IntInterface();
 
@@ -48,6 +49,7 @@ protected:
     std::future<bool> server_task;
     std::string interface_name;
     gcm::config::Config &cfgfile;
+    gcm::thread::Executor &executor;
 };
 
 } // namespace appsrv
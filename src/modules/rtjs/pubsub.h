@@ -7,7 +7,10 @@
 #include <mutex>
 #include <condition_variable>
 #include <future>
+#include <functional>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 namespace gcm {
 namespace pubsub {
@@ -72,19 +75,115 @@ struct SessionInfo {
 template<typename ValueType>
 class Session {
 public:
+    using Callback = std::function<void(std::vector<ValueType> &&)>;
+
     template<typename T>
     Session(T timeout):
         last_activity(Clock::now()),
-        timeout(std::chrono::duration_cast<Duration>(timeout))
+        timeout(std::chrono::duration_cast<Duration>(timeout)),
+        wait_id(0)
     {}
 
     Session(const Session &) = delete;
     Session(Session &&) = default;
 
+    ~Session() {
+        // Asynchronous poll of removed session gets empty response.
+        if (pending) {
+            pending({});
+        }
+    }
+
+    /**
+     * Asynchronous poll completed by publish, to be called once no lock is held.
+     */
+    struct Ready {
+        Callback callback;
+        std::vector<ValueType> messages;
+
+        void operator()() {
+            callback(std::move(messages));
+        }
+    };
+
     void publish(const ValueType &value) {
+        Ready ready;
+        if (push(value, ready)) {
+            ready();
+        }
+    }
+
+    /**
+     * Queue message. If asynchronous poll is waiting, it is moved to ready together with
+     * the queued messages and true is returned; caller calls it.
+     */
+    bool push(const ValueType &value, Ready &ready) {
         std::unique_lock<std::mutex> lock(mutex);
         messages.push_back(value);
         cv.notify_all();
+
+        if (!pending) {
+            return false;
+        }
+
+        ready.callback = std::move(pending);
+        pending = nullptr;
+        take(ready.messages);
+        return true;
+    }
+
+    /**
+     * Deliver queued messages to callback. If there are none and wait is set, callback is
+     * kept and called by next publish() or by expire(), without blocking any thread.
+     * Returns id of the wait for expire(), or 0 if callback has been called already.
+     * Previous waiting callback of the session is called with no messages.
+     */
+    uint64_t poll_async(Callback callback, bool wait) {
+        reset_activity();
+
+        std::vector<ValueType> out;
+        Callback previous;
+        uint64_t id = 0;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (messages.empty() && wait) {
+                previous = std::move(pending);
+                pending = std::move(callback);
+                id = ++wait_id;
+            } else {
+                take(out);
+            }
+        }
+
+        if (previous) {
+            previous({});
+        }
+
+        if (id == 0) {
+            callback(std::move(out));
+        }
+
+        return id;
+    }
+
+    /**
+     * Timeout of asynchronous poll, callback is called with no messages.
+     */
+    void expire(uint64_t id) {
+        Callback waiting;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (pending && wait_id == id) {
+                waiting = std::move(pending);
+                pending = nullptr;
+            }
+        }
+
+        if (waiting) {
+            waiting({});
+        }
     }
 
     template<typename T>
@@ -111,12 +210,9 @@ public:
         std::vector<ValueType> out;
 
         std::unique_lock<std::mutex> lock(mutex);
-        for (auto &v: messages) {
-            out.push_back(v);
-        }
-        messages.clear();
+        take(out);
 
-        return std::move(out);
+        return out;
     }
 
     bool is_alive(const TimePoint &now) {
@@ -136,11 +232,23 @@ protected:
         last_activity = Clock::now();
     }
 
+    // Must be called with mutex held.
+    void take(std::vector<ValueType> &out) {
+        out.reserve(messages.size());
+        for (auto &v: messages) {
+            out.push_back(std::move(v));
+        }
+        messages.clear();
+    }
+
     std::mutex mutex;
     TimePoint last_activity;
     Duration timeout;
     std::deque<ValueType> messages;
     std::condition_variable cv;
+
+    Callback pending;
+    uint64_t wait_id;
 };
 
 template<typename ValueType>
@@ -153,14 +261,27 @@ public:
     Channel(Channel &&) = delete;
 
     /**
-     * Publish message to all sessions on this channel.
+     * Publish message to all sessions on this channel. Asynchronous polls completed by it
+     * are called after the channel is unlocked, so they can use the channel again.
      */
     void publish(const ValueType &value) {
         reset_activity();
-        std::unique_lock<std::mutex> channel_lock(mutex);
+        std::vector<typename Session<ValueType>::Ready> ready;
 
-        for (auto &it: sessions) {
-            it.second->publish(value);
+        {
+            std::unique_lock<std::mutex> channel_lock(mutex);
+
+            typename Session<ValueType>::Ready session_ready;
+            for (auto &it: sessions) {
+                if (it.second->push(value, session_ready)) {
+                    ready.push_back(std::move(session_ready));
+                    session_ready = typename Session<ValueType>::Ready();
+                }
+            }
+        }
+
+        for (auto &it: ready) {
+            it();
         }
     }
 
@@ -212,6 +333,13 @@ public:
         return get_session(session)->poll(duration);
     }
 
+    /**
+     * Return session, or throw SessionNotFound.
+     */
+    std::shared_ptr<Session<ValueType>> find_session(const IdSource::IdType &session) {
+        return get_session(session);
+    }
+
     /**
      * List sessions active on this channel.
      */
@@ -233,9 +361,11 @@ public:
     }
 
     /**
-     * Do the cleanup of sessions and return true if there are any active.
+     * Do the cleanup of sessions and return true if there are any active. Removed sessions
+     * are moved to expired, caller destroys them once it holds no lock, as that completes
+     * their asynchronous polls.
      */
-    bool test_active_sessions() {
+    bool test_active_sessions(std::vector<std::shared_ptr<Session<ValueType>>> &expired) {
         bool res = false;
         auto now = Clock::now();
 
@@ -246,8 +376,10 @@ public:
             changed = false;
             for (auto it = sessions.begin(); it != sessions.end(); ++it) {
                 if (!it->second->is_alive(now)) {
+                    expired.push_back(std::move(it->second));
                     sessions.erase(it);
                     changed = true;
+                    break;
                 } else {
                     res = true;
                 }
@@ -294,8 +426,19 @@ public:
     PubSub(const PubSub &) = delete;
     PubSub(PubSub &&) = default;
 
+    /**
+     * Call callback from cleanup thread whenever expired sessions have been removed.
+     */
+    void set_on_expire(std::function<void()> callback) {
+        std::unique_lock<std::mutex> lock(mutex);
+        on_expire = std::move(callback);
+    }
+
     ~PubSub() {
-        quit = true;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            quit = true;
+        }
         cv.notify_all();
         clean_task.get();
     }
@@ -322,6 +465,25 @@ public:
         return get_channel(channel)->poll(session, duration);
     }
 
+    /**
+     * Deliver messages of session to callback as soon as there are any, or empty list
+     * after timeout. No thread is blocked while waiting.
+     */
+    template<typename T>
+    void poll_async(const ChannelNameType &channel, const IdType &session, T duration,
+        typename Session<ValueType>::Callback callback)
+    {
+        auto s = get_channel(channel)->find_session(session);
+        uint64_t id = s->poll_async(std::move(callback), duration.count() > 0);
+
+        if (id != 0) {
+            std::unique_lock<std::mutex> lock(mutex);
+            timers.emplace(Clock::now() + duration, std::make_pair(std::weak_ptr<Session<ValueType>>(s), id));
+            timers_changed = true;
+            cv.notify_all();
+        }
+    }
+
     std::vector<ChannelNameType> list_channels() {
         std::vector<ChannelNameType> out;
 
@@ -357,29 +519,88 @@ protected:
     }
 
     bool clean_thread() {
+        std::unique_lock<std::mutex> lock(mutex);
+        TimePoint next_clean = Clock::now() + std::chrono::seconds(1);
+
         while (!quit) {
-            std::unique_lock<std::mutex> lock(mutex);
-            cv.wait_for(lock, std::chrono::seconds(1), [&](){ return quit; });
+            TimePoint wake = next_clean;
+            if (!timers.empty() && timers.begin()->first < wake) {
+                wake = timers.begin()->first;
+            }
+
+            cv.wait_until(lock, wake, [&](){ return quit || timers_changed; });
+            timers_changed = false;
+
+            fire_timers(lock);
+
+            if (Clock::now() < next_clean) {
+                continue;
+            }
 
             // Do the cleanup of channels.
+            std::vector<std::shared_ptr<Session<ValueType>>> expired;
+            bool removed = false;
             bool changed = true;
             while (changed) {
                 changed = false;
 
                 for (auto it = channels.begin(); it != channels.end(); ++it) {
-                    if (!it->second->test_active_sessions()) {
+                    if (!it->second->test_active_sessions(expired)) {
                         channels.erase(it);
                         changed = true;
+                        removed = true;
                         break;
                     }
                 }
             }
+
+            if (removed || !expired.empty()) {
+                auto callback = on_expire;
+                lock.unlock();
+
+                expired.clear();
+                if (callback) {
+                    callback();
+                }
+
+                lock.lock();
+            }
+
+            next_clean = Clock::now() + std::chrono::seconds(1);
         }
 
         return true;
     }
 
+    /**
+     * Expire asynchronous polls whose time is up. Callbacks are called without the lock.
+     */
+    void fire_timers(std::unique_lock<std::mutex> &lock) {
+        std::vector<std::pair<std::weak_ptr<Session<ValueType>>, uint64_t>> due;
+
+        auto now = Clock::now();
+        while (!timers.empty() && timers.begin()->first <= now) {
+            due.push_back(std::move(timers.begin()->second));
+            timers.erase(timers.begin());
+        }
+
+        if (due.empty()) {
+            return;
+        }
+
+        lock.unlock();
+        for (auto &timer: due) {
+            if (auto session = timer.first.lock()) {
+                session->expire(timer.second);
+            }
+        }
+        lock.lock();
+    }
+
     std::map<ChannelNameType, std::shared_ptr<Channel<ValueType>>> channels;
+    std::multimap<TimePoint, std::pair<std::weak_ptr<Session<ValueType>>, uint64_t>> timers;
+    bool timers_changed = false;
+    std::function<void()> on_expire;  // Guarded by mutex.
 
     bool quit;
     std::mutex mutex;
@@ -3,6 +3,7 @@
  * @author Michal Kuchta <niximor@gmail.com>
  */
 
+#include <algorithm>
 #include <functional>
 
 #include <gcm/json/validator.h>
@@ -16,8 +17,14 @@ Rtjs::Rtjs(gcm::json::rpc::RpcApi &api):
 {
     using namespace gcm::json::validator;
     using namespace std::placeholders;
+    using gcm::json::rpc::Inline;
+    using gcm::json::rpc::Cached;
+    using gcm::json::rpc::Arg;
+    using gcm::json::rpc::Args;
 
-    server.register_method("rtjs.subscribe", std::bind(&Rtjs::subscribe, this, _1),
+    pubsub.set_on_expire([this](){ server.invalidate_cache("rtjs.list"); });
+
+    server.register_method("rtjs.subscribe", Inline(), std::bind(&Rtjs::subscribe, this, _1),
         "Subscribe to given publication channel.",
         ParamDefinitions(
             String("channelName", "Name of channel to subscribe to."),
@@ -28,7 +35,7 @@ Rtjs::Rtjs(gcm::json::rpc::RpcApi &api):
         )
     );
 
-    server.register_method("rtjs.unsubscribe", std::bind(&Rtjs::unsubscribe, this, _1),
+    server.register_method("rtjs.unsubscribe", Inline(), std::bind(&Rtjs::unsubscribe, this, _1),
         "Unsubscribe from given publication channel.",
         ParamDefinitions(
             String("channelName", "Name of channel to unsubscribe from."),
@@ -40,7 +47,9 @@ Rtjs::Rtjs(gcm::json::rpc::RpcApi &api):
         )
     );
 
-    server.register_method("rtjs.list", std::bind(&Rtjs::list, this, _1),
+    // Dashboards poll the list often, it is rebuilt at most once a second or when sessions
+    // change. Counters of sessions (numMessages, lastActivity) can be up to a second old.
+    server.register_method("rtjs.list", Inline(), Cached(std::chrono::seconds(1)), std::bind(&Rtjs::list, this, _1),
         "List currently active channels.",
         ParamDefinitions(),
         Object("response", "Response",
@@ -60,23 +69,27 @@ Rtjs::Rtjs(gcm::json::rpc::RpcApi &api):
         )
     );
 
-    server.register_method("rtjs.publish", std::bind(&Rtjs::publish, this, _1),
+    server.register_method("rtjs.publish", Inline(), [this](const std::string &channel_name, gcm::json::JsonValue message) {
+            return publish(channel_name, message);
+        },
         "Publish new message to specified channel.",
-        ParamDefinitions(
-            String("channelName", "Name of channel where to publish"),
-            AnyType("message", "Message data to publish")
+        Args(
+            Arg("channelName", "Name of channel where to publish"),
+            Arg("message", "Message data to publish")
         ),
-        Bool("success", "Success of operation")
+        Arg("success", "Success of operation")
     );
 
-    server.register_method("rtjs.poll", std::bind(&Rtjs::poll, this, _1),
+    // Long polls wait for messages without holding a thread, response is sent from publish or timer.
+    server.register_async_method("rtjs.poll", Inline(), std::bind(&Rtjs::poll, this, _1, _2),
         "Poll session in channel for new messages and return them. Optionally wait for specified "
         "amount of time for new message to arrive.",
         ParamDefinitions(
             String("channelName", "Name of channel"),
             Int("sessionId", "ID of session subscribed to that channel"),
-            Optional(Int("timeout", "If specified, wait for specified amount of time for new messages, "
-                "if there are no messages currently in queue."))
+            Optional(Int("timeout", "If specified, wait for specified amount of time (seconds) for new "
+                "messages, if there are no messages currently in queue. Wait ends at call timeout of the "
+                "request at the latest."))
         ),
         Array("messages", "List of queued messages.",
             AnyType("message", "Queued message.")
@@ -91,6 +104,7 @@ gcm::json::JsonValue Rtjs::subscribe(gcm::json::Array &params) {
     auto timeout = to<Int>(params[1]);
 
     auto id = pubsub.subscribe(channelName, std::chrono::seconds{timeout});
+    server.invalidate_cache("rtjs.list");
 
     auto res = make_object();
     auto &obj = to<Object>(res);
@@ -142,36 +156,43 @@ gcm::json::JsonValue Rtjs::unsubscribe(gcm::json::Array &) {
     auto res = make_object();
     auto &obj = to<Object>(res);
 
+    // Session is kept, so cached rtjs.list stays valid. Once sessions can be removed here,
+    // invalidate it the same way as subscribe() does.
     obj["success"] = make_bool(false);
     obj["message"] = make_string("Unsubscribe is not supported so far.");
 
     return res;
 }
 
-gcm::json::JsonValue Rtjs::publish(gcm::json::Array &params) {
-    using namespace gcm::json;
-
-    const std::string channel_name{to<String>(params[0])};
-    auto value = params[1];
-
-    pubsub.publish(channel_name, value);
-
-    return make_bool(true);
+bool Rtjs::publish(const std::string &channel_name, const gcm::json::JsonValue &message) {
+    pubsub.publish(channel_name, gcm::json::make_buffer(message));
+    return true;
 }
 
-gcm::json::JsonValue Rtjs::poll(gcm::json::Array &params) {
+void Rtjs::poll(gcm::json::Array &params, gcm::json::rpc::Completion done) {
     using namespace gcm::json;
 
     const std::string channel_name{to<String>(params[0])};
     int64_t session_id{to<Int>(params[1])};
+    std::chrono::milliseconds timeout = std::chrono::seconds{params[2] ? static_cast<int64_t>(to<Int>(params[2])) : 0};
 
-    JsonValue res;
-    if (params[2]) {
-        std::chrono::seconds timeout{to<Int>(params[2])};
-        res = make_array(pubsub.poll(channel_name, session_id, timeout));
-    } else {
-        res = make_array(pubsub.poll(channel_name, session_id));
+    // Do not wait longer than the caller does (call_timeout or X-Request-Timeout).
+    auto deadline = done.cancellation().get_deadline();
+    if (deadline != rpc::Cancellation::Clock::time_point::max()) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - rpc::Cancellation::Clock::now());
+        timeout = std::max(std::min(timeout, remaining), std::chrono::milliseconds(0));
     }
 
-    return res;
+    pubsub.poll_async(channel_name, session_id, timeout, [done](std::vector<Buffer> &&messages) {
+        // Queued messages are spliced into response as they are, without serializing them again.
+        JsonValue res = make_array();
+        auto &arr = to<Array>(res);
+        arr.reserve(messages.size());
+
+        for (auto &message: messages) {
+            arr.push_back(make_raw(std::move(message)));
+        }
+
+        done(std::move(res));
+    });
 }
@@ -7,6 +7,7 @@
 
 #include <gcm/appsrv/json_rpc_api.h>
 #include <gcm/json/json.h>
+#include <gcm/json/raw.h>
 
 #include "pubsub.h"
 
@@ -17,11 +18,13 @@ public:
     gcm::json::JsonValue subscribe(gcm::json::Array &params);
     gcm::json::JsonValue list(gcm::json::Array &params);
     gcm::json::JsonValue unsubscribe(gcm::json::Array &params);
-    gcm::json::JsonValue publish(gcm::json::Array &params);
-    gcm::json::JsonValue poll(gcm::json::Array &params);
+    bool publish(const std::string &channel_name, const gcm::json::JsonValue &message);
+    void poll(gcm::json::Array &params, gcm::json::rpc::Completion done);
 
 protected:
     gcm::json::rpc::RpcApi &server;
     gcm::logging::Logger &log;
-    gcm::pubsub::PubSub<std::string, gcm::json::JsonValue> pubsub;
+
+    // Messages are serialized once on publish and shared by all subscribed sessions.
+    gcm::pubsub::PubSub<std::string, gcm::json::Buffer> pubsub;
 };
@@ -22,6 +22,7 @@
  */
 
 #include <vector>
+#include <array>
 #include <chrono>
 
 #include <unistd.h>
@@ -31,6 +32,7 @@
 #include <gcm/config/config.h>
 #include <gcm/io/io.h>
 #include <gcm/thread/signal.h>
+#include <gcm/thread/executor.h>
 #include "interface.h"
 
 namespace s = gcm::socket;
@@ -70,6 +72,33 @@ const std::string get_version() {
 }
 }
 
+/**
+ * Integer setting of executor section of config.
+ */
+std::size_t executor_setting(c::Config &cfg, const std::string &name, std::size_t def) {
+    return cfg.hasItem("executor") ? cfg["executor"].get(name, def) : def;
+}
+
+/**
+ * Scheduling of executor shared by all interfaces, from executor section of config.
+ */
+void setup_scheduling(c::Config &cfg, gcm::thread::Executor &executor) {
+    if (!cfg.hasItem("executor")) {
+        return;
+    }
+
+    auto &cfg_executor = cfg["executor"];
+
+    std::array<unsigned, gcm::thread::NumPriorities> weights{{16, 4, 1}};
+    if (auto *cfg_weights = cfg_executor.get("weights")) {
+        for (std::size_t i = 0; i < weights.size() && i < cfg_weights->asArray().size(); ++i) {
+            weights[i] = (*cfg_weights)[i].asInt();
+        }
+    }
+
+    executor.set_scheduling(weights, std::chrono::milliseconds(cfg_executor.get("max_wait", 1000)));
+}
+
 int main(int, char *argv[]) {
 	std::string appname{gcm::io::basename(argv[0])};
 	l::util::setup_logging(appname, {
@@ -83,11 +112,15 @@ int main(int, char *argv[]) {
 	c::Config cfg("../conf/appsrv.conf");
 	l::util::setup_logging(appname, cfg);
 
+    // Before the interfaces, their handlers use it until they are stopped.
+    gcm::thread::Executor executor(executor_setting(cfg, "min_spare", 5), executor_setting(cfg, "max_workers", 150));
+    setup_scheduling(cfg, executor);
+
     std::vector<IntInterface> interfaces;
 
 	auto cfg_interfaces = cfg.getAll("interface");
     for (auto &interface: cfg_interfaces) {
-        interfaces.emplace_back(cfg, *interface);
+        interfaces.emplace_back(cfg, *interface, executor);
         interfaces.back()._start();
     }
 
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/**
+ * Prevent compiler from optimizing out computation whose result is unused.
+ */
+template<typename T>
+inline void consume(const T &value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+/**
+ * Runs one named benchmark and prints its results.
+ */
+class Runner {
+public:
+    /**
+     * Execute func iterations times and print time per iteration. When bytes is non-zero,
+     * it is amount of data processed by one iteration and throughput is printed too.
+     */
+    void operator()(const std::string &name, std::size_t iterations, std::function<void()> func, std::size_t bytes = 0) {
+        // Warm up caches and allocators.
+        func();
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; ++i) {
+            func();
+        }
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+        double ns_per_op = static_cast<double>(duration.count()) / iterations;
+
+        std::cout << std::left << std::setw(50) << name << std::right
+            << std::setw(12) << std::fixed << std::setprecision(1) << ns_per_op << " ns/op";
+
+        if (bytes > 0) {
+            double mb_per_s = (static_cast<double>(bytes) * iterations / (1024.0 * 1024.0))
+                / (duration.count() / 1e9);
+            std::cout << std::setw(12) << std::setprecision(1) << mb_per_s << " MB/s";
+        }
+
+        std::cout << std::endl;
+    }
+};
+
+using Suite = std::function<void(Runner &)>;
+
+inline std::vector<Suite> &suites() {
+    static std::vector<Suite> registered;
+    return registered;
+}
+
+/**
+ * Register suite of benchmarks, to be executed by run().
+ */
+class Register {
+public:
+    Register(Suite suite) {
+        suites().push_back(suite);
+    }
+};
+
+inline int run() {
+    Runner runner;
+    for (auto &suite: suites()) {
+        suite(runner);
+    }
+    return 0;
+}
+
+} // namespace bench
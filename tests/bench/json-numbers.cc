@@ -0,0 +1,83 @@
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gcm/json/json.h>
+#include <gcm/json/parser.h>
+
+#include "bench.h"
+
+using namespace gcm::json;
+
+static bench::Register numbers([](bench::Runner &run){
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> doubles(-1e6, 1e6);
+
+    std::vector<double> values;
+    std::vector<std::string> texts;
+    for (int i = 0; i < 1000; ++i) {
+        values.push_back(doubles(rng));
+        texts.push_back(make_double(values.back())->to_string());
+    }
+
+    run("json::Double::to_string (1000 values)", 1000, [&](){
+        for (double value: values) {
+            bench::consume(Double(value).to_string());
+        }
+    });
+
+    run("std::to_string(double) (1000 values)", 1000, [&](){
+        for (double value: values) {
+            bench::consume(std::to_string(value));
+        }
+    });
+
+    run("detail::parse_double (1000 values)", 1000, [&](){
+        for (auto &text: texts) {
+            double value;
+            detail::parse_double(text.begin(), text.end(), value);
+            bench::consume(value);
+        }
+    });
+
+    run("std::stod (1000 values)", 1000, [&](){
+        for (auto &text: texts) {
+            bench::consume(std::stod(text));
+        }
+    });
+
+    std::vector<std::string> ints;
+    for (int i = 0; i < 1000; ++i) {
+        ints.push_back(std::to_string(static_cast<int64_t>(rng())));
+    }
+
+    run("detail::parse_int (1000 values)", 1000, [&](){
+        for (auto &text: ints) {
+            int64_t value;
+            detail::parse_int(text.begin(), text.end(), value);
+            bench::consume(value);
+        }
+    });
+
+    run("std::stoll (1000 values)", 1000, [&](){
+        for (auto &text: ints) {
+            bench::consume(std::stoll(text));
+        }
+    });
+
+    std::string array = "[";
+    for (std::size_t i = 0; i < texts.size(); ++i) {
+        if (i > 0) {
+            array += ",";
+        }
+        array += (i % 2) ? texts[i] : ints[i];
+    }
+    array += "]";
+
+    run("json::parse number array", 100, [&](){
+        auto begin = array.begin();
+        auto end = array.end();
+        bench::consume(parse(begin, end));
+    }, array.size());
+});
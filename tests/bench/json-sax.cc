@@ -0,0 +1,54 @@
+#include <string>
+
+#include <gcm/json/json.h>
+#include <gcm/json/parser.h>
+
+#include "bench.h"
+
+using namespace gcm::json;
+
+namespace {
+
+// Counts values, the least work SAX consumer can do.
+class Counter: public Handler {
+public:
+    void null_value() { ++count; }
+    void bool_value(bool) { ++count; }
+    void int_value(int64_t) { ++count; }
+    void double_value(double) { ++count; }
+
+    template<typename I>
+    void string_value(I, I) { ++count; }
+
+    std::size_t count = 0;
+};
+
+}
+
+static bench::Register sax([](bench::Runner &run){
+    std::string document = "[";
+    for (int i = 0; i < 2000; ++i) {
+        if (i > 0) {
+            document += ",";
+        }
+        document += "{\"id\":" + std::to_string(i)
+            + ",\"name\":\"item number " + std::to_string(i) + "\""
+            + ",\"price\":" + std::to_string(i * 0.25)
+            + ",\"tags\":[\"a\",\"b\",\"c\"],\"active\":true,\"parent\":null}";
+    }
+    document += "]";
+
+    run("json::parse DOM (large document)", 20, [&](){
+        auto begin = document.begin();
+        auto end = document.end();
+        bench::consume(parse(begin, end));
+    }, document.size());
+
+    run("json::parse SAX counter (large document)", 20, [&](){
+        auto begin = document.begin();
+        auto end = document.end();
+        Counter counter;
+        parse(begin, end, counter);
+        bench::consume(counter.count);
+    }, document.size());
+});
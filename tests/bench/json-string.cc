@@ -0,0 +1,56 @@
+#include <string>
+
+#include <gcm/json/json.h>
+
+#include "bench.h"
+
+using namespace gcm::json;
+
+// Byte by byte escaping, the way String::to_string worked before.
+static void escape_bytewise(std::string &out, const std::string &str) {
+    out += '"';
+    for (char ch: str) {
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            out += "\\u0000";
+        } else {
+            out += ch;
+        }
+    }
+    out += '"';
+}
+
+static bench::Register strings([](bench::Runner &run){
+    std::string ascii;
+    while (ascii.size() < 1024 * 1024) {
+        ascii += "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor. ";
+    }
+
+    std::string escaped;
+    while (escaped.size() < 1024 * 1024) {
+        escaped += "{\"key\": \"value\"}\n\tpath\\to\\file ";
+    }
+
+    std::string utf8;
+    while (utf8.size() < 1024 * 1024) {
+        utf8 += "P\xc5\x99\xc3\xadli\xc5\xa1 \xc5\xbelu\xc5\xa5ou\xc4\x8dk\xc3\xbd k\xc5\xaf\xc5\x88 \xc3\xbap\xc4\x9bl \xc4\x8f\xc3\xa1" "belsk\xc3\xa9 \xc3\xb3" "dy. ";
+    }
+
+    for (auto &input: {std::make_pair("ascii", &ascii), std::make_pair("escaped", &escaped), std::make_pair("utf-8", &utf8)}) {
+        const std::string &text = *input.second;
+
+        run(std::string("detail::write_string 1 MB ") + input.first, 50, [&](){
+            std::string out;
+            detail::write_string(out, text.data(), text.size());
+            bench::consume(out);
+        }, text.size());
+
+        run(std::string("bytewise escaping 1 MB ") + input.first, 50, [&](){
+            std::string out;
+            escape_bytewise(out, text);
+            bench::consume(out);
+        }, text.size());
+    }
+});
@@ -0,0 +1,5 @@
+#include "bench.h"
+
+int main() {
+    return bench::run();
+}
@@ -0,0 +1,43 @@
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gcm/json/rpc/dispatch.h>
+
+#include "bench.h"
+
+using namespace gcm::json;
+using namespace gcm::json::rpc;
+
+static bench::Register dispatch([](bench::Runner &run){
+    std::vector<std::string> names;
+    for (int i = 0; i < 300; ++i) {
+        names.push_back("module" + std::to_string(i % 10) + ".someMethodName" + std::to_string(i));
+    }
+
+    std::map<std::string, std::function<Method>> registry;
+    std::vector<MethodEntry> entries;
+    for (auto &name: names) {
+        registry[name] = nullptr;
+        entries.push_back(MethodEntry{name, 0, nullptr, Execution::Pool, nullptr, gcm::thread::Priority::Interactive, nullptr, nullptr, nullptr, nullptr});
+    }
+
+    MethodTable table(std::move(entries));
+
+    run("std::map lookup, 300 methods", 200, [&](){
+        std::size_t found = 0;
+        for (auto &name: names) {
+            found += registry.find(name) != registry.end();
+        }
+        bench::consume(found);
+    });
+
+    run("MethodTable lookup, 300 methods", 200, [&](){
+        std::size_t found = 0;
+        for (auto &name: names) {
+            found += table.find(name) != nullptr;
+        }
+        bench::consume(found);
+    });
+});
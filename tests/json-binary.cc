@@ -0,0 +1,121 @@
+#include <string>
+
+#include <bandit/bandit.h>
+#include <gcm/json/msgpack.h>
+#include <gcm/json/cbor.h>
+
+#include "../src/handlers/http-json-rpc/body.h"
+
+using namespace bandit;
+using namespace gcm::json;
+
+template<std::size_t N>
+static std::string bytes(const char (&data)[N]) {
+    return std::string(data, N - 1);
+}
+
+static int64_t error_code(JsonValue response) {
+    auto &error = to<Object>(to<Object>(response)["error"]);
+    return to<Int>(error["code"]).get_value();
+}
+
+static JsonValue sample() {
+    std::string str = "{\"id\":1,\"method\":\"test\",\"params\":[0,-1,-33,255,-129,65536,-70000,"
+        "5000000000,-9223372036854775808,0.5,-1e300,true,false,null,\"\",\"" + std::string(300, 'x') + "\",{}]}";
+    auto begin = str.begin();
+    auto end = str.end();
+    return parse(begin, end);
+}
+
+go_bandit([](){
+    describe("json", [](){
+        describe("msgpack", [](){
+            it("encodes compact forms", [](){
+                AssertThat(msgpack::encode(make_int(5)), Equals(bytes("\x05")));
+                AssertThat(msgpack::encode(make_int(-5)), Equals(bytes("\xfb")));
+                AssertThat(msgpack::encode(make_int(1000)), Equals(bytes("\xcd\x03\xe8")));
+                AssertThat(msgpack::encode(make_string("ab")), Equals(bytes("\xa2" "ab")));
+                AssertThat(msgpack::encode(make_array({make_null(), make_bool(true)})), Equals(bytes("\x92\xc0\xc3")));
+                AssertThat(msgpack::encode(make_double(1.0)), Equals(bytes("\xcb\x3f\xf0\x00\x00\x00\x00\x00\x00")));
+            });
+
+            it("round-trips values", [](){
+                auto value = sample();
+                std::string data = msgpack::encode(value);
+                const char *begin = data.data();
+
+                AssertThat(msgpack::decode(begin, data.data() + data.size())->to_string(), Equals(value->to_string()));
+                AssertThat(begin == data.data() + data.size(), IsTrue());
+            });
+
+            it("rejects truncated input", [](){
+                std::string data = bytes("\xdd\xff\xff\xff\xff\x01");
+                const char *begin = data.data();
+                AssertThrows(ParseException, msgpack::decode(begin, data.data() + data.size()));
+            });
+        });
+
+        describe("cbor", [](){
+            it("encodes compact forms", [](){
+                AssertThat(cbor::encode(make_int(10)), Equals(bytes("\x0a")));
+                AssertThat(cbor::encode(make_int(-1000)), Equals(bytes("\x39\x03\xe7")));
+                AssertThat(cbor::encode(make_string("a")), Equals(bytes("\x61" "a")));
+                AssertThat(cbor::encode(make_array({make_null(), make_bool(false)})), Equals(bytes("\x82\xf6\xf4")));
+            });
+
+            it("round-trips values", [](){
+                auto value = sample();
+                std::string data = cbor::encode(value);
+                const char *begin = data.data();
+
+                AssertThat(cbor::decode(begin, data.data() + data.size())->to_string(), Equals(value->to_string()));
+            });
+
+            it("decodes indefinite lengths, half floats and tags", [](){
+                std::string data = bytes("\x9f\x01\xf9\x3c\x00\x7f\x62" "ab" "\x61" "c" "\xff\xc1\x1a\x51\x4b\x67\xb0\xff");
+                const char *begin = data.data();
+                AssertThat(cbor::decode(begin, data.data() + data.size())->to_string(), Equals("[1,1.0,\"abc\",1363896240]"));
+            });
+
+            it("rejects non-string keys", [](){
+                std::string data = bytes("\xa1\x01\x02");
+                const char *begin = data.data();
+                AssertThrows(ParseException, cbor::decode(begin, data.data() + data.size()));
+            });
+        });
+
+        describe("request body", [](){
+            it("answers truncated request with parse error", [](){
+                std::string data = msgpack::encode(sample());
+                data = data + data.substr(0, data.size() / 2);
+
+                auto body = decode_binary_body(BodyFormat::MsgPack, data.data(), data.data() + data.size());
+                AssertThat(body.batch, IsFalse());
+                AssertThat(body.broken, IsTrue());
+                AssertThat(body.items.size(), Equals(1u));
+                AssertThat(error_code(parse_error()), Equals(-32700));
+            });
+
+            it("rejects truncated batch", [](){
+                std::string data = msgpack::encode(make_array({sample(), sample()}));
+                data.resize(data.size() - 1);
+
+                try {
+                    decode_binary_body(BodyFormat::MsgPack, data.data(), data.data() + data.size());
+                    AssertThat(false, IsTrue());
+                } catch (rpc::RpcException &e) {
+                    AssertThat(error_code(e.to_json()), Equals(-32700));
+                }
+            });
+
+            it("decodes batch", [](){
+                std::string data = cbor::encode(make_array({sample(), sample()}));
+
+                auto body = decode_binary_body(BodyFormat::Cbor, data.data(), data.data() + data.size());
+                AssertThat(body.batch, IsTrue());
+                AssertThat(body.broken, IsFalse());
+                AssertThat(body.items.size(), Equals(2u));
+            });
+        });
+    });
+});
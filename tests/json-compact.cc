@@ -0,0 +1,77 @@
+#include <bandit/bandit.h>
+#include <gcm/json/compact.h>
+#include <gcm/json/parser.h>
+
+using namespace bandit;
+using namespace gcm::json;
+
+go_bandit([](){
+    describe("json", [](){
+        describe("compact", [](){
+            it("stores scalars inline", [](){
+                auto i = compact::make_int(-42);
+                auto d = compact::make_double(1.5);
+                auto b = compact::make_bool(true);
+                auto s = compact::make_string("short");
+
+                AssertThat(i->get_type() == ValueType::Int, IsTrue());
+                AssertThat(compact::to<Int>(i), Equals(-42));
+                AssertThat(compact::to<Double>(d), Equals(1.5));
+                AssertThat(compact::to<Bool>(b), Equals(true));
+                AssertThat(compact::to<String>(s), Equals("short"));
+                AssertThat(s.get_tag() == compact::Value::Tag::SmallString, IsTrue());
+                AssertThat(compact::make_null().is_null(), IsTrue());
+            });
+
+            it("stores long strings on heap", [](){
+                auto s = compact::make_string("this string does not fit inline");
+                AssertThat(s.get_tag() == compact::Value::Tag::String, IsTrue());
+                AssertThat(compact::to<String>(s), Equals("this string does not fit inline"));
+            });
+
+            it("shares containers between copies", [](){
+                auto obj = compact::make_object();
+                auto copy = obj;
+
+                compact::to<Object>(copy)["id"] = compact::make_int(1);
+                AssertThat(compact::to<Object>(obj).has_key("id"), IsTrue());
+            });
+
+            it("serializes like the DOM", [](){
+                auto obj = compact::make_object(
+                    std::make_pair("jsonrpc", compact::make_string("2.0")),
+                    std::make_pair("params", compact::make_array({compact::make_int(1), compact::make_double(0.25), compact::make_null()})),
+                    std::make_pair("id", compact::make_string("long request identifier"))
+                );
+
+                AssertThat(obj->to_string(), Equals(compact::to_json(obj)->to_string()));
+                AssertThat(obj->to_string(), Equals("{\"jsonrpc\":\"2.0\",\"params\":[1,0.25,null],\"id\":\"long request identifier\"}"));
+            });
+
+            it("keeps first of duplicate keys", [](){
+                auto obj = compact::make_object(
+                    std::make_pair("id", compact::make_int(1)),
+                    std::make_pair("id", compact::make_int(2))
+                );
+
+                AssertThat(obj->to_string(), Equals("{\"id\":1}"));
+            });
+
+            it("converts from DOM", [](){
+                std::string str = "{\"a\":[1,2.5,true,null,\"x\"],\"b\":{\"c\":\"d\"}}";
+                auto begin = str.begin();
+                auto end = str.end();
+
+                auto value = compact::from_json(parse(begin, end));
+                AssertThat(value->to_string(), Equals(str));
+                AssertThat(compact::to<Array>(compact::to<Object>(value)["a"]).size(), Equals(5u));
+            });
+
+            it("throws on type mismatch", [](){
+                auto i = compact::make_int(1);
+                AssertThrows(TypeException, compact::to<String>(i));
+                AssertThrows(TypeException, compact::to<Object>(i));
+            });
+        });
+    });
+});
@@ -0,0 +1,85 @@
+#include <bandit/bandit.h>
+#include <gcm/json/json.h>
+#include <gcm/json/parser.h>
+
+#include <cstring>
+#include <random>
+
+using namespace bandit;
+using namespace gcm::json;
+
+static JsonValue parse_str(std::string in) {
+    auto begin = in.begin();
+    auto end = in.end();
+    return parse(begin, end);
+}
+
+go_bandit([](){
+    describe("json", [](){
+        describe("numbers", [](){
+            it("parses integers in full int64 range", [](){
+                AssertThat(to<Int>(parse_str("9223372036854775807")).get_value(), Equals(INT64_MAX));
+                AssertThat(to<Int>(parse_str("-9223372036854775808")).get_value(), Equals(INT64_MIN));
+                AssertThat(to<Int>(parse_str("4294967296")).get_value(), Equals(4294967296LL));
+            });
+
+            it("parses integers out of int64 range as double", [](){
+                auto val = parse_str("9223372036854775808");
+                AssertThat(val->get_type(), Equals(ValueType::Double));
+                AssertThat(to<Double>(val).get_value(), Equals(9223372036854775808.0));
+            });
+
+            it("parses doubles with fraction and exponent", [](){
+                AssertThat(to<Double>(parse_str("1.5")).get_value(), Equals(1.5));
+                AssertThat(to<Double>(parse_str("1.5e3")).get_value(), Equals(1500.0));
+                AssertThat(to<Double>(parse_str("-2E-2")).get_value(), Equals(-0.02));
+                AssertThat(to<Double>(parse_str("1e+2")).get_value(), Equals(100.0));
+                AssertThat(to<Double>(parse_str("0.1")).get_value(), Equals(0.1));
+                AssertThat(to<Double>(parse_str("2.2250738585072014e-308")).get_value(), Equals(2.2250738585072014e-308));
+            });
+
+            it("throws on numbers out of double range", [](){
+                AssertThrows(ParseException, parse_str("1e400"));
+            });
+
+            it("formats integers", [](){
+                AssertThat(make_int(INT64_MAX)->to_string(), Equals("9223372036854775807"));
+                AssertThat(make_int(INT64_MIN)->to_string(), Equals("-9223372036854775808"));
+                AssertThat(make_int(int64_t(1) << 40)->to_string(), Equals("1099511627776"));
+                AssertThat(make_int(0)->to_string(), Equals("0"));
+            });
+
+            it("formats doubles in shortest form", [](){
+                AssertThat(make_double(0.1)->to_string(), Equals("0.1"));
+                AssertThat(make_double(1.0)->to_string(), Equals("1.0"));
+                AssertThat(make_double(-2.5)->to_string(), Equals("-2.5"));
+                AssertThat(make_double(123.456)->to_string(), Equals("123.456"));
+                AssertThat(make_double(1e-7)->to_string(), Equals("1e-7"));
+                AssertThat(make_double(1e21)->to_string(), Equals("1e+21"));
+                AssertThat(make_double(5e-324)->to_string(), Equals("5e-324"));
+            });
+
+            it("formats non-finite doubles as null", [](){
+                AssertThat(make_double(std::numeric_limits<double>::infinity())->to_string(), Equals("null"));
+                AssertThat(make_double(std::numeric_limits<double>::quiet_NaN())->to_string(), Equals("null"));
+            });
+
+            it("round-trips random doubles", [](){
+                std::mt19937_64 rng(12345);
+                for (int i = 0; i < 10000; ++i) {
+                    uint64_t bits = rng();
+                    double value;
+                    std::memcpy(&value, &bits, sizeof(value));
+
+                    if (!std::isfinite(value)) {
+                        continue;
+                    }
+
+                    auto out = make_double(value)->to_string();
+                    double back = to<Double>(parse_str(out)).get_value();
+                    AssertThat(std::memcmp(&back, &value, sizeof(value)), Equals(0));
+                }
+            });
+        });
+    });
+});
@@ -0,0 +1,77 @@
+#include <bandit/bandit.h>
+#include <gcm/json/json.h>
+
+using namespace bandit;
+using namespace gcm::json;
+
+go_bandit([](){
+    describe("json", [](){
+        describe("object", [](){
+            it("stores and finds items", [](){
+                Object obj;
+                obj["id"] = make_int(1);
+                obj["method"] = make_string("test");
+
+                AssertThat(obj.size(), Equals(2u));
+                AssertThat(obj.has_key("id"), Equals(true));
+                AssertThat(obj.has_key("params"), Equals(false));
+                AssertThat(to<Int>(obj["id"]).get_value(), Equals(1));
+                AssertThat(to<String>(obj.at("method")).get_value(), Equals("test"));
+            });
+
+            it("overwrites existing key", [](){
+                Object obj;
+                obj["id"] = make_int(1);
+                obj["id"] = make_int(2);
+
+                AssertThat(obj.size(), Equals(1u));
+                AssertThat(to<Int>(obj["id"]).get_value(), Equals(2));
+            });
+
+            it("keeps insertion order", [](){
+                auto obj = make_object(
+                    std::make_pair("jsonrpc", make_string("2.0")),
+                    std::make_pair("method", make_string("test")),
+                    std::make_pair("id", make_int(1))
+                );
+
+                AssertThat(obj->to_string(), Equals("{\"jsonrpc\":\"2.0\",\"method\":\"test\",\"id\":1}"));
+            });
+
+            it("keeps first of duplicate keys", [](){
+                auto obj = make_object(
+                    std::make_pair("id", make_int(1)),
+                    std::make_pair("method", make_string("test")),
+                    std::make_pair("id", make_int(2))
+                );
+
+                AssertThat(obj->to_string(), Equals("{\"id\":1,\"method\":\"test\"}"));
+            });
+
+            it("erases items", [](){
+                Object obj;
+                obj["a"] = make_int(1);
+                obj["b"] = make_int(2);
+                obj["c"] = make_int(3);
+
+                AssertThat(obj.erase("b"), Equals(1u));
+                AssertThat(obj.erase("b"), Equals(0u));
+                AssertThat(obj.has_key("b"), Equals(false));
+                AssertThat(to<Int>(obj["c"]).get_value(), Equals(3));
+                AssertThat(obj.size(), Equals(2u));
+            });
+
+            it("does not overwrite on emplace", [](){
+                Object obj;
+                AssertThat(obj.emplace("a", make_int(1)).second, Equals(true));
+                AssertThat(obj.emplace("a", make_int(2)).second, Equals(false));
+                AssertThat(to<Int>(obj["a"]).get_value(), Equals(1));
+            });
+
+            it("throws from at on missing key", [](){
+                Object obj;
+                AssertThrows(std::out_of_range, obj.at("missing"));
+            });
+        });
+    });
+});
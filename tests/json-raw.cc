@@ -0,0 +1,183 @@
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <bandit/bandit.h>
+#include <gcm/json/raw.h>
+#include <gcm/json/rpc/envelope.h>
+
+using namespace bandit;
+using namespace gcm::json;
+
+static JsonValue raw_str(const Buffer &buffer) {
+    return make_raw(buffer, buffer->data(), buffer->data() + buffer->size());
+}
+
+go_bandit([](){
+    describe("json", [](){
+        describe("raw", [](){
+            it("knows type without parsing", [](){
+                AssertThat(raw_str(std::make_shared<std::string>("{\"a\":1}"))->get_type() == ValueType::Object, IsTrue());
+                AssertThat(raw_str(std::make_shared<std::string>("[1]"))->get_type() == ValueType::Array, IsTrue());
+                AssertThat(raw_str(std::make_shared<std::string>("\"x\""))->get_type() == ValueType::String, IsTrue());
+                AssertThat(raw_str(std::make_shared<std::string>("12"))->get_type() == ValueType::Int, IsTrue());
+                AssertThat(raw_str(std::make_shared<std::string>("1.5"))->get_type() == ValueType::Double, IsTrue());
+                AssertThat(raw_str(std::make_shared<std::string>("null"))->get_type() == ValueType::Null, IsTrue());
+            });
+
+            it("passes original text through", [](){
+                auto value = raw_str(std::make_shared<std::string>("{ \"a\" : [1, 2] }"));
+                auto arr = make_array({value});
+
+                AssertThat(arr->to_string(), Equals("[{ \"a\" : [1, 2] }]"));
+            });
+
+            it("parses on access", [](){
+                auto value = raw_str(std::make_shared<std::string>("{\"a\":[1,\"b\"]}"));
+                auto &obj = to<Object>(value);
+
+                AssertThat(to<Int>(to<Array>(obj["a"])[0]).get_value(), Equals(1));
+                AssertThat(to<Int>(raw_str(std::make_shared<std::string>("-5"))).get_value(), Equals(-5));
+                AssertThrows(TypeException, to<String>(value));
+                AssertThrows(ParseException, to<Object>(raw_str(std::make_shared<std::string>("{\"a\":}x"))));
+            });
+
+            it("splits array into lazy items", [](){
+                auto value = raw_str(std::make_shared<std::string>("[ 1, {\"x\": [2, 3]}, \"a,b\" ]"));
+                auto items = split_array(*value);
+
+                AssertThat(items.size(), Equals(3u));
+                AssertThat(items[1]->is_lazy(), IsTrue());
+                AssertThat(items[1]->to_string(), Equals("{\"x\": [2, 3]}"));
+                AssertThat(to<String>(items[2]).get_value(), Equals("a,b"));
+            });
+        });
+
+        describe("shared buffer", [](){
+            it("is built from checked raw text", [](){
+                AssertThat(*make_buffer(raw_str(std::make_shared<std::string>("{\"a\": [1]}"))), Equals("{\"a\": [1]}"));
+                AssertThrows(ParseException, make_buffer(raw_str(std::make_shared<std::string>("{\"a\":,,\"x\" 1}"))));
+            });
+        });
+
+        describe("buffer strings", [](){
+            it("references buffer for plain strings", [](){
+                Buffer buffer = std::make_shared<std::string>("{\"message\": \"a long message body\", \"quoted\": \"say \\\"hi\\\"\"}");
+                const char *begin = buffer->data();
+                auto value = parse(buffer, begin, buffer->data() + buffer->size());
+                auto &obj = to<Object>(value);
+
+                AssertThat(obj["message"]->is_lazy(), IsTrue());
+                AssertThat(to<String>(obj["message"]).get_value(), Equals("a long message body"));
+                AssertThat(obj["quoted"]->is_lazy(), IsFalse());
+                AssertThat(to<String>(obj["quoted"]).get_value(), Equals("say \"hi\""));
+                AssertThat(value->to_string(), Equals("{\"message\":\"a long message body\",\"quoted\":\"say \\\"hi\\\"\"}"));
+            });
+
+            it("copies strings that would not be written back unchanged", [](){
+                Buffer buffer = std::make_shared<std::string>("[\"caf\xc3\xa9\", \"a\tb\", \"\xff\"]");
+                const char *begin = buffer->data();
+                auto value = parse(buffer, begin, buffer->data() + buffer->size());
+                auto &arr = to<Array>(value);
+
+                AssertThat(arr[0]->is_lazy(), IsTrue());
+                AssertThat(arr[1]->is_lazy(), IsFalse());
+                AssertThat(arr[2]->is_lazy(), IsFalse());
+                AssertThat(value->to_string(), Equals("[\"caf\xc3\xa9\",\"a\\tb\",\"\\ufffd\"]"));
+            });
+
+            it("serializes modified value", [](){
+                auto value = raw_str(std::make_shared<std::string>("\"original\""));
+                to<String>(value).get_value() = "modified";
+
+                AssertThat(value->to_string(), Equals("\"modified\""));
+            });
+        });
+
+        describe("rpc envelope", [](){
+            it("extracts id, method and params", [](){
+                Buffer buffer = std::make_shared<std::string>(
+                    "{\"jsonrpc\": \"2.0\", \"params\": [1, [2]], \"method\": \"test\", \"id\": 7} "
+                    "{\"method\": \"other\"}"
+                );
+                const char *begin = buffer->data();
+                const char *end = begin + buffer->size();
+
+                rpc::Envelope call;
+                AssertThat(rpc::scan_envelope(buffer, begin, end, call), IsTrue());
+                AssertThat(to<String>(call.method).get_value(), Equals("test"));
+                AssertThat(call.id->to_string(), Equals("7"));
+                AssertThat(call.params->to_string(), Equals("[1, [2]]"));
+
+                AssertThat(rpc::scan_envelope(buffer, begin, end, call), IsTrue());
+                AssertThat(to<String>(call.method).get_value(), Equals("other"));
+                AssertThat(call.params == nullptr, IsTrue());
+
+                AssertThat(rpc::scan_envelope(buffer, begin, end, call), IsFalse());
+                AssertThat(begin == end, IsTrue());
+            });
+
+            it("stops at malformed request", [](){
+                Buffer buffer = std::make_shared<std::string>("{\"method\": \"test\" \"id\": 1}");
+                const char *begin = buffer->data();
+                const char *end = begin + buffer->size();
+
+                rpc::Envelope call;
+                AssertThat(rpc::scan_envelope(buffer, begin, end, call), IsFalse());
+                AssertThat(begin != end, IsTrue());
+            });
+
+            it("rejects request that is not valid JSON", [](){
+                const char *requests[] = {
+                    "{\"method\": \"test\", \"id\": foo}",
+                    "{\"method\": \"test\", \"params\": [{\"a\":,,\"x\" 1}]}",
+                    "{\"method\": \"test\", \"params\": [\"a\tb\"]}",
+                    "{\"method\": \"test\", \"params\": [\"\xff\"]}",
+                    "{\"method\": \"test\", \"params\": [01, 1.]}",
+                    "{\"method\": \"test\", \"params\": [\"\\x\"]}",
+                };
+
+                for (auto request: requests) {
+                    Buffer buffer = std::make_shared<std::string>(request);
+                    const char *begin = buffer->data();
+                    const char *end = begin + buffer->size();
+
+                    rpc::Envelope call;
+                    AssertThat(rpc::scan_envelope(buffer, begin, end, call), IsFalse());
+                }
+
+                const char *value = "[{\"a\": [true, null, -1.5e+3, \"\\u00e9\xc3\xa9\"]}, {}, []]";
+                const char *begin = value;
+                AssertThat(detail::skip_valid_value(begin, value + std::strlen(value)), IsTrue());
+                AssertThat(*begin == '\0', IsTrue());
+            });
+
+            it("scans batch array", [](){
+                Buffer buffer = std::make_shared<std::string>(
+                    " [{\"method\": \"a\", \"id\": 1}, 5, {\"method\": \"b\"}] "
+                );
+                const char *begin = buffer->data();
+                const char *end = begin + buffer->size();
+
+                std::vector<rpc::Envelope> items;
+                AssertThat(rpc::scan_batch(buffer, begin, end, items), IsTrue());
+                AssertThat(begin == end, IsTrue());
+                AssertThat(items.size(), Equals(3u));
+
+                AssertThat(to<String>(items[0].method).get_value(), Equals("a"));
+                AssertThat(items[1].method == nullptr, IsTrue());
+                AssertThat(to<String>(items[2].method).get_value(), Equals("b"));
+                AssertThat(items[2].id == nullptr, IsTrue());
+            });
+
+            it("rejects unterminated batch", [](){
+                Buffer buffer = std::make_shared<std::string>("[{\"method\": \"a\"},");
+                const char *begin = buffer->data();
+                const char *end = begin + buffer->size();
+
+                std::vector<rpc::Envelope> items;
+                AssertThat(rpc::scan_batch(buffer, begin, end, items), IsFalse());
+            });
+        });
+    });
+});
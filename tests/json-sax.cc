@@ -0,0 +1,118 @@
+#include <string>
+#include <vector>
+
+#include <bandit/bandit.h>
+#include <gcm/json/parser.h>
+
+using namespace bandit;
+using namespace gcm::json;
+
+namespace {
+
+class Recorder: public Handler {
+public:
+    void null_value() { events.push_back("null"); }
+    void bool_value(bool value) { events.push_back(value ? "true" : "false"); }
+    void int_value(int64_t value) { events.push_back("int " + std::to_string(value)); }
+    void double_value(double) { events.push_back("double"); }
+
+    template<typename I>
+    void string_value(I begin, I end) { events.push_back("string " + std::string(begin, end)); }
+
+    void begin_array() { events.push_back("["); }
+    void end_array() { events.push_back("]"); }
+    void begin_object() { events.push_back("{"); }
+
+    template<typename I>
+    void key(I begin, I end) { events.push_back("key " + std::string(begin, end)); }
+
+    void end_object() { events.push_back("}"); }
+
+    std::vector<std::string> events;
+};
+
+// Projects top-level "id" from the document, skipping everything else.
+class IdProjection: public Handler {
+public:
+    void int_value(int64_t value) {
+        if (depth == 1 && in_id) {
+            id = value;
+        }
+        in_id = false;
+    }
+
+    void begin_array() { ++depth; in_id = false; }
+    void end_array() { --depth; }
+    void begin_object() { ++depth; in_id = false; }
+    void end_object() { --depth; }
+
+    template<typename I>
+    void key(I begin, I end) {
+        in_id = depth == 1 && std::string(begin, end) == "id";
+    }
+
+    int depth = 0;
+    bool in_id = false;
+    int64_t id = -1;
+};
+
+}
+
+go_bandit([](){
+    describe("json", [](){
+        describe("sax", [](){
+            it("reports events in document order", [](){
+                std::string str = "{\"a\": [1, 2.5, null, true], \"b\": \"x\"}";
+                auto begin = str.begin();
+                auto end = str.end();
+
+                Recorder recorder;
+                AssertThat(parse(begin, end, recorder), IsTrue());
+
+                std::vector<std::string> expected{
+                    "{", "key a", "[", "int 1", "double", "null", "true", "]", "key b", "string x", "}"
+                };
+                AssertThat(recorder.events, Equals(expected));
+                AssertThat(begin == end, IsTrue());
+            });
+
+            it("projects fields without building DOM", [](){
+                std::string str = "{\"params\": {\"id\": 5, \"list\": [{\"id\": 6}]}, \"id\": 42}";
+                auto begin = str.begin();
+                auto end = str.end();
+
+                IdProjection projection;
+                AssertThat(parse(begin, end, projection), IsTrue());
+                AssertThat(projection.id, Equals(42));
+            });
+
+            it("fails on invalid input", [](){
+                std::string str = "[1, 2";
+                auto begin = str.begin();
+                auto end = str.end();
+
+                Handler handler;
+                AssertThat(parse(begin, end, handler), IsFalse());
+            });
+
+            it("unescapes strings and keys in DOM", [](){
+                std::string str = "{\"a\\tb\": \"x\\\"y\\\\z\\u00e9\\ud83d\\ude00\\ud800\"}";
+                auto begin = str.begin();
+                auto end = str.end();
+
+                auto value = parse(begin, end);
+                auto &obj = to<Object>(value);
+                AssertThat(obj.has_key("a\tb"), IsTrue());
+                AssertThat(to<String>(obj["a\tb"]).get_value(), Equals("x\"y\\z\xc3\xa9\xf0\x9f\x98\x80\xef\xbf\xbd"));
+            });
+
+            it("builds the same DOM", [](){
+                std::string str = "{\"a\":[1,2.5,null,true,[]],\"b\":{\"c\":\"d\"},\"e\":{}}";
+                auto begin = str.begin();
+                auto end = str.end();
+
+                AssertThat(parse(begin, end)->to_string(), Equals(str));
+            });
+        });
+    });
+});
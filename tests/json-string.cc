@@ -0,0 +1,97 @@
+#include <random>
+#include <string>
+
+#include <bandit/bandit.h>
+#include <gcm/json/json.h>
+#include <gcm/json/parser.h>
+
+using namespace bandit;
+using namespace gcm::json;
+
+static std::string escape(const std::string &str) {
+    std::string out;
+    detail::write_string(out, str.data(), str.size());
+    return out;
+}
+
+// Byte by byte reference for random tests, ASCII only.
+static std::string escape_reference(const std::string &str) {
+    static const char hex[] = "0123456789abcdef";
+
+    std::string out = "\"";
+    for (char ch: str) {
+        switch (ch) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(ch) < 0x20) {
+                    out += "\\u00";
+                    out += hex[ch >> 4];
+                    out += hex[ch & 0xF];
+                } else {
+                    out += ch;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+go_bandit([](){
+    describe("json", [](){
+        describe("string escaping", [](){
+            it("escapes quotes, backslashes and control characters", [](){
+                AssertThat(escape("a\"b\\c/d"), Equals("\"a\\\"b\\\\c/d\""));
+                AssertThat(escape("\b\f\n\r\t"), Equals("\"\\b\\f\\n\\r\\t\""));
+                AssertThat(escape(std::string("\x01\x1f\x00x", 4)), Equals("\"\\u0001\\u001f\\u0000x\""));
+            });
+
+            it("keeps characters after control character intact", [](){
+                AssertThat(escape("\x01" "abc"), Equals("\"\\u0001abc\""));
+            });
+
+            it("passes valid UTF-8 through", [](){
+                std::string text = "P\xc5\x99\xc3\xadli\xc5\xa1 \xe2\x82\xac \xf0\x9f\x98\x80 \x7f";
+                AssertThat(escape(text), Equals("\"" + text + "\""));
+            });
+
+            it("replaces invalid UTF-8", [](){
+                AssertThat(escape("a\xff" "b"), Equals("\"a\\ufffdb\""));
+                AssertThat(escape("\xc3"), Equals("\"\\ufffd\""));
+                AssertThat(escape("\xc0\xaf"), Equals("\"\\ufffd\\ufffd\""));
+                AssertThat(escape("\xed\xa0\x80"), Equals("\"\\ufffd\\ufffd\\ufffd\""));
+            });
+
+            it("matches reference on random input", [](){
+                std::mt19937 rng(7);
+                std::uniform_int_distribution<int> length(0, 100);
+                std::uniform_int_distribution<int> byte(0, 127);
+                std::uniform_int_distribution<int> special(0, 9);
+
+                for (int i = 0; i < 2000; ++i) {
+                    std::string str;
+                    int len = length(rng);
+                    for (int j = 0; j < len; ++j) {
+                        str += static_cast<char>(special(rng) == 0 ? byte(rng) : 'a' + byte(rng) % 26);
+                    }
+
+                    AssertThat(escape(str), Equals(escape_reference(str)));
+                }
+            });
+
+            it("round-trips through parser", [](){
+                std::string text = "line\nwith \"quotes\", \\ and \xc3\xa9";
+                auto value = make_string(text);
+                std::string str = value->to_string();
+                auto begin = str.begin();
+                auto end = str.end();
+
+                AssertThat(to<String>(parse(begin, end)).get_value(), Equals(text));
+            });
+        });
+    });
+});
@@ -121,6 +121,35 @@ go_bandit([](){
                 AssertThrows(v::Diagnostics, def.validate(array));
             });
 
+            it("collects problems without throwing", [](){
+                Array array;
+                array.push_back(make_object(
+                    std::make_pair("param1", make_int(1)),
+                    std::make_pair("param3", make_int(3))
+                ));
+
+                const auto def = v::ParamDefinitions(
+                    v::Object("params", "Param definitions",
+                        v::String("param1", "String param"),
+                        v::Optional(v::Int("param2", "Optional int param")),
+                        v::Int("param3", "Int param")
+                    )
+                );
+
+                v::Problems problems;
+                AssertThat(def.validate(array, problems), IsFalse());
+                AssertThat(problems.get_problems().size(), Equals(1u));
+                AssertThat(problems.get_problems()[0].get_item(), Equals("param1"));
+
+                to<Object>(array[0])["param4"] = make_int(4);
+                to<Object>(array[0])["param1"] = make_string("Hello");
+
+                v::Problems unexpected;
+                AssertThat(def.validate(array, unexpected), IsFalse());
+                AssertThat(unexpected.get_problems().size(), Equals(1u));
+                AssertThat(unexpected.get_problems()[0].get_item(), Equals("param4"));
+            });
+
             it("supports optional", [](){
                 Array array;
                 array.push_back(make_object(
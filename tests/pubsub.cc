@@ -62,6 +62,107 @@ go_bandit([](){
             AssertThat(res[0], Equals(test_message));
         });
 
+        it("shares published buffer between sessions", [](){
+            const std::string channel_name{"test"};
+            auto message = std::make_shared<const std::string>("{\"a\":1}");
+
+            PubSub<std::string, std::shared_ptr<const std::string>> pubsub;
+            auto first = pubsub.subscribe(channel_name);
+            auto second = pubsub.subscribe(channel_name);
+
+            pubsub.publish(channel_name, message);
+
+            auto res1 = pubsub.poll(channel_name, first);
+            auto res2 = pubsub.poll(channel_name, second);
+
+            AssertThat(res1.size(), Equals(1));
+            AssertThat(res2.size(), Equals(1));
+            AssertThat(res1[0].get(), Equals(message.get()));
+            AssertThat(res2[0].get(), Equals(message.get()));
+        });
+
+        it("delivers queued messages to async poll immediately", [](){
+            PubSub<std::string, std::string> pubsub;
+            auto id = pubsub.subscribe("test");
+
+            pubsub.publish("test", "hello");
+
+            std::vector<std::string> res;
+            bool called = false;
+            pubsub.poll_async("test", id, std::chrono::seconds(20), [&](std::vector<std::string> &&messages) {
+                res = std::move(messages);
+                called = true;
+            });
+
+            AssertThat(called, IsTrue());
+            AssertThat(res.size(), Equals(1));
+        });
+
+        it("completes async poll on publish", [](){
+            PubSub<std::string, std::string> pubsub;
+            auto id = pubsub.subscribe("test");
+
+            std::promise<std::vector<std::string>> result;
+            pubsub.poll_async("test", id, std::chrono::seconds(20), [&](std::vector<std::string> &&messages) {
+                result.set_value(std::move(messages));
+            });
+
+            pubsub.publish("test", "abc");
+
+            auto res = result.get_future().get();
+            AssertThat(res.size(), Equals(1));
+            AssertThat(res[0], Equals("abc"));
+        });
+
+        it("completes async poll outside of channel lock", [](){
+            PubSub<std::string, std::string> pubsub;
+            auto id = pubsub.subscribe("test");
+
+            // Continuation of the poll uses the channel again.
+            uint64_t second = 0;
+            pubsub.poll_async("test", id, std::chrono::seconds(10), [&](std::vector<std::string> &&) {
+                second = pubsub.subscribe("test");
+                pubsub.publish("test", "def");
+            });
+
+            pubsub.publish("test", "abc");
+            AssertThat(second != 0, IsTrue());
+            AssertThat(pubsub.poll("test", second).size(), Equals(1));
+        });
+
+        it("completes async poll with no messages after timeout", [](){
+            PubSub<std::string, std::string> pubsub;
+            auto id = pubsub.subscribe("test");
+
+            std::promise<std::vector<std::string>> result;
+            auto start = Clock::now();
+            pubsub.poll_async("test", id, std::chrono::milliseconds(50), [&](std::vector<std::string> &&messages) {
+                result.set_value(std::move(messages));
+            });
+
+            auto res = result.get_future().get();
+            AssertThat(res.empty(), IsTrue());
+            AssertThat(Clock::now() - start >= std::chrono::milliseconds(50), IsTrue());
+        });
+
+        it("reports expired sessions", [](){
+            PubSub<std::string, std::string> pubsub;
+
+            std::promise<void> expired;
+            bool reported = false;
+            pubsub.set_on_expire([&](){
+                if (!reported) {
+                    reported = true;
+                    expired.set_value();
+                }
+            });
+
+            auto id = pubsub.subscribe("test", std::chrono::seconds(0));
+            auto status = expired.get_future().wait_for(std::chrono::seconds(5));
+            AssertThat(status == std::future_status::ready, IsTrue());
+            AssertThrows(SessionNotFound, pubsub.poll("test", id));
+        });
+
         it("throws on unknown session", [](){
             PubSub<std::string, std::string> pubsub;
 
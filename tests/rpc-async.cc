@@ -0,0 +1,76 @@
+#include <future>
+#include <memory>
+#include <thread>
+
+#include <bandit/bandit.h>
+#include <gcm/json/rpc.h>
+#include <gcm/json/validator.h>
+
+using namespace bandit;
+using namespace gcm::json;
+using namespace gcm::json::rpc;
+
+go_bandit([](){
+    describe("json-rpc", [](){
+        describe("async methods", [](){
+            it("completes call from another thread", [](){
+                Rpc rpc;
+                std::promise<Completion> pending;
+
+                rpc.register_async_method("test.later", Inline(), [&](Array &, Completion done) {
+                    pending.set_value(done);
+                }, "", validator::ParamDefinitions());
+
+                auto promise = rpc.add_work(make_int(1), "test.later", Array());
+                AssertThat(promise->try_wait(), IsFalse());
+
+                auto done = pending.get_future().get();
+                std::thread([done](){
+                    done(make_int(42));
+                }).join();
+
+                auto response = promise->get();
+                AssertThat(to<Int>(to<Object>(response)["result"]), Equals(42));
+                AssertThat(done.is_done(), IsTrue());
+
+                rpc.stop();
+            });
+
+            it("fails call whose completion is dropped", [](){
+                Rpc rpc;
+
+                rpc.register_async_method("test.dropped", Inline(), [](Array &, Completion) {
+                }, "", validator::ParamDefinitions());
+
+                auto promise = rpc.add_work(make_int(1), "test.dropped", Array());
+                AssertThat(promise->try_wait(), IsTrue());
+
+                auto response = promise->get();
+                auto &obj = to<Object>(response);
+                AssertThat(obj.find("error") != obj.end(), IsTrue());
+                AssertThat(obj.find("result") == obj.end(), IsTrue());
+
+                rpc.stop();
+            });
+
+            it("validates params before calling method", [](){
+                Rpc rpc;
+                bool called = false;
+
+                rpc.register_async_method("test.params", Inline(), [&](Array &, Completion done) {
+                    called = true;
+                    done(make_bool(true));
+                }, "", validator::ParamDefinitions(validator::Int("value", "Value")));
+
+                auto promise = rpc.add_work(make_int(1), "test.params", Array({make_string("x")}));
+                auto response = promise->get();
+                auto &obj = to<Object>(response);
+
+                AssertThat(called, IsFalse());
+                AssertThat(to<Int>(to<Object>(obj["error"])["code"]), Equals(-32602));
+
+                rpc.stop();
+            });
+        });
+    });
+});
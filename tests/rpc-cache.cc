@@ -0,0 +1,195 @@
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <bandit/bandit.h>
+#include <gcm/json/rpc.h>
+#include <gcm/json/raw.h>
+
+using namespace bandit;
+using namespace gcm::json;
+using namespace gcm::json::rpc;
+
+namespace {
+
+Array raw_params(const std::string &text) {
+    Buffer buffer = std::make_shared<std::string>(text);
+    auto value = make_raw(buffer, buffer->data(), buffer->data() + buffer->size());
+    return split_array(*value);
+}
+
+} // anonymous namespace
+
+go_bandit([](){
+    describe("json-rpc", [](){
+        describe("response cache", [](){
+            it("builds the same key for equal params", [](){
+                auto a = raw_params("[1, {\"b\": [true, null], \"a\": \"x\"}]");
+                auto b = raw_params("[1,{\"a\":\"x\",\"b\":[true,null]}]");
+                auto c = raw_params("[1, {\"a\": \"y\", \"b\": [true, null]}]");
+
+                AssertThat(cache_key(a), Equals(cache_key(b)));
+                AssertThat(cache_key(a) == cache_key(c), IsFalse());
+            });
+
+            it("evicts least recently used entry", [](){
+                // One entry per shard.
+                ResponseCache cache(Cached(std::chrono::minutes(1), ResponseCache::Shards));
+
+                for (int i = 0; i < 100; ++i) {
+                    cache.put(std::to_string(i), make_int(i));
+                }
+
+                AssertThat(cache.size() <= ResponseCache::Shards, IsTrue());
+
+                JsonValue out;
+                AssertThat(cache.get("99", out), IsTrue());
+                AssertThat(to<Int>(out), Equals(99));
+            });
+
+            it("expires entries after ttl", [](){
+                ResponseCache cache(Cached(std::chrono::milliseconds(20)));
+                cache.put("a", make_int(1));
+
+                JsonValue out;
+                AssertThat(cache.get("a", out), IsTrue());
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(30));
+                AssertThat(cache.get("a", out), IsFalse());
+            });
+
+            it("answers repeated calls from cache until invalidated", [](){
+                Rpc rpc;
+                int calls = 0;
+
+                rpc.register_method("test.cached", Inline(), Cached(std::chrono::minutes(1)), [&](Array &params) {
+                    ++calls;
+                    return params[0];
+                });
+
+                for (int i = 0; i < 3; ++i) {
+                    auto response = rpc.add_work(make_int(i), "test.cached", Array({make_int(5)}))->get();
+                    AssertThat(to<Int>(to<Object>(response)["result"]), Equals(5));
+                    AssertThat(to<Int>(to<Object>(response)["id"]), Equals(i));
+                }
+
+                AssertThat(calls, Equals(1));
+
+                rpc.add_work(make_int(1), "test.cached", Array({make_int(6)}))->get();
+                AssertThat(calls, Equals(2));
+
+                rpc.invalidate_cache("test.cached");
+                rpc.add_work(make_int(1), "test.cached", Array({make_int(5)}))->get();
+                AssertThat(calls, Equals(3));
+
+                rpc.stop();
+            });
+
+            it("coalesces identical concurrent calls", [](){
+                Rpc rpc;
+                std::vector<Completion> running;
+
+                rpc.register_async_method("test.coalesced", Inline(), Coalesced(), [&](Array &, Completion done) {
+                    running.push_back(done);
+                }, "", validator::ParamDefinitions(validator::Int("value", "Value")));
+
+                std::vector<std::shared_ptr<Promise>> promises;
+                for (int i = 0; i < 3; ++i) {
+                    promises.push_back(rpc.add_work(make_int(i), "test.coalesced", Array({make_int(5)})));
+                }
+                auto other = rpc.add_work(make_int(3), "test.coalesced", Array({make_int(6)}));
+
+                AssertThat(running.size(), Equals(2u));
+                AssertThat(promises[2]->try_wait(), IsFalse());
+
+                running[0](make_int(5));
+                running[1](make_int(6));
+
+                for (int i = 0; i < 3; ++i) {
+                    auto response = promises[i]->get();
+                    AssertThat(to<Int>(to<Object>(response)["result"]), Equals(5));
+                    AssertThat(to<Int>(to<Object>(response)["id"]), Equals(i));
+                }
+                AssertThat(to<Int>(to<Object>(other->get())["result"]), Equals(6));
+
+                // Nothing is kept after the call finished.
+                rpc.add_work(make_int(4), "test.coalesced", Array({make_int(5)}));
+                AssertThat(running.size(), Equals(3u));
+                running[2](make_int(5));
+
+                rpc.stop();
+            });
+
+            it("executes coalesced call again when its leader is cancelled", [](){
+                Rpc rpc;
+                std::vector<Completion> running;
+
+                rpc.register_async_method("test.coalesced", Inline(), Coalesced(), [&](Array &, Completion done) {
+                    running.push_back(done);
+                }, "", validator::ParamDefinitions(validator::Int("value", "Value")));
+
+                Cancellation leader = Cancellation::cancellable();
+                Cancellation closed = Cancellation::cancellable();
+
+                auto first = rpc.add_work(make_int(0), "test.coalesced", Array({make_int(5)}), leader);
+                auto waiting = rpc.add_work(make_int(1), "test.coalesced", Array({make_int(5)}));
+                auto gone = rpc.add_work(make_int(2), "test.coalesced", Array({make_int(5)}), closed);
+                AssertThat(running.size(), Equals(1u));
+
+                leader.cancel();
+                closed.cancel();
+                try {
+                    running[0].cancellation().check();
+                } catch (...) {
+                    running[0].fail(std::current_exception());
+                }
+
+                auto message = [](std::shared_ptr<Promise> &promise) {
+                    auto &error = to<Object>(to<Object>(promise->get())["error"]);
+                    return to<String>(error["message"]).get_value();
+                };
+
+                AssertThat(message(first), Equals("Call cancelled."));
+                AssertThat(message(gone), Equals("Call cancelled."));
+
+                // Waiting call is not failed by cancellation of the leader.
+                AssertThat(waiting->try_wait(), IsFalse());
+                AssertThat(running.size(), Equals(2u));
+
+                running[1](make_int(5));
+                AssertThat(to<Int>(to<Object>(waiting->get())["result"]), Equals(5));
+
+                rpc.stop();
+            });
+
+            it("reports hits and misses in stats", [](){
+                Rpc rpc;
+
+                rpc.register_method("test.cached", Inline(), Cached(std::chrono::minutes(1)), [&](Array &) {
+                    return make_bool(true);
+                });
+
+                for (int i = 0; i < 4; ++i) {
+                    rpc.add_work(make_int(i), "test.cached", Array())->get();
+                }
+
+                auto response = rpc.add_work(make_int(1), "system.stats", Array())->get();
+                bool found = false;
+                for (auto &item: to<Array>(to<Object>(response)["result"])) {
+                    auto &method = to<Object>(item);
+                    if (to<String>(method["name"]).get_value() == "test.cached") {
+                        auto &cache = to<Object>(method["cache"]);
+                        AssertThat(to<Int>(cache["hits"]), Equals(3));
+                        AssertThat(to<Int>(cache["misses"]), Equals(1));
+                        found = true;
+                    }
+                }
+
+                AssertThat(found, IsTrue());
+
+                rpc.stop();
+            });
+        });
+    });
+});
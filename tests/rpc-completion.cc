@@ -0,0 +1,158 @@
+#include <atomic>
+#include <future>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <bandit/bandit.h>
+#include <gcm/json/rpc/method_processor.h>
+#include <gcm/json/rpc/wait_all.h>
+
+using namespace bandit;
+using namespace gcm::json;
+using namespace gcm::json::rpc;
+
+namespace {
+
+struct Item: public CompletionNode {
+    int value = 0;
+};
+
+void complete(MethodHandle method, std::shared_ptr<Promise> promise, int id) {
+    static const AccessLog log(gcm::logging::getLogger("test"));
+
+    rpc::detail::MethodProcessor(
+        log,
+        method,
+        promise,
+        make_int(id),
+        "echo",
+        Array({make_int(id)})
+    )();
+}
+
+} // anonymous namespace
+
+go_bandit([](){
+    describe("json-rpc", [](){
+        describe("completion queue", [](){
+            it("delivers items from many producers exactly once", [](){
+                const int producers = 4;
+                const int per_producer = 10000;
+
+                std::vector<Item> items(producers * per_producer);
+                for (std::size_t i = 0; i < items.size(); ++i) {
+                    items[i].value = i;
+                }
+
+                CompletionQueue queue;
+                std::vector<std::future<void>> threads;
+                for (int p = 0; p < producers; ++p) {
+                    threads.push_back(std::async(std::launch::async, [&, p](){
+                        for (int i = 0; i < per_producer; ++i) {
+                            queue.push(&items[p * per_producer + i]);
+                        }
+                    }));
+                }
+
+                std::vector<bool> seen(items.size(), false);
+                for (std::size_t i = 0; i < items.size(); ++i) {
+                    auto &item = static_cast<Item &>(*queue.pop());
+                    AssertThat(seen[item.value], IsFalse());
+                    seen[item.value] = true;
+                }
+
+                for (auto &t: threads) {
+                    t.get();
+                }
+
+                AssertThat(queue.try_pop() == nullptr, IsTrue());
+            });
+        });
+
+        describe("wait_all", [](){
+            it("collects promises completed before and after waiting starts", [](){
+                std::vector<MethodEntry> methods;
+                methods.push_back(MethodEntry{"echo", 0, [](Array &params) {
+                    return params[0];
+                }, Execution::Inline, nullptr, gcm::thread::Priority::Interactive, nullptr, nullptr, nullptr, nullptr});
+
+                MethodTable table(std::move(methods));
+                MethodHandle echo = table.find("echo");
+
+                const int count = 1000;
+                std::vector<std::shared_ptr<Promise>> promises;
+                for (int i = 0; i < count; ++i) {
+                    promises.push_back(std::make_shared<Promise>());
+                }
+
+                // First half is done before wait_all attaches its queue.
+                for (int i = 0; i < count / 2; ++i) {
+                    complete(echo, promises[i], i);
+                }
+
+                auto worker = std::async(std::launch::async, [&](){
+                    for (int i = count / 2; i < count; ++i) {
+                        complete(echo, promises[i], i);
+                    }
+                });
+
+                std::set<int64_t> ids;
+                wait_all(promises, [&](Promise &p){
+                    ids.insert(to<Int>(to<Object>(p.get())["id"]));
+                });
+
+                worker.get();
+
+                AssertThat(ids.size(), Equals(static_cast<std::size_t>(count)));
+                AssertThat(*ids.begin(), Equals(0));
+                AssertThat(*ids.rbegin(), Equals(count - 1));
+            });
+        });
+
+        describe("wait_limited", [](){
+            it("keeps at most given number of calls running", [](){
+                std::vector<MethodEntry> methods;
+                methods.push_back(MethodEntry{"echo", 0, [](Array &params) {
+                    return params[0];
+                }, Execution::Inline, nullptr, gcm::thread::Priority::Interactive, nullptr, nullptr, nullptr, nullptr});
+
+                MethodTable table(std::move(methods));
+                MethodHandle echo = table.find("echo");
+
+                const int count = 200;
+                const std::size_t limit = 3;
+
+                std::atomic<std::size_t> running{0};
+                bool exceeded = false;
+
+                std::vector<std::future<void>> workers;
+                std::set<int64_t> ids;
+
+                wait_limited(count, limit, [&](std::size_t i) {
+                    auto promise = std::make_shared<Promise>();
+                    if (++running > limit) {
+                        exceeded = true;
+                    }
+
+                    workers.push_back(std::async(std::launch::async, [&, promise, i](){
+                        --running;
+                        complete(echo, promise, i);
+                    }));
+
+                    return promise;
+                }, [&](Promise &p) {
+                    ids.insert(to<Int>(to<Object>(p.get())["id"]));
+                });
+
+                for (auto &w: workers) {
+                    w.get();
+                }
+
+                AssertThat(exceeded, IsFalse());
+                AssertThat(ids.size(), Equals(static_cast<std::size_t>(count)));
+            });
+        });
+    });
+});
@@ -0,0 +1,66 @@
+#include <string>
+#include <vector>
+
+#include <bandit/bandit.h>
+#include <gcm/json/rpc.h>
+
+using namespace bandit;
+using namespace gcm::json;
+using namespace gcm::json::rpc;
+
+static MethodTable make_table(std::size_t count) {
+    std::vector<MethodEntry> entries;
+    for (std::size_t i = 0; i < count; ++i) {
+        entries.push_back(MethodEntry{"module" + std::to_string(i % 7) + ".method" + std::to_string(i), 0, nullptr, Execution::Pool, nullptr, gcm::thread::Priority::Interactive, nullptr, nullptr, nullptr, nullptr});
+    }
+    return MethodTable(std::move(entries));
+}
+
+go_bandit([](){
+    describe("json-rpc", [](){
+        describe("dispatch table", [](){
+            it("finds every registered method", [](){
+                for (std::size_t count: {0u, 1u, 2u, 5u, 100u, 1000u}) {
+                    auto table = make_table(count);
+                    AssertThat(table.is_perfect(), IsTrue());
+
+                    for (std::size_t i = 0; i < count; ++i) {
+                        std::string name = "module" + std::to_string(i % 7) + ".method" + std::to_string(i);
+                        MethodHandle handle = table.find(name);
+                        AssertThat(handle != nullptr, IsTrue());
+                        AssertThat(handle->name, Equals(name));
+                    }
+
+                    AssertThat(table.find("module1.unknown") == nullptr, IsTrue());
+                    AssertThat(table.find("") == nullptr, IsTrue());
+                }
+            });
+
+            it("calls pre-resolved method", [](){
+                Rpc rpc;
+                rpc.register_method("test.echo", Inline(), [](Array &params) {
+                    return params[0];
+                });
+
+                MethodHandle echo = rpc.resolve("test.echo");
+                AssertThat(echo != nullptr, IsTrue());
+
+                auto response = rpc.add_work(echo, make_int(1), Array({make_int(42)}))->get();
+                AssertThat(static_cast<int64_t>(to<Int>(to<Object>(response)["result"])), Equals(42));
+
+                rpc.stop();
+            });
+
+            it("refuses registration after freeze", [](){
+                Rpc rpc;
+                rpc.freeze();
+
+                AssertThrows(RpcException, rpc.register_method("test.late", [](Array &) {
+                    return make_null();
+                }));
+
+                rpc.stop();
+            });
+        });
+    });
+});
@@ -0,0 +1,259 @@
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <bandit/bandit.h>
+#include <gcm/json/rpc.h>
+
+using namespace bandit;
+using namespace gcm::json;
+using namespace gcm::json::rpc;
+
+go_bandit([](){
+    describe("json-rpc", [](){
+        describe("execution policy", [](){
+            it("runs inline methods on calling thread", [](){
+                Rpc rpc;
+                std::thread::id called_on;
+
+                rpc.register_method("test.inline", Inline(), [&](Array &) {
+                    called_on = std::this_thread::get_id();
+                    return make_bool(true);
+                });
+
+                auto promise = rpc.add_work(make_int(1), "test.inline", Array());
+
+                AssertThat(promise->try_wait(), IsTrue());
+                AssertThat(called_on == std::this_thread::get_id(), IsTrue());
+
+                rpc.stop();
+            });
+
+            it("runs bulkhead methods on their own pool", [](){
+                Rpc rpc;
+                std::thread::id called_on;
+
+                rpc.register_method("test.bulkhead", Bulkhead("test", 1, 2), [&](Array &) {
+                    called_on = std::this_thread::get_id();
+                    return make_bool(true);
+                });
+
+                auto promise = rpc.add_work(make_int(1), "test.bulkhead", Array());
+                auto response = promise->get();
+
+                AssertThat(to<Bool>(to<Object>(response)["result"]), IsTrue());
+                AssertThat(called_on == std::this_thread::get_id(), IsFalse());
+
+                rpc.stop();
+            });
+
+            it("runs notification without response", [](){
+                Rpc rpc;
+                std::promise<int> called;
+
+                rpc.register_method("test.notify", [&](Array &params) {
+                    called.set_value(to<Int>(params[0]));
+                    return make_bool(true);
+                });
+
+                rpc.add_notification("test.notify", Array({make_int(5)}));
+
+                AssertThat(called.get_future().get(), Equals(5));
+
+                rpc.stop();
+            });
+
+            it("drops cancelled calls without executing them", [](){
+                Rpc rpc;
+                bool called = false;
+
+                rpc.register_method("test.late", Inline(), [&](Array &) {
+                    called = true;
+                    return make_bool(true);
+                });
+
+                Cancellation expired(Cancellation::Clock::now() - std::chrono::seconds(1));
+                auto response = rpc.add_work(make_int(1), "test.late", Array(), expired)->get();
+                AssertThat(to<Int>(to<Object>(to<Object>(response)["error"])["code"]), Equals(-32000));
+
+                Cancellation cancelled = Cancellation::cancellable();
+                cancelled.cancel();
+                rpc.add_work(make_int(2), "test.late", Array(), cancelled)->get();
+
+                AssertThat(called, IsFalse());
+
+                rpc.stop();
+            });
+
+            it("exposes cancellation to running method", [](){
+                Rpc rpc;
+                Cancellation cancellation = Cancellation::cancellable();
+
+                rpc.register_method("test.cancel", Inline(), [&](Array &) {
+                    bool before = current_cancellation().is_cancelled();
+                    cancellation.cancel();
+                    return make_bool(!before && current_cancellation().is_cancelled());
+                });
+
+                auto response = rpc.add_work(make_int(1), "test.cancel", Array(), cancellation)->get();
+                AssertThat(to<Bool>(to<Object>(response)["result"]), IsTrue());
+                AssertThat(current_cancellation().is_cancelled(), IsFalse());
+
+                rpc.stop();
+            });
+
+            it("executes pooled call on calling thread", [](){
+                Rpc rpc;
+                std::thread::id called_on;
+
+                rpc.register_method("test.pooled", [&](Array &) {
+                    called_on = std::this_thread::get_id();
+                    return make_bool(true);
+                });
+
+                auto promise = rpc.execute(make_int(1), "test.pooled", make_array());
+
+                AssertThat(promise->try_wait(), IsTrue());
+                AssertThat(called_on == std::this_thread::get_id(), IsTrue());
+
+                rpc.stop();
+            });
+
+            it("runs calls on shared executor and passes result to continuation", [](){
+                gcm::thread::Executor executor(1, 4);
+                Rpc rpc(gcm::logging::getLogger("test"), executor);
+                std::thread::id called_on;
+
+                rpc.register_method("test.pooled", [&](Array &params) {
+                    called_on = std::this_thread::get_id();
+                    return params[0];
+                });
+
+                std::promise<JsonValue> continued;
+                rpc.add_work(make_int(1), "test.pooled", Array({make_int(7)}))->then([&](JsonValue response) {
+                    continued.set_value(response);
+                });
+
+                auto response = continued.get_future().get();
+                AssertThat(to<Int>(to<Object>(response)["result"]), Equals(7));
+                AssertThat(called_on == std::this_thread::get_id(), IsFalse());
+
+                rpc.stop();
+            });
+
+            it("completes calls while connections block every thread of their pool", [](){
+                gcm::thread::Executor executor(2, 2);
+                gcm::thread::Executor connections(3, 3);
+                Rpc rpc(gcm::logging::getLogger("test"), executor);
+
+                rpc.register_method("test.pooled", [](Array &params) {
+                    return params[0];
+                });
+
+                // Keep-alive connection waiting for next request.
+                std::promise<void> closed;
+                auto idle = closed.get_future().share();
+                connections.submit([idle]() {
+                    idle.wait();
+                });
+
+                // Batches waiting for their calls.
+                std::vector<std::promise<std::size_t>> batches(2);
+                for (auto &batch: batches) {
+                    connections.submit([&rpc, &batch]() {
+                        std::size_t done = 0;
+                        wait_limited(4, 2, [&](std::size_t i) {
+                            return rpc.add_work(make_int(i), "test.pooled", Array({make_int(i)}));
+                        }, [&](Promise &) {
+                            ++done;
+                        });
+                        batch.set_value(done);
+                    });
+                }
+
+                for (auto &batch: batches) {
+                    auto result = batch.get_future();
+                    AssertThat(result.wait_for(std::chrono::seconds(5)) == std::future_status::ready, IsTrue());
+                    AssertThat(result.get(), Equals(4u));
+                }
+
+                closed.set_value();
+                rpc.stop();
+            });
+
+            it("executes calls on calling thread once its share of executor is used", [](){
+                gcm::thread::Executor executor(1, 1);
+                Rpc rpc(gcm::logging::getLogger("test"), executor);
+                rpc.set_max_queued(1);
+                std::thread::id called_on;
+
+                rpc.register_method("test.pooled", [&](Array &) {
+                    called_on = std::this_thread::get_id();
+                    return make_bool(true);
+                });
+
+                // Other interface holds the only worker.
+                std::promise<void> released;
+                auto busy = released.get_future().share();
+                executor.submit([busy]() {
+                    busy.wait();
+                });
+
+                auto queued = rpc.add_work(make_int(1), "test.pooled", Array());
+                auto over = rpc.add_work(make_int(2), "test.pooled", Array());
+
+                AssertThat(queued->try_wait(), IsFalse());
+                AssertThat(over->try_wait(), IsTrue());
+                AssertThat(called_on == std::this_thread::get_id(), IsTrue());
+
+                released.set_value();
+                AssertThat(to<Bool>(to<Object>(queued->get())["result"]), IsTrue());
+
+                rpc.stop();
+            });
+
+            it("rejects queued calls once stopping", [](){
+                gcm::thread::Executor executor(1, 1);
+                Rpc rpc(gcm::logging::getLogger("test"), executor);
+                bool called = false;
+
+                rpc.register_method("test.pooled", [&](Array &) {
+                    called = true;
+                    return make_bool(true);
+                });
+
+                std::promise<void> released;
+                auto busy = released.get_future().share();
+                executor.submit([busy]() {
+                    busy.wait();
+                });
+
+                auto promise = rpc.add_work(make_int(1), "test.pooled", Array());
+                rpc.reject_queued();
+                released.set_value();
+
+                auto &error = to<Object>(to<Object>(promise->get())["error"]);
+                AssertThat(static_cast<int64_t>(to<Int>(error["code"])), Equals(-32000));
+                AssertThat(called, IsFalse());
+
+                rpc.stop();
+            });
+
+            it("answers unknown method without handoff", [](){
+                Rpc rpc;
+
+                auto promise = rpc.add_work(make_int(1), "test.unknown", Array());
+
+                AssertThat(promise->try_wait(), IsTrue());
+
+                auto response = promise->get();
+                auto &obj = to<Object>(response);
+                AssertThat(obj.find("error") != obj.end(), IsTrue());
+
+                rpc.stop();
+            });
+        });
+    });
+});
@@ -0,0 +1,67 @@
+#include <string>
+
+#include <bandit/bandit.h>
+#include <gcm/json/rpc.h>
+
+using namespace bandit;
+using namespace gcm::json::rpc;
+
+go_bandit([](){
+    describe("json-rpc", [](){
+        describe("rate limit", [](){
+            it("allows burst and refills at rate", [](){
+                // 10 calls per second, 3 at once.
+                RateLimiter limiter(RateLimit{10, 3});
+                int64_t now = 1000000;
+
+                for (int i = 0; i < 3; ++i) {
+                    AssertThat(limiter.try_acquire("a", now), IsTrue());
+                }
+                AssertThat(limiter.try_acquire("a", now), IsFalse());
+                AssertThat(limiter.try_acquire("b", now), IsTrue());
+
+                AssertThat(limiter.try_acquire("a", now + 100000), IsTrue());
+                AssertThat(limiter.try_acquire("a", now + 100000), IsFalse());
+            });
+
+            it("reuses slots of idle keys", [](){
+                RateLimiter limiter(RateLimit{1, 1}, RateLimiter::Shards * RateLimiter::Probes);
+                int64_t now = 1000000;
+
+                // Far more keys than slots, each busy only for one second.
+                for (int i = 0; i < 10000; ++i) {
+                    AssertThat(limiter.try_acquire(std::to_string(i), now + i * 1000000), IsTrue());
+                }
+
+                now += 10000 * 1000000LL;
+                AssertThat(limiter.try_acquire("x", now), IsTrue());
+                AssertThat(limiter.try_acquire("x", now), IsFalse());
+            });
+
+            it("limits methods per client", [](){
+                RateLimits limits;
+                limits.set_method_limit("test.limited", RateLimit{1, 2});
+
+                AssertThat(limits.try_acquire("a", "test.limited"), IsTrue());
+                AssertThat(limits.try_acquire("a", "test.limited"), IsTrue());
+                AssertThat(limits.try_acquire("a", "test.limited"), IsFalse());
+                AssertThat(limits.try_acquire("b", "test.limited"), IsTrue());
+                AssertThat(limits.try_acquire("a", "test.other"), IsTrue());
+            });
+
+            it("does not charge method for call rejected by client limit", [](){
+                RateLimits limits;
+                limits.set_client_limit(RateLimit{10, 1});
+                limits.set_method_limit("test.limited", RateLimit{1, 2});
+                int64_t now = 1000000;
+
+                AssertThat(limits.try_acquire("a", "test.limited", now), IsTrue());
+                AssertThat(limits.try_acquire("a", "test.limited", now), IsFalse());
+
+                // Client bucket refills first, the method has one token left.
+                AssertThat(limits.try_acquire("a", "test.limited", now + 100000), IsTrue());
+                AssertThat(limits.try_acquire("a", "test.limited", now + 200000), IsFalse());
+            });
+        });
+    });
+});
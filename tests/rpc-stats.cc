@@ -0,0 +1,175 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <bandit/bandit.h>
+#include <gcm/json/rpc.h>
+
+using namespace bandit;
+using namespace gcm::json;
+using namespace gcm::json::rpc;
+
+namespace {
+
+class CaptureHandler: public gcm::logging::Handler {
+public:
+    CaptureHandler(std::vector<std::string> &out): Handler(gcm::logging::Formatter()), out(out)
+    {}
+
+    void write(gcm::logging::Message &msg) override {
+        if (is_enabled(msg.get_severenity())) {
+            out.push_back(msg.get_message());
+        }
+    }
+
+protected:
+    std::vector<std::string> &out;
+};
+
+} // anonymous namespace
+
+go_bandit([](){
+    describe("json-rpc", [](){
+        describe("access log", [](){
+            it("writes only slow calls with params cut to max length", [](){
+                std::vector<std::string> records;
+                auto &logger = gcm::logging::getLogger("test.access");
+                logger.add_handler(std::unique_ptr<gcm::logging::Handler>(new CaptureHandler(records)));
+
+                AccessLog log(logger, AccessLogPolicy{1.0, 10, std::chrono::milliseconds(5)});
+                Array params({make_string("0123456789abcdef"), make_int(1)});
+
+                log.write("test.fast", params, nullptr, std::chrono::milliseconds(1), 0);
+                log.write("test.slow", params, nullptr, std::chrono::milliseconds(10), -32602);
+
+                AssertThat(records.size(), Equals(1u));
+                AssertThat(records[0], Equals("method=test.slow status=InvalidParams time=10ms params=[\"01234567..."));
+            });
+
+            it("formats only prefix of large params", [](){
+                AccessLog log(gcm::logging::getLogger("test.large"), AccessLogPolicy{1.0, 10, std::chrono::microseconds(0)});
+
+                auto text = std::make_shared<std::string>("[\"" + std::string(1 << 20, 'x') + "\"]");
+                auto lazy = make_raw(text);
+                AssertThat(log.format_params(Array(), lazy), Equals("[\"xxxxxxxx..."));
+                AssertThat(log.format_params(split_array(*lazy), nullptr), Equals("[\"xxxxxxxx..."));
+
+                Array params({make_object(std::make_pair("key", make_string(std::string(1 << 20, 'y'))))});
+                AssertThat(log.format_params(params, nullptr), Equals("[{\"key\":\"y..."));
+            });
+
+            it("cuts params at UTF-8 character boundary", [](){
+                AccessLog log(gcm::logging::getLogger("test.utf8"), AccessLogPolicy{1.0, 10, std::chrono::microseconds(0)});
+
+                std::string text = "x";
+                for (int i = 0; i < 20; ++i) {
+                    text += "\xc3\xa9";
+                }
+
+                AssertThat(log.format_params(Array({make_string(text)}), nullptr), Equals("[\"x\xc3\xa9\xc3\xa9\xc3\xa9..."));
+                AssertThat(log.format_params(Array(), make_raw(std::make_shared<std::string>("[\"" + text + "\"]"))),
+                    Equals("[\"x\xc3\xa9\xc3\xa9\xc3\xa9..."));
+
+                Array params({make_object(std::make_pair(text.substr(1), make_int(1)))});
+                AssertThat(log.format_params(params, nullptr), Equals("[{\"\xc3\xa9\xc3\xa9\xc3\xa9..."));
+            });
+
+            it("samples given fraction of calls", [](){
+                std::vector<std::string> records;
+                auto &logger = gcm::logging::getLogger("test.sampled");
+                logger.add_handler(std::unique_ptr<gcm::logging::Handler>(new CaptureHandler(records)));
+
+                AccessLog log(logger, AccessLogPolicy{0.1, 256, std::chrono::microseconds(0)});
+                for (int i = 0; i < 10000; ++i) {
+                    log.write("test.sampled", Array(), nullptr, std::chrono::microseconds(1), 0);
+                }
+
+                AssertThat(records.size() > 500u && records.size() < 1500u, IsTrue());
+            });
+        });
+
+        describe("stats", [](){
+            it("keeps histogram buckets within relative error", [](){
+                for (uint64_t value: {0ull, 1ull, 15ull, 16ull, 17ull, 100ull, 1000ull, 123456ull, 1ull << 35}) {
+                    auto index = Histogram::index(value);
+                    AssertThat(Histogram::upper_bound(index) >= value, IsTrue());
+                    AssertThat(Histogram::upper_bound(index) - value <= value / Histogram::SubBuckets, IsTrue());
+                    if (index > 0) {
+                        AssertThat(Histogram::upper_bound(index - 1) < value, IsTrue());
+                    }
+                }
+            });
+
+            it("computes percentiles", [](){
+                MethodStats stats;
+                for (int i = 1; i <= 1000; ++i) {
+                    stats.record(std::chrono::microseconds(i), i % 10 == 0 ? CallStatus::InvalidParams : CallStatus::Ok);
+                }
+
+                auto snapshot = stats.snapshot();
+                AssertThat(snapshot.calls, Equals(1000u));
+                AssertThat(snapshot.statuses[static_cast<std::size_t>(CallStatus::Ok)], Equals(900u));
+                AssertThat(snapshot.statuses[static_cast<std::size_t>(CallStatus::InvalidParams)], Equals(100u));
+                AssertThat(snapshot.max_us, Equals(1000u));
+                AssertThat(snapshot.percentile(0.5) >= 500u, IsTrue());
+                AssertThat(snapshot.percentile(0.5) < 500u + 500u / 16, IsTrue());
+                AssertThat(snapshot.percentile(0.999), Equals(1000u));
+            });
+
+            it("reports calls through system.stats", [](){
+                Rpc rpc;
+                rpc.register_method("test.fail", Inline(), [](Array &) -> JsonValue {
+                    throw RpcException(ErrorCode::InvalidParams, "Fail.");
+                });
+
+                rpc.add_work(make_int(1), "test.fail", Array());
+                auto response = rpc.add_work(make_int(2), "system.stats", Array())->get();
+
+                auto &methods = to<Array>(to<Object>(response)["result"]);
+                bool found = false;
+                for (auto &method: methods) {
+                    auto &obj = to<Object>(method);
+                    if (static_cast<std::string>(to<String>(obj["name"])) == "test.fail") {
+                        found = true;
+                        AssertThat(static_cast<int64_t>(to<Int>(obj["calls"])), Equals(1));
+                        AssertThat(static_cast<int64_t>(to<Int>(to<Object>(obj["statuses"])["InvalidParams"])), Equals(1));
+                    }
+                }
+                AssertThat(found, IsTrue());
+
+                rpc.stop();
+            });
+
+            it("counts invalid results, failing calls only in strict mode", [](){
+                namespace v = gcm::json::validator;
+
+                Rpc rpc;
+                rpc.register_method("test.invalid", Inline(), [](Array &) {
+                    return make_string("not a number");
+                }, "", v::ParamDefinitions(), v::Int("value", "Value"));
+
+                rpc.set_result_validation(ResultValidationPolicy{ResultValidation::Sampled, 1});
+                auto sampled = rpc.add_work(make_int(1), "test.invalid", Array())->get();
+                AssertThat(static_cast<std::string>(to<String>(to<Object>(sampled)["result"])), Equals("not a number"));
+
+                rpc.set_result_validation(ResultValidationPolicy{ResultValidation::Off, 1});
+                rpc.add_work(make_int(2), "test.invalid", Array());
+
+                rpc.set_result_validation(ResultValidationPolicy{ResultValidation::Always, 1});
+                auto strict = rpc.add_work(make_int(3), "test.invalid", Array())->get();
+                AssertThat(static_cast<int64_t>(to<Int>(to<Object>(to<Object>(strict)["error"])["code"])), Equals(-32603));
+
+                auto response = rpc.add_work(make_int(4), "system.stats", Array())->get();
+                for (auto &method: to<Array>(to<Object>(response)["result"])) {
+                    auto &obj = to<Object>(method);
+                    if (static_cast<std::string>(to<String>(obj["name"])) == "test.invalid") {
+                        AssertThat(static_cast<int64_t>(to<Int>(obj["invalidResults"])), Equals(2));
+                    }
+                }
+
+                rpc.stop();
+            });
+        });
+    });
+});
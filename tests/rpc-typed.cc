@@ -0,0 +1,88 @@
+#include <experimental/optional>
+#include <string>
+#include <vector>
+
+#include <bandit/bandit.h>
+#include <gcm/json/rpc.h>
+
+using namespace bandit;
+using namespace gcm::json;
+using namespace gcm::json::rpc;
+
+go_bandit([](){
+    describe("json-rpc", [](){
+        describe("typed methods", [](){
+            it("converts params to argument types and serializes result", [](){
+                Rpc rpc;
+                rpc.register_method("test.repeat", Inline(),
+                    [](const std::string &text, int64_t count, std::experimental::optional<std::string> separator) {
+                        std::vector<std::string> out;
+                        for (int64_t i = 0; i < count; ++i) {
+                            out.push_back(text + separator.value_or(""));
+                        }
+                        return out;
+                    },
+                    "Repeat text.",
+                    Args(Arg("text", "Text"), Arg("count", "Repetitions"), Arg("separator", "Appended to each item")),
+                    Arg("items", "Repeated text")
+                );
+
+                auto response = rpc.add_work(make_int(1), "test.repeat", Array({make_string("a\""), make_int(2)}))->get();
+                AssertThat(response->to_string(), Equals("{\"jsonrpc\":\"2.0\",\"id\":1,\"result\":[\"a\\\"\",\"a\\\"\"]}"));
+
+                response = rpc.add_work(make_int(2), "test.repeat", Array({make_string("b"), make_int(1), make_string(";")}))->get();
+                AssertThat(to<String>(to<Array>(to<Object>(response)["result"])[0]).get_value(), Equals("b;"));
+
+                rpc.stop();
+            });
+
+            it("describes invalid params with generated validators", [](){
+                Rpc rpc;
+                rpc.register_method("test.add", Inline(), [](int64_t a, int64_t b) {
+                    return a + b;
+                }, "", Args(Arg("a", "First"), Arg("b", "Second")), Arg("sum", "Sum"));
+
+                auto response = rpc.add_work(make_int(1), "test.add", Array({make_int(1), make_string("2")}))->get();
+                auto &error = to<Object>(to<Object>(response)["error"]);
+
+                AssertThat(static_cast<int64_t>(to<Int>(error["code"])), Equals(-32602));
+                auto &problems = to<Array>(error["data"]);
+                AssertThat(problems.size(), Equals(1u));
+                AssertThat(to<String>(to<Object>(problems[0])["item"]).get_value(), Equals("b"));
+
+                response = rpc.add_work(make_int(2), "test.add", Array({make_int(1), make_int(2), make_int(3)}))->get();
+                AssertThat(to<Object>(response).find("error") != to<Object>(response).end(), IsTrue());
+
+                rpc.stop();
+            });
+
+            it("rejects integers out of range of argument type", [](){
+                Rpc rpc;
+                bool called = false;
+                rpc.register_method("test.byte", Inline(), [&](uint8_t value, int8_t offset) {
+                    called = true;
+                    return static_cast<int64_t>(value) + offset;
+                }, "", Args(Arg("value", "Byte"), Arg("offset", "Signed byte")), Arg("sum", "Sum"));
+
+                for (auto &params: {Array({make_int(-255), make_int(0)}), Array({make_int(256), make_int(0)}),
+                    Array({make_int(1), make_int(-129)}), Array({make_int(1), make_int(128)})})
+                {
+                    auto response = rpc.add_work(make_int(1), "test.byte", Array(params))->get();
+                    auto &error = to<Object>(to<Object>(response)["error"]);
+
+                    AssertThat(static_cast<int64_t>(to<Int>(error["code"])), Equals(-32602));
+                    auto &problems = to<Array>(error["data"]);
+                    AssertThat(problems.size(), Equals(1u));
+                    AssertThat(static_cast<int64_t>(to<Int>(to<Object>(problems[0])["code"])), Equals(405));
+                }
+                AssertThat(called, IsFalse());
+
+                auto response = rpc.add_work(make_int(2), "test.byte", Array({make_int(255), make_int(-128)}))->get();
+                AssertThat(static_cast<int64_t>(to<Int>(to<Object>(response)["result"])), Equals(127));
+                AssertThat(called, IsTrue());
+
+                rpc.stop();
+            });
+        });
+    });
+});
@@ -0,0 +1,102 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <bandit/bandit.h>
+#include <gcm/socket/socket/generic_socket.h>
+#include <gcm/socket/socket/inet.h>
+
+using namespace bandit;
+using namespace gcm::socket;
+
+namespace {
+
+/**
+ * Server side of accepted connection.
+ */
+class AcceptedSocket: public WritableSocket<Inet> {
+public:
+    AcceptedSocket(int fd): WritableSocket<Inet>(fd)
+    {}
+};
+
+/**
+ * TCP connection over loopback, server side is returned and client fd stored to client.
+ */
+AcceptedSocket connect_loopback(int &client) {
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    AssertThat(listener >= 0, IsTrue());
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t addrlen = sizeof(addr);
+
+    AssertThat(::bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), Equals(0));
+    AssertThat(::listen(listener, 1), Equals(0));
+    AssertThat(::getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &addrlen), Equals(0));
+
+    client = ::socket(AF_INET, SOCK_STREAM, 0);
+    AssertThat(::connect(client, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), Equals(0));
+
+    int server = ::accept(listener, nullptr, nullptr);
+    ::close(listener);
+    AssertThat(server > 0, IsTrue());
+
+    return AcceptedSocket(server);
+}
+
+/**
+ * Wait until segments sent over loopback reach the other side.
+ */
+void settle() {
+    ::usleep(10000);
+}
+
+} // namespace
+
+go_bandit([](){
+    describe("socket", [](){
+        describe("peer_closed", [](){
+            it("keeps open connection", [](){
+                int client;
+                auto server = connect_loopback(client);
+                AssertThat(server.peer_closed(), IsFalse());
+
+                // Pipelined request waiting to be read is not consumed.
+                AssertThat(::write(client, "x", 1), Equals(1));
+                settle();
+                AssertThat(server.peer_closed(), IsFalse());
+
+                char ch = 0;
+                AssertThat(server.read(&ch, 1), Equals(1));
+                AssertThat(ch, Equals('x'));
+                ::close(client);
+            });
+
+            it("detects closed connection", [](){
+                int client;
+                auto server = connect_loopback(client);
+                ::close(client);
+                settle();
+                AssertThat(server.peer_closed(), IsTrue());
+            });
+
+            it("detects connection closed after request", [](){
+                int client;
+                auto server = connect_loopback(client);
+
+                AssertThat(::write(client, "x", 1), Equals(1));
+                char ch;
+                settle();
+                AssertThat(server.read(&ch, 1), Equals(1));
+
+                ::close(client);
+                settle();
+                AssertThat(server.peer_closed(), IsTrue());
+            });
+        });
+    });
+});
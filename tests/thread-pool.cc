@@ -0,0 +1,90 @@
+#include <functional>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#include <bandit/bandit.h>
+#include <gcm/thread/pool.h>
+
+using namespace bandit;
+using namespace gcm::thread;
+
+namespace {
+
+using Task = std::function<void()>;
+
+/**
+ * Keep the only worker of pool busy, until returned promise is set.
+ */
+std::shared_ptr<std::promise<void>> block(Pool<Task> &pool) {
+    auto release = std::make_shared<std::promise<void>>();
+    auto started = std::make_shared<std::promise<void>>();
+
+    pool.add_work([release, started](){
+        started->set_value();
+        release->get_future().wait();
+    });
+
+    started->get_future().wait();
+    return release;
+}
+
+} // anonymous namespace
+
+go_bandit([](){
+    describe("thread pool", [](){
+        it("serves higher priority class first", [](){
+            Pool<Task> pool(1, 1, 10);
+            std::mutex mutex;
+            std::vector<int> order;
+            std::promise<void> done;
+
+            auto release = block(pool);
+
+            auto add = [&](int id, Priority priority) {
+                pool.add_work([&, id](){
+                    std::unique_lock<std::mutex> lock(mutex);
+                    order.push_back(id);
+                    if (order.size() == 6) {
+                        done.set_value();
+                    }
+                }, priority);
+            };
+
+            for (int i = 0; i < 5; ++i) {
+                add(i, Priority::Bulk);
+            }
+            add(100, Priority::Critical);
+
+            release->set_value();
+            done.get_future().wait();
+
+            AssertThat(order[0], Equals(100));
+            AssertThat(pool.queue_stats(Priority::Bulk).started, Equals(5u));
+
+            pool.stop();
+        });
+
+        it("takes long waiting tasks first regardless of class", [](){
+            Pool<Task> pool(1, 1, 10);
+            pool.set_scheduling({{16, 4, 1}}, std::chrono::milliseconds(0));
+
+            std::vector<int> order;
+            std::promise<void> done;
+
+            auto release = block(pool);
+
+            pool.add_work([&](){ order.push_back(1); }, Priority::Bulk);
+            pool.add_work([&](){ order.push_back(2); }, Priority::Interactive);
+            pool.add_work([&](){ order.push_back(3); done.set_value(); }, Priority::Critical);
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            release->set_value();
+            done.get_future().wait();
+
+            AssertThat(order, Equals(std::vector<int>({1, 2, 3})));
+
+            pool.stop();
+        });
+    });
+});